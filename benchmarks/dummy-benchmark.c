@@ -1,4 +1,5 @@
 #include <aura/aura.h>
+#include <aura/private.h>
 
 #include <inttypes.h>
 #include <math.h>
@@ -49,15 +50,42 @@ long run_first(struct aura_node *n)
 
 }
 
+/* Payload size mixes for the alloc/dealloc test */
+static int size_uniform(void)
+{
+	return (rand() % 512) + 1;
+}
+
+static int size_small(void)
+{
+	return (rand() % 64) + 1;
+}
+
+/* Mostly tiny calls with an occasional large transfer */
+static int size_bimodal(void)
+{
+	return (rand() % 10) ? (rand() % 32) + 1 : (rand() % 4096) + 1;
+}
+
+static int (*next_size)(void) = size_uniform;
+
+#define WINDOW 16
+
 long run_second(struct aura_node *n)
 {
-	struct aura_buffer *buf;
+	/* Keep some buffers alive, like calls in flight do */
+	struct aura_buffer *window[WINDOW] = { NULL };
 	long start = current_time();
 	int i;
 	for (i=0; i<90000; i++) {
-		buf = aura_buffer_request(n, (rand() % 512) + 1);
-		aura_buffer_release(buf);
+		int slot = rand() % WINDOW;
+		if (window[slot])
+			aura_buffer_release(window[slot]);
+		window[slot] = aura_buffer_request(n, next_size());
 	}
+	for (i=0; i<WINDOW; i++)
+		if (window[i])
+			aura_buffer_release(window[i]);
 	return current_time() - start;
 }
 
@@ -71,41 +99,65 @@ void average_aggregate(struct aura_node *n, long (*test)(struct aura_node *n), i
 	printf("%lu \t ms avg of %d runs (%s)\n", v, runs, lbl);
 }
 
+void run_mixes(struct aura_node *n, int num_runs)
+{
+	struct aura_bufferpool_stats stats;
+	int cls, size;
+
+	next_size = size_uniform;
+	average_aggregate(n, run_second, num_runs, "alloc/dealloc test, 1..512 bytes");
+	next_size = size_small;
+	average_aggregate(n, run_second, num_runs, "alloc/dealloc test, 1..64 bytes");
+	next_size = size_bimodal;
+	average_aggregate(n, run_second, num_runs, "alloc/dealloc test, 90% 1..32, 10% 1..4096 bytes");
+
+	/* Class sizes include the transport overhead, the stats are looked up by payload size */
+	for (cls = 0; cls < AURA_BUFFER_POOL_CLASSES; cls++) {
+		size = aura_bufferpool_class_size(cls) - n->tr->buffer_overhead;
+		if ((size <= 0) || aura_bufferpool_get_stats(n, size, &stats))
+			continue;
+		if (stats.hits + stats.misses)
+			printf("\t%6d byte class: %" PRIu64 " hits, %" PRIu64 " misses, %d free\n",
+			       stats.size, stats.hits, stats.misses, stats.count);
+	}
+}
+
 int main() {
 	slog_init(NULL, 0);
 	int num_runs = 5;
 #ifdef AURA_USE_BUFFER_POOL
-	printf("Buffer pool enabled!");
+	printf("Buffer pool enabled!\n");
 #else
-	printf("Buffer pool disabled!");
+	printf("Buffer pool disabled!\n");
 #endif
 
 	struct aura_node *n = aura_open(TRANSPORT, NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
 	printf("+GC -PREHEAT\n");
 	aura_unhandled_evt_cb(n, unhandled_cb, (void *) 0);
 	average_aggregate(n, run_first, num_runs, "call test");
-//	average_aggregate(n, run_second, num_runs, "alloc/dealloc test");
+	run_mixes(n, num_runs);
 	aura_close(n);
 
 	n = aura_open(TRANSPORT, NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
 
 	printf("+GC +PREHEAT\n");
 	aura_unhandled_evt_cb(n, unhandled_cb, (void *) 0);
 	aura_bufferpool_preheat(n, 512, 10);
 	average_aggregate(n, run_first, num_runs, "call test");
-//	average_aggregate(n, run_second, num_runs, "alloc/dealloc test");
+	run_mixes(n, num_runs);
 	aura_close(n);
 
 	n = aura_open(TRANSPORT, NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
 
 	printf("-GC -PREHEAT\n");
 	aura_unhandled_evt_cb(n, unhandled_cb, (void *) 0);
-	n->gc_threshold = -1;
+	aura_bufferpool_set_gc_threshold(n, -1);
 	average_aggregate(n, run_first, num_runs, "call test");
-//	average_aggregate(n, run_second, num_runs, "alloc/dealloc test");
+	run_mixes(n, num_runs);
 	aura_close(n);
 
 	return 0;
 }
-
-
@@ -0,0 +1,114 @@
+#include <aura/aura.h>
+
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+#define TRANSPORT "dummy"
+#define FORMAT "3213s16.4s8.2"
+#define NUM_CALLS 1000000
+
+static struct aura_fmt_plan *plan;
+static char bin[16];
+
+long current_time_us(void)
+{
+	struct timespec spec;
+
+	clock_gettime(CLOCK_MONOTONIC, &spec);
+	return spec.tv_sec * 1000000 + spec.tv_nsec / 1000;
+}
+
+/* What aura_serialize_into() used to do: walk the format string every time */
+static void serialize_string(struct aura_buffer *buf, const char *fmt, ...)
+{
+	va_list ap;
+	int len;
+
+	va_start(ap, fmt);
+	while (*fmt) {
+		switch (*fmt++) {
+		case URPC_U8:
+			aura_buffer_put_u8(buf, (uint8_t)va_arg(ap, unsigned int));
+			break;
+		case URPC_U16:
+			aura_buffer_put_u16(buf, (uint16_t)va_arg(ap, unsigned int));
+			break;
+		case URPC_U32:
+			aura_buffer_put_u32(buf, va_arg(ap, uint32_t));
+			break;
+		case URPC_U64:
+			aura_buffer_put_u64(buf, va_arg(ap, uint64_t));
+			break;
+		case URPC_BIN:
+			len = atoi(fmt);
+			aura_buffer_put_bin(buf, va_arg(ap, void *), len);
+			while (*fmt && (*fmt++ != '.'));
+			break;
+		}
+	}
+	va_end(ap);
+}
+
+static void serialize_plan(struct aura_buffer *buf, const struct aura_fmt_plan *plan, ...)
+{
+	va_list ap;
+
+	va_start(ap, plan);
+	aura_serialize_into(buf, plan, ap);
+	va_end(ap);
+}
+
+long run_string(struct aura_node *n, struct aura_buffer *buf)
+{
+	long start = current_time_us();
+	int i;
+
+	for (i = 0; i < NUM_CALLS; i++) {
+		aura_buffer_rewind(buf);
+		serialize_string(buf, FORMAT, 1, 2, 3, 4, bin, (uint64_t)5, bin, 6);
+	}
+	return current_time_us() - start;
+}
+
+long run_plan(struct aura_node *n, struct aura_buffer *buf)
+{
+	long start = current_time_us();
+	int i;
+
+	for (i = 0; i < NUM_CALLS; i++) {
+		aura_buffer_rewind(buf);
+		serialize_plan(buf, plan, 1, 2, 3, 4, bin, (uint64_t)5, bin, 6);
+	}
+	return current_time_us() - start;
+}
+
+void average_aggregate(struct aura_node *n, long (*test)(struct aura_node *n, struct aura_buffer *buf),
+		       int runs, char *lbl)
+{
+	struct aura_buffer *buf = aura_buffer_request(n, plan->len);
+	long v = 0;
+	int i;
+
+	for (i = 0; i < runs; i++)
+		v += test(n, buf);
+	v /= runs;
+	printf("%.1f \t ns per call, avg of %d runs (%s)\n", v * 1000.0 / NUM_CALLS, runs, lbl);
+	aura_buffer_release(buf);
+}
+
+int main() {
+	slog_init(NULL, 0);
+	int num_runs = 5;
+
+	struct aura_node *n = aura_open(TRANSPORT, NULL);
+	plan = aura_fmt_compile(n, FORMAT);
+
+	printf("Serializing %s (%d fields, %d bytes)\n", FORMAT, plan->num_ops, plan->len);
+	average_aggregate(n, run_string, num_runs, "format string");
+	average_aggregate(n, run_plan, num_runs, "compiled plan");
+
+	free(plan);
+	aura_close(n);
+	return 0;
+}
@@ -82,3 +82,18 @@ macro(generate_clang_complete)
     endif()
   endforeach()
 endmacro()
+
+# Generate a header of typed call stubs with aura-codegen and let target include it.
+# The rest of the arguments say where to take the export table from, e.g. --node dummy
+function(aura_generate_stubs target header prefix)
+  get_filename_component(dir ${header} DIRECTORY)
+  get_filename_component(name ${header} NAME_WE)
+  add_custom_command(OUTPUT ${header}
+    COMMAND aura-codegen -p ${prefix} -o ${header} ${ARGN}
+    DEPENDS aura-codegen
+    COMMENT "Generating call stubs ${header}"
+  )
+  add_custom_target(${target}-${name} DEPENDS ${header})
+  add_dependencies(${target} ${target}-${name})
+  set_property(TARGET ${target} APPEND PROPERTY INCLUDE_DIRECTORIES ${dir})
+endfunction()
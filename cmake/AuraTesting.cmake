@@ -41,10 +41,14 @@ function(add_aura_test testname memcheck testcommand testargs)
     endif()
 endfunction(add_aura_test)
 
+# Any extra arguments name the units to leave out
 function(ADD_C_TEST_DIRECTORY prefix directory RUN MEMCHECK)
     file(GLOB UNITS
         "${CMAKE_SOURCE_DIR}/src/tests/${directory}/*.c"
     )
+    foreach(skip ${ARGN})
+      list(REMOVE_ITEM UNITS "${CMAKE_SOURCE_DIR}/src/tests/${directory}/${skip}.c")
+    endforeach(skip)
 
     if (${RUN})
         SET(AURA_TEST_SUITES_TO_RUN "${AURA_TEST_SUITES_TO_RUN}${prefix} " PARENT_SCOPE)
@@ -36,6 +36,15 @@ enum aura_call_status {
 	AURA_CALL_TRANSPORT_FAIL,       //!< AURA_CALL_TRANSPORT_FAIL
 };
 
+/** Priority class of an outbound call. Higher classes are sent first */
+enum aura_call_priority {
+	AURA_CALL_PRIO_DEFAULT = -1,    //!< Use the priority of the object being called
+	AURA_CALL_PRIO_REALTIME,        //!< Urgent calls, go ahead of everything else
+	AURA_CALL_PRIO_NORMAL,          //!< The default for all objects
+	AURA_CALL_PRIO_BULK,            //!< Bulk transfers, sent when nothing else is queued
+	AURA_CALL_PRIO_COUNT
+};
+
 /** File descriptor action */
 enum aura_fd_action {
 	AURA_FD_ADDED,  //!< Descriptor added
@@ -52,24 +61,220 @@ struct aura_pollfds {
 };
 
 struct aura_object;
+struct aura_struct_map;
+struct aura_buffer;
+struct aura_call_batch;
+struct aura_future;
+
+/** Identifies a call started with aura_start_call_handle(), see aura_call_cancel() */
+struct aura_call_handle {
+	struct aura_node *	node;
+	struct aura_call_slot *	slot;
+	uint32_t		tag;
+};
+
+/** Queue depth statistics, see aura_get_outbound_stats() */
+struct aura_queue_stats {
+	/** Number of buffers in the queue */
+	int		count;
+	/** Total size of the buffers in the queue */
+	size_t		bytes;
+	/** The largest count seen since the last reset */
+	int		count_hwm;
+	/** The largest bytes seen since the last reset */
+	size_t		bytes_hwm;
+};
+
+/** Response cache counters, see aura_get_cache_stats() */
+struct aura_cache_stats {
+	/** Calls served from the cache */
+	uint64_t	hits;
+	/** Calls to cached methods that had to go to the node */
+	uint64_t	misses;
+};
+
+/* Buffer pool size classes are powers of two from 2^AURA_BUFFER_POOL_MIN_SHIFT
+ * to 2^AURA_BUFFER_POOL_MAX_SHIFT bytes, transport overhead included.
+ * Larger buffers are not pooled */
+#ifndef AURA_BUFFER_POOL_MIN_SHIFT
+#define AURA_BUFFER_POOL_MIN_SHIFT 5
+#endif
+#ifndef AURA_BUFFER_POOL_MAX_SHIFT
+#define AURA_BUFFER_POOL_MAX_SHIFT 16
+#endif
+#define AURA_BUFFER_POOL_CLASSES (AURA_BUFFER_POOL_MAX_SHIFT - AURA_BUFFER_POOL_MIN_SHIFT + 1)
+
+/** Buffer pool counters of a size class, see aura_bufferpool_get_stats() */
+struct aura_bufferpool_stats {
+	/** Size of the buffers in the class, transport overhead included */
+	int		size;
+	/** Free buffers in the class */
+	int		count;
+	/** GC keeps at most this many free buffers in the class, -1 for no limit */
+	int		gc_threshold;
+	/** Requests served from the pool */
+	uint64_t	hits;
+	/** Requests that had to allocate a new buffer */
+	uint64_t	misses;
+	/** Buffers released by the GC */
+	uint64_t	dropped;
+	/** Buffers of the class currently handed out */
+	int		in_use;
+	/** Most buffers handed out at once during the current adaptive GC period */
+	int		peak;
+	/** How many buffers adaptive GC thinks the class needs, see aura_bufferpool_set_adaptive_gc() */
+	int		working_set;
+};
+
+/** Adaptive buffer pool GC tunables, see aura_bufferpool_set_adaptive_gc() */
+struct aura_bufferpool_gc_params {
+	/** How often the working set of each size class is reevaluated, ms */
+	int	period_ms;
+	/** Periods a class has to stay below its working set before the working set starts to shrink */
+	int	idle_periods;
+	/** Part of the distance to the recent peak the working set shrinks by each idle period, 1-100 */
+	int	decay_percent;
+};
+
+/* A size class of the buffer pool: a LIFO of free buffers, most recently used first */
+struct aura_buffer_class {
+	struct list_head		free;
+	struct aura_bufferpool_stats	stats;
+	/* Adaptive GC periods in a row the class stayed below its working set */
+	int				idle_periods;
+};
+
+/** A single argument or return value of a call, see aura_call_values() */
+struct aura_value {
+	/** URPC_* token of the field it goes to or comes from */
+	char	type;
+	union {
+		uint8_t			u8;
+		int8_t			s8;
+		uint16_t		u16;
+		int16_t			s16;
+		uint32_t		u32;
+		int32_t			s32;
+		uint64_t		u64;
+		int64_t			s64;
+		float			f32;
+		double			f64;
+		/** URPC_BUF fields */
+		struct aura_buffer *	buf;
+		/** Binary blocks, arrays and variable-size data: where the data is
+		 * (or should be copied to for return values) and its length in bytes */
+		struct {
+			void *		ptr;
+			int		len;
+		} bin;
+	};
+};
+
+/** A remote method call in flight. The node keeps one slot per outstanding call */
+struct aura_call_slot {
+	/** Sequence tag of this call, 0 if the slot is free */
+	uint32_t		tag;
+	/** The object being called */
+	struct aura_object *	object;
+	/** Completion callback and its argument */
+	void			(*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg);
+	void *			arg;
+	/** The batch this call was submitted with, if any */
+	struct aura_call_batch *batch;
+	/** The future this call completes, if any */
+	struct aura_future *	future;
+	/** Timestamp (ms) after which the call fails with AURA_CALL_TIMEOUT, 0 if none */
+	uint64_t		deadline;
+	/** Request buffer while it's still in the outbound queue, NULL otherwise */
+	struct aura_buffer *	request;
+	/** The transport has taken the request, see aura_call_slot_sent() */
+	bool			sent;
+	/** Cancelled while in flight. The response is dropped once it arrives */
+	bool			cancelled;
+	/** Stands in for a call that timed out after its request was sent, see aura_call_slot_find() */
+	bool			stale;
+	/** A stale slot took an untagged response that may have been this call's */
+	bool			maybe_answered;
+	/** Waits for the response to another call, see aura_call_slot_follow() */
+	bool			follower;
+	/** Identical calls may join this one, see aura_object_set_coalescing() */
+	bool			coalescable;
+	/** Serialized arguments of a coalescable call, their length and the space allocated for them */
+	char *			args;
+	int			args_len;
+	int			args_size;
+	/** Identical calls waiting for the response of this one */
+	struct list_head	followers;
+	/** list_entry. Links the slot into the pending call table or the slot pool */
+	struct list_head	qentry;
+	/** list_entry. Links the slot into node's deadline list */
+	struct list_head	dentry;
+};
+
 struct aura_node {
 	const struct aura_transport *	tr;
 	struct aura_export_table *	tbl;
 	void *				transport_data;
 	void *				user_data;
 
+	/* Buffer memory comes from here, NULL for malloc() */
+	struct aura_buffer_allocator *	allocator;
 	void *				allocator_data;
 
 	enum aura_node_status		status;
-	struct list_head		outbound_buffers;
+	/* Outbound queues, one per priority class. They replace the single
+	 * outbound_buffers queue, transports should only go through
+	 * aura_node_read() and aura_node_peek() to get the next buffer */
+	struct list_head		outbound_queues[AURA_CALL_PRIO_COUNT];
 	struct list_head		inbound_buffers;
 
-	/* A simple, memory efficient buffer pool */
-	struct list_head		buffer_pool;
+	/* Buffer pool, segregated by size classes */
+	struct aura_buffer_class	buffer_classes[AURA_BUFFER_POOL_CLASSES];
 	int				num_buffers_in_pool;
+	/* Buffers handed out and not yet released or destroyed */
+	int				num_buffers_out;
+	/* Default gc threshold of the size classes */
 	int				gc_threshold;
+	/* Buffers come from and go to the process-wide pool instead */
+	bool				global_buffer_pool;
+	/* Adaptive GC, runs off gc_timer when it's set */
+	struct aura_bufferpool_gc_params	gc_params;
+	struct aura_timer *		gc_timer;
+
+	/* Pending call table: calls sent (in the order they were) and queued, and free slots */
+	struct list_head		pending_calls;
+	struct list_head		call_slot_pool;
+	uint32_t			next_call_tag;
+	/* Calls with a deadline, earliest first, and a timer for the first one */
+	struct list_head		call_deadlines;
+	struct aura_timer *		deadline_timer;
+	int				call_timeout_ms;
+	/* How long stale slots wait for late responses, see aura_set_late_response_window() */
+	int				late_response_window_ms;
+	/* Outbound buffer the transport is working on, but has not dequeued yet */
+	struct aura_buffer *		outbound_peeked;
+	/* Outbound queue accounting, limits and watermarks */
+	struct aura_queue_stats		outbound_stats;
+	int				outbound_max_count;
+	size_t				outbound_max_bytes;
+	int				outbound_high_pct;
+	int				outbound_low_pct;
+	bool				outbound_congested;
+	bool				outbound_block;
+	void				(*outbound_watermark_cb)(struct aura_node *node, bool congested, void *arg);
+	void *				outbound_watermark_arg;
+	/* Buffers dequeued from higher classes while this one was waiting */
+	int				outbound_starved[AURA_CALL_PRIO_COUNT];
+	int				outbound_starve_limit;
+	/* Response cache totals of all the methods */
+	struct aura_cache_stats		cache_stats;
+	/* Released futures for reuse and a timer for waiting on them */
+	struct list_head		future_pool;
+	struct aura_timer *		future_timer;
+
 	/* Synchronos calls put their stuff here */
 	bool				sync_call_running;
+	uint32_t			sync_call_tag;
 	bool				need_endian_swap;
 	bool				is_opening;
 	bool				start_event_sent;
@@ -115,6 +320,12 @@ struct aura_object {
 	char *	name;
 	char *	arg_fmt;
 	char *	ret_fmt;
+	/* Formats compiled once the object is added to the etable, NULL for no format */
+	struct aura_fmt_plan *	arg_plan;
+	struct aura_fmt_plan *	ret_plan;
+	/* Host struct layouts for aura_call_struct(), NULL until first used */
+	struct aura_struct_map *	arg_map;
+	struct aura_struct_map *	ret_map;
 
 	int	valid;
 	char *	arg_pprinted;
@@ -125,9 +336,18 @@ struct aura_object {
 	int	arglen;
 	int	retlen;
 
-	/* Store callbacks here.
-	 * TODO: Can there be several calls of the same method pending? */
+	/* Number of calls to this method in the node's pending call table */
 	int	pending;
+	/* Priority class of calls to this method, see enum aura_call_priority */
+	int	prio;
+	/* Identical calls in flight share a single request, see aura_object_set_coalescing() */
+	bool				coalesce;
+	/* Recent responses of synchronous calls, most recently used first. See aura_object_set_cache() */
+	int				cache_ttl_ms;
+	int				cache_entries;
+	struct list_head		cache;
+	struct aura_cache_stats		cache_stats;
+	/* Event callbacks are stored here. Method calls keep theirs in call slots */
 	void	(*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg);
 	void *	arg;
 };
@@ -151,6 +371,13 @@ enum node_event {
  * @{
  */
 
+/**
+ * Transport flag: the transport sends buffers with aura_buffer_iovec() and
+ * handles references to caller memory itself, see aura_buffer_put_iov().
+ * Transports without it get buffers with all the references copied in.
+ */
+#define AURA_TRANSPORT_VECTORED_IO	(1 << 0)
+
 /** Represents an aura transport module */
 struct aura_transport {
 	/** \brief Required
@@ -160,7 +387,7 @@ struct aura_transport {
 	const char *	name;
 	/** \brief Optional
 	 *
-	 * Flags. TODO: Is it still needed?
+	 * Flags, AURA_TRANSPORT_* bits.
 	 */
 	uint32_t	flags;
 
@@ -216,8 +443,9 @@ struct aura_transport {
 	 *
 	 * The workhorse of your transport plugin.
 	 *
-	 * This function should check the node->outbound_buffers queue for any new messages to
-	 * deliver and place any incoming messages into node->inbound_buffers queue.
+	 * This function should fetch any new messages to deliver with aura_node_read()
+	 * or aura_node_peek() and place any incoming messages into node->inbound_buffers
+	 * queue with aura_node_write(). Outbound messages are handed out in priority order.
 	 *
 	 * This function is called by the core when:
 	 * - Descriptors associated with this node report being ready for I/O (fd will be set to
@@ -259,6 +487,7 @@ struct aura_transport {
 	 * \brief Optional
 	 *
 	 * If your transport needs a custom memory allocator, specify it here.
+	 * Nodes of such transports can't switch to another allocator.
 	 */
 	struct aura_buffer_allocator *	allocator;
 
@@ -304,6 +533,18 @@ struct aura_buffer {
 	struct aura_object *	object;
 	/** The node that owns the buffer */
 	struct aura_node *	owner;
+	/** Tag of the call this buffer carries, 0 if none */
+	uint32_t		call_tag;
+	/** The call slot of a request buffer while it's in the outbound queue */
+	struct aura_call_slot *	slot;
+	/** Priority class of the call, see enum aura_call_priority */
+	int			prio;
+	/** Buffer pool size class the memory of the buffer belongs to, -1 if it's not pooled */
+	int			pool_class;
+	/** Number of holders, see aura_buffer_ref(). The buffer goes back to the pool when it drops to 0 */
+	int			refcount;
+	/** list_head. References to caller memory, see aura_buffer_put_iov() */
+	struct list_head	refs;
 	/** list_entry. Used to link buffers in queue keep in buffer pool */
 	struct list_head	qentry;
 	/** The actual data in this buffer */
@@ -315,8 +556,19 @@ struct aura_buffer {
  */
 
 
+struct aura_buffer *aura_serialize_plan(struct aura_node *node, const struct aura_fmt_plan *plan, va_list ap);
 struct aura_buffer *aura_serialize(struct aura_node *node, const char *fmt, int size, va_list ap);
+int  aura_serialized_len(const struct aura_fmt_plan *plan, va_list ap);
+void aura_serialize_into(struct aura_buffer *buf, const struct aura_fmt_plan *plan, va_list ap);
+void aura_deserialize(struct aura_buffer *buf, const struct aura_fmt_plan *plan, va_list ap);
+void aura_deserialize_flat(struct aura_buffer *buf, const struct aura_fmt_plan *plan, void *dst);
+int  aura_deserialize_check(struct aura_buffer *buf, const struct aura_fmt_plan *plan);
+int  aura_serialize_values(struct aura_node *node, const struct aura_fmt_plan *plan,
+			   const struct aura_value *args, int n, struct aura_buffer **bufp);
+void aura_deserialize_values(struct aura_buffer *buf, const struct aura_fmt_plan *plan,
+			     struct aura_value *rets);
 int  aura_fmt_len(struct aura_node *node, const char *fmt);
+struct aura_fmt_plan *aura_fmt_compile(struct aura_node *node, const char *fmt);
 char *aura_fmt_pretty_print(const char *fmt, int *valid, int *num_args);
 
 
@@ -352,6 +604,8 @@ void aura_etable_destroy(struct aura_export_table *tbl);
 #include <aura/buffer.h>
 #include <aura/eventloop-funcs.h>
 #include <aura/etable.h>
+#include <aura/xcall.h>
+#include <aura/looppool.h>
 
 void __attribute__((noreturn)) aura_panic(struct aura_node *node);
 int __attribute__((noreturn))  BUG(struct aura_node *node, const char *msg, ...);
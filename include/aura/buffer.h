@@ -11,11 +11,14 @@
 #ifndef EVBUFFER_IOVEC_IS_NATIVE_
 struct evbuffer_iovec;
 #endif
+struct iovec;
 
 void aura_buffer_put_eviovec(struct aura_buffer *buf, struct evbuffer_iovec *vec, size_t length);
 struct aura_buffer *aura_buffer_from_eviovec(struct aura_node *node, struct evbuffer_iovec *vec, size_t length);
 
 void aura_buffer_release(struct aura_buffer *buf);
+struct aura_buffer *aura_buffer_ref(struct aura_buffer *buf);
+void aura_buffer_unref(struct aura_buffer *buf);
 void aura_buffer_destroy(struct aura_buffer *buf);
 
 struct aura_buffer *aura_buffer_request(struct aura_node *nd, int size);
@@ -217,6 +220,54 @@ void aura_buffer_put_s32(struct aura_buffer *buf, int32_t value);
  */
 void aura_buffer_put_s64(struct aura_buffer *buf, int64_t value);
 
+/**
+ * \brief Get an IEEE754 single precision float from aura buffer
+ *
+ * This function will swap endianness if needed.
+ * This function will cause a panic if attempted to read beyond
+ * the buffer boundary.
+ *
+ * @param buf
+ * @return
+ */
+float aura_buffer_get_f32(struct aura_buffer *buf);
+
+/**
+ * \brief Get an IEEE754 double precision float from aura buffer
+ *
+ * This function will swap endianness if needed.
+ * This function will cause a panic if attempted to read beyond
+ * the buffer boundary.
+ *
+ * @param buf
+ * @return
+ */
+double aura_buffer_get_f64(struct aura_buffer *buf);
+
+/**
+ * \brief Put an IEEE754 single precision float to aura buffer
+ *
+ * This function will swap endianness if needed.
+ * This function will cause a panic if attempted to write beyond
+ * the buffer boundary.
+ *
+ * @param buf
+ * @param value
+ */
+void aura_buffer_put_f32(struct aura_buffer *buf, float value);
+
+/**
+ * \brief Put an IEEE754 double precision float to aura buffer
+ *
+ * This function will swap endianness if needed.
+ * This function will cause a panic if attempted to write beyond
+ * the buffer boundary.
+ *
+ * @param buf
+ * @param value
+ */
+void aura_buffer_put_f64(struct aura_buffer *buf, double value);
+
 
 /**
  * \brief Get a pointer to the binary data block within buffer and advance
@@ -246,6 +297,104 @@ const void *aura_buffer_get_bin(struct aura_buffer *buf, int len);
  */
 void aura_buffer_put_bin(struct aura_buffer *buf, const void *data, int len);
 
+/**
+ * \brief Copy an array of count elements of size bytes each from aura buffer
+ * to dst and advance internal pointer by count * size bytes.
+ *
+ * This function will swap endianness of every element if needed.
+ * This function will cause a panic if attempted to read beyond
+ * the buffer boundary, or if count * size is negative or overflows.
+ *
+ * @param buf aura buffer
+ * @param dst destination array
+ * @param count number of elements
+ * @param size element size: 1, 2, 4 or 8
+ */
+void aura_buffer_get_array(struct aura_buffer *buf, void *dst, int count, int size);
+
+/**
+ * \brief Copy an array of count elements of size bytes each from src to
+ * aura buffer and advance internal pointer by count * size bytes.
+ *
+ * This function will swap endianness of every element if needed.
+ * This function will cause a panic if attempted to write beyond
+ * the buffer boundary, or if count * size is negative or overflows.
+ *
+ * @param buf aura buffer
+ * @param src source array
+ * @param count number of elements
+ * @param size element size: 1, 2, 4 or 8
+ */
+void aura_buffer_put_array(struct aura_buffer *buf, const void *src, int count, int size);
+
+/**
+ * \brief Get a pointer to a length-prefixed binary block in aura buffer
+ * and advance internal pointer past it.
+ *
+ * The length is stored as an uint8_t (vbin8) or uint16_t (vbin16) in the
+ * node's byte order, followed by the data itself. This is what URPC_VBIN8
+ * and URPC_VBIN16 format fields look like.
+ * This function will cause a panic if attempted to read beyond
+ * the buffer boundary.
+ *
+ * @param buf aura buffer
+ * @param len where to store the length of the data
+ * @return pointer to the data within the buffer
+ */
+const void *aura_buffer_get_vbin8(struct aura_buffer *buf, int *len);
+const void *aura_buffer_get_vbin16(struct aura_buffer *buf, int *len);
+
+/**
+ * \brief Put a length-prefixed binary block into aura buffer and advance
+ * internal pointer past it. See aura_buffer_get_vbin8().
+ *
+ * This function will cause a panic if attempted to write beyond
+ * the buffer boundary.
+ *
+ * @param buf aura buffer
+ * @param data data buffer
+ * @param len data length, up to 255 for vbin8 and 65535 for vbin16
+ */
+void aura_buffer_put_vbin8(struct aura_buffer *buf, const void *data, int len);
+void aura_buffer_put_vbin16(struct aura_buffer *buf, const void *data, int len);
+
+/**
+ * \brief Fetch all the fields of a response or event buffer at once
+ *
+ * Takes a pointer to a variable of the respective type for every field
+ * of the object's return format, in order. Binary blocks and arrays are
+ * copied to the memory pointed to. Variable-size fields take a pointer to
+ * the memory to copy the data to and a pointer to an int to store its
+ * length to. See aura_deserialize().
+ *
+ * The whole message is checked against the buffer boundary once, which
+ * makes this faster than fetching the fields one by one.
+ * This function will cause a panic if attempted to read beyond
+ * the buffer boundary.
+ *
+ * @param buf aura buffer
+ */
+void aura_buffer_unpack(struct aura_buffer *buf, ...);
+
+/* Typed versions of aura_buffer_get_array() and aura_buffer_put_array() */
+void aura_buffer_get_array_u8(struct aura_buffer *buf, uint8_t *dst, int count);
+void aura_buffer_get_array_s8(struct aura_buffer *buf, int8_t *dst, int count);
+void aura_buffer_get_array_u16(struct aura_buffer *buf, uint16_t *dst, int count);
+void aura_buffer_get_array_s16(struct aura_buffer *buf, int16_t *dst, int count);
+void aura_buffer_get_array_u32(struct aura_buffer *buf, uint32_t *dst, int count);
+void aura_buffer_get_array_s32(struct aura_buffer *buf, int32_t *dst, int count);
+void aura_buffer_get_array_u64(struct aura_buffer *buf, uint64_t *dst, int count);
+void aura_buffer_get_array_s64(struct aura_buffer *buf, int64_t *dst, int count);
+
+void aura_buffer_put_array_u8(struct aura_buffer *buf, const uint8_t *src, int count);
+void aura_buffer_put_array_s8(struct aura_buffer *buf, const int8_t *src, int count);
+void aura_buffer_put_array_u16(struct aura_buffer *buf, const uint16_t *src, int count);
+void aura_buffer_put_array_s16(struct aura_buffer *buf, const int16_t *src, int count);
+void aura_buffer_put_array_u32(struct aura_buffer *buf, const uint32_t *src, int count);
+void aura_buffer_put_array_s32(struct aura_buffer *buf, const int32_t *src, int count);
+void aura_buffer_put_array_u64(struct aura_buffer *buf, const uint64_t *src, int count);
+void aura_buffer_put_array_s64(struct aura_buffer *buf, const int64_t *src, int count);
+
 
 /**
  * \brief Retrieve aura_buffer pointer from within the buffer and advance
@@ -274,6 +423,11 @@ size_t aura_buffer_payload_length(struct aura_buffer *buf);
 void aura_buffer_put_buf(struct aura_buffer *to, struct aura_buffer *to_put);
 
 void aura_buffer_rewind(struct aura_buffer *buf);
+
+void aura_buffer_put_iov(struct aura_buffer *buf, const void *data, int len,
+			 void (*release)(const void *data, void *arg), void *arg);
+void aura_buffer_flatten(struct aura_buffer *buf);
+int aura_buffer_iovec(struct aura_buffer *buf, struct iovec *iov, int max);
 /**
  * @}
  */
@@ -3,12 +3,25 @@
 
 struct aura_buffer_allocator {
     const char *name;
+    struct list_head linkage;
     void *(*create)(struct aura_node *node);
     struct aura_buffer *(*request)(struct aura_node *node, void *data, int size);
     void (*release)(struct aura_node *node, void *data, struct aura_buffer *buf);
     void (*destroy)(struct aura_node *node, void *data);
 };
 
+/* Makes the allocator selectable by name, see aura_buffer_allocator_select() */
+#define AURA_BUFFER_ALLOCATOR(s)                                            \
+        static void __attribute__((constructor (101))) do_areg_ ## s(void) { \
+                aura_buffer_allocator_register(&s);                       \
+        }
+
+void aura_buffer_allocator_register(struct aura_buffer_allocator *a);
+struct aura_buffer_allocator *aura_buffer_allocator_lookup(const char *name);
+struct aura_buffer_allocator *aura_buffer_allocator_get(void);
+int aura_buffer_allocator_select(const char *name);
+int aura_node_set_buffer_allocator(struct aura_node *node, const char *name);
+
 static inline void *aura_node_allocatordata_get(struct aura_node *node)
 {
     return node->allocator_data;
@@ -136,6 +136,28 @@
  *
  *  Rule of thumb for multi-threading: No more than one thread per node.
  *
+ *  If a single thread is not enough to serve all your nodes, create a pool of loops with
+ *  aura_looppool_create(). Each loop in the pool runs in its own thread (optionally pinned to a cpu)
+ *  and nodes are spread among them with aura_looppool_add().
+ *
+ */
+
+/** @defgroup xcall Calls from other threads
+ *  Nodes and event loops are single-threaded. If you need to issue calls from several
+ *  threads, let the loop accept them with aura_eventloop_xcall_enable() and use
+ *  aura_xcall_submit() from the other threads. Submission is lock-free: the call
+ *  is pushed into the loop's ring and the loop is woken up to start it. Completed calls
+ *  are delivered to a completion queue, usually one per thread, see aura_xcall_cq_create()
+ *  and aura_xcall_cq_wait().
+ *
+ *  \code{.c}
+ *  struct aura_xcall_cq *cq = aura_xcall_cq_create();
+ *  aura_xcall_submit(node, "echo_u16", cq, NULL, 0x1234);
+ *  struct aura_xcall *xc = aura_xcall_cq_wait(cq, -1);
+ *  if (xc->status == AURA_CALL_COMPLETED)
+ *     printf("%x\n", aura_buffer_get_u16(xc->retbuf));
+ *  aura_xcall_release(xc);
+ *  \endcode
  */
 
 /** @defgroup retparse Parsing return values
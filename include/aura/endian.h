@@ -28,4 +28,6 @@ enum aura_endianness
          ((((uint64_t)value)>>40) & 0x000000000000FF00ULL)  |     \
          ((((uint64_t)value)>>56) & 0x00000000000000FFULL))
 
+void aura_swap_array(void *dst, const void *src, int count, int size);
+
 #endif
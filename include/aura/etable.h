@@ -7,6 +7,8 @@ struct aura_export_table {
 	int			next;
 	struct aura_node *	owner;
 	struct hsearch_data	index;
+	/* Hash of the names and formats of all the objects, set once the table is activated */
+	uint32_t		fingerprint;
 	struct aura_object	objects[];
 };
 
@@ -16,6 +18,7 @@ void aura_etable_activate(struct aura_export_table *tbl);
 
 struct aura_object *aura_etable_find(struct aura_export_table *tbl, const char *name);
 struct aura_object *aura_etable_find_id(struct aura_export_table *tbl, int id);
+uint32_t aura_etable_fingerprint(struct aura_export_table *tbl);
 
 
 #endif /* end of include guard: AURA_ETABLE_H */
@@ -32,6 +32,10 @@ void aura_eventloop_add(struct aura_eventloop *loop, struct aura_node *node);
 void aura_eventloop_del(struct aura_node *node);
 void aura_eventloop_dispatch(struct aura_eventloop *loop, int flags);
 void aura_eventloop_loopexit(struct aura_eventloop *loop, struct timeval *tv);
+int aura_eventloop_wakeup(struct aura_eventloop *loop);
+void aura_eventloop_wakeup_cb(struct aura_eventloop *loop,
+			      void (*cb)(struct aura_eventloop *loop, void *arg),
+			      void *arg);
 
 
 #endif /* end of include guard: AURA_EVENTLOOP_H */
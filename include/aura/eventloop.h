@@ -7,6 +7,7 @@
 
 struct aura_pollfds;
 struct aura_node;
+struct aura_xring;
 struct aura_eventloop {
         int keep_running;
         int poll_timeout;
@@ -14,6 +15,11 @@ struct aura_eventloop {
         void *eventsysdata;
         const struct aura_eventloop_module *module;
         int deferred_inbound;
+        /* Calls submitted from other threads, if enabled */
+        struct aura_xring *xring;
+        /* Called from the loop thread each time the loop is woken up */
+        void (*wakeup_cb)(struct aura_eventloop *loop, void *arg);
+        void *wakeup_arg;
 };
 
 struct aura_eventloop_module {
@@ -28,6 +34,9 @@ struct aura_eventloop_module {
                           int action);
         void (*dispatch)(struct aura_eventloop *loop, int flags);
         void (*loopbreak)(struct aura_eventloop *loop, struct timeval *tv);
+        /* Optional. Must be safe to call from any thread. Makes the loop
+         * call aura_eventloop_process_wakeup() from its own thread */
+        void (*wakeup)(struct aura_eventloop *loop);
         void (*node_added)(struct aura_eventloop *loop, struct aura_node *node);
         void (*node_removed)(struct aura_eventloop *loop, struct aura_node *node);
 
@@ -12,8 +12,53 @@
 #define URPC_S32  '8'
 #define URPC_S64  '9'
 
+/* IEEE754 single and double precision floats */
+#define URPC_F32  'f'
+#define URPC_F64  'd'
+
 #define URPC_BIN  's'
 
 #define URPC_BUF  'b'
 
+/* Counted array of scalars: a<type><count>. e.g. a7512. for 512 int16_t */
+#define URPC_ARRAY 'a'
+
+/*
+ * Variable-size binary data of at most max bytes: v<max>. and V<max>.
+ * On the wire it's a u8 (v) or u16 (V) length followed by that many bytes.
+ */
+#define URPC_VBIN8  'v'
+#define URPC_VBIN16 'V'
+
+#define URPC_IS_VBIN(t) ((t) == URPC_VBIN8 || (t) == URPC_VBIN16)
+
+/** A single field of a compiled format, see aura_fmt_compile() */
+struct aura_fmt_op {
+	/** URPC_* token */
+	char	type;
+	/** The field needs byte-swapping if the node's endianness differs from ours */
+	bool	swap;
+	/** Element type and count of an array field, see URPC_ARRAY.
+	 * Maximum data length of a variable-size field */
+	char	elem;
+	int	count;
+	/** Size of the field in bytes, the maximum one for variable-size fields */
+	int	size;
+	/** Offset of the field from the start of the payload, assuming all the
+	 * variable-size fields before it are of their maximum size */
+	int	offset;
+};
+
+/** A format string compiled into a flat array of fields */
+struct aura_fmt_plan {
+	/** Number of fields */
+	int			num_ops;
+	/** Total size of the payload in bytes, the maximum one if variable */
+	int			len;
+	/** The format has variable-size fields, so the actual size of the payload
+	 * and the offsets of the fields vary from message to message */
+	bool			variable;
+	struct aura_fmt_op	ops[];
+};
+
 #endif
@@ -0,0 +1,35 @@
+#ifndef _HUGEPAGE_BUFFER_ALLOCATOR_H
+#define _HUGEPAGE_BUFFER_ALLOCATOR_H
+
+#include <aura/buffer_allocator.h>
+
+/* Buffers are carved out of regions of one huge page, 2^AURA_HUGEPAGE_SHIFT bytes.
+ * Must be a huge page size the system supports */
+#ifndef AURA_HUGEPAGE_SHIFT
+#define AURA_HUGEPAGE_SHIFT 21
+#endif
+#define AURA_HUGEPAGE_REGION_SIZE ((size_t) 1 << AURA_HUGEPAGE_SHIFT)
+
+/** Counters of a node's hugepage allocator, see aura_hugepage_allocator_get_stats() */
+struct aura_hugepage_allocator_stats {
+	/** Regions mapped so far */
+	int	regions;
+	/** Regions backed by reserved (MAP_HUGETLB) huge pages, the rest ask for transparent ones */
+	int	hugetlb_regions;
+	/** Bytes mapped: the regions and the buffers too large for them */
+	size_t	mapped;
+	/** All the memory mapped so far is locked with mlock(). False until something is
+	 * mapped, and for good once mlock() fails, e.g. due to RLIMIT_MEMLOCK */
+	bool	locked;
+	/** Buffers handed out */
+	int	buffers;
+};
+
+extern struct aura_buffer_allocator g_aura_hugepage_buffer_allocator;
+extern struct aura_buffer_allocator g_aura_hugepage_locked_buffer_allocator;
+
+#define AURA_NODE_HUGEPAGE_BUFFER_ALLOCATOR &g_aura_hugepage_buffer_allocator
+
+int aura_hugepage_allocator_get_stats(struct aura_node *node, struct aura_hugepage_allocator_stats *stats);
+
+#endif
@@ -226,6 +226,23 @@ static inline void list_splice_init(struct list_head *list,
 	}
 }
 
+/**
+ * list_splice_tail_init - join two lists, adding the new one to the tail
+ * of the first and reinitialise the emptied list.
+ * @list: the new list to add.
+ * @head: the first list.
+ *
+ * The list at @list is reinitialised
+ */
+static inline void list_splice_tail_init(struct list_head *list,
+					 struct list_head *head)
+{
+	if (!list_empty(list)) {
+		__list_splice(list, head->prev);
+		INIT_LIST_HEAD(list);
+	}
+}
+
 /**
  * list_entry - get the struct for this entry
  * @ptr:	the &struct list_head pointer.
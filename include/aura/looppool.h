@@ -0,0 +1,35 @@
+#ifndef AURA_LOOPPOOL_H
+#define AURA_LOOPPOOL_H
+
+struct aura_node;
+struct aura_eventloop;
+struct aura_looppool;
+
+/** \addtogroup loop
+ *  @{
+ */
+
+/**
+ * How aura_looppool_add() picks a loop for a node
+ */
+enum aura_looppool_placement {
+	AURA_LOOPPOOL_HASH,		//!< By the hash of the supplied key (or node address)
+	AURA_LOOPPOOL_LEAST_LOADED,	//!< The loop with the least nodes
+};
+
+/**
+ * @}
+ */
+
+struct aura_looppool *aura_looppool_create(int numloops, const int *cpus, enum aura_looppool_placement placement);
+void aura_looppool_destroy(struct aura_looppool *pool);
+int aura_looppool_add(struct aura_looppool *pool, struct aura_node *node, const char *key);
+int aura_looppool_migrate(struct aura_looppool *pool, struct aura_node *node, int idx);
+void aura_looppool_del(struct aura_looppool *pool, struct aura_node *node);
+void aura_looppool_close(struct aura_looppool *pool, struct aura_node *node);
+int aura_looppool_size(struct aura_looppool *pool);
+int aura_looppool_load(struct aura_looppool *pool, int idx);
+int aura_looppool_node_index(struct aura_looppool *pool, struct aura_node *node);
+struct aura_eventloop *aura_looppool_get_loop(struct aura_looppool *pool, int idx);
+
+#endif /* end of include guard: AURA_LOOPPOOL_H */
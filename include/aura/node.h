@@ -6,6 +6,16 @@ struct aura_node;
 const char *aura_node_call_strerror(int errcode);
 
 void aura_bufferpool_preheat(struct aura_node *nd, int size, int count);
+void aura_bufferpool_gc(struct aura_node *nd, int numdrop, int threshold);
+void aura_bufferpool_set_gc_threshold(struct aura_node *nd, int threshold);
+int aura_bufferpool_set_class_gc_threshold(struct aura_node *nd, int size, int threshold);
+int aura_bufferpool_get_stats(struct aura_node *nd, int size, struct aura_bufferpool_stats *stats);
+int aura_bufferpool_set_adaptive_gc(struct aura_node *nd, const struct aura_bufferpool_gc_params *params);
+void aura_bufferpool_gc_tick(struct aura_node *nd);
+void aura_bufferpool_global_enable(bool enable);
+void aura_bufferpool_global_set_limit(int max_buffers);
+int aura_bufferpool_global_get_stats(int size, struct aura_bufferpool_stats *stats);
+void aura_bufferpool_global_drain(void);
 
 struct aura_node *aura_open(const char *name, const char *opts);
 void aura_close(struct aura_node *dev);
@@ -15,10 +25,56 @@ int aura_start_call_raw(struct aura_node *dev, int id, void (*calldonecb)(struct
 
 int aura_start_call(struct aura_node *dev, const char *name, void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg), void *arg, ...);
 
+int aura_start_call_deadline(struct aura_node *dev, const char *name, int timeout_ms, void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg), void *arg, ...);
+
+int aura_start_call_handle(struct aura_node *dev, const char *name, struct aura_call_handle *handle, void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg), void *arg, ...);
+int aura_call_cancel(struct aura_call_handle *handle);
+int aura_object_set_coalescing(struct aura_node *node, const char *name, bool enable);
+
+int aura_start_call_prio(struct aura_node *dev, const char *name, int prio, void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg), void *arg, ...);
+
+struct aura_call_batch *aura_call_batch_begin(struct aura_node *node, void (*batchdonecb)(struct aura_node *node, int numfailed, void *arg), void *arg);
+int aura_call_batch_add_raw(struct aura_call_batch *batch, int id, void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg), void *arg, ...);
+int aura_call_batch_add(struct aura_call_batch *batch, const char *name, void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg), void *arg, ...);
+int aura_call_batch_submit(struct aura_call_batch *batch);
+void aura_call_batch_discard(struct aura_call_batch *batch);
+
+struct aura_future *aura_call_async(struct aura_node *node, const char *name, ...);
+int aura_future_wait(struct aura_future *future, int timeout_ms);
+int aura_future_wait_all(struct aura_future **futures, int count, int timeout_ms);
+int aura_future_wait_any(struct aura_future **futures, int count, int timeout_ms);
+bool aura_future_done(struct aura_future *future);
+int aura_future_status(struct aura_future *future);
+struct aura_buffer *aura_future_retbuf(struct aura_future *future);
+void aura_future_release(struct aura_future *future);
+
 int aura_call_raw(struct aura_node *dev, int id, struct aura_buffer **ret, ...);
 
 int aura_call(struct aura_node *dev, const char *name, struct aura_buffer **ret, ...);
 
+int aura_call_struct(struct aura_node *node, int id, const void *arg_struct, void *ret_struct);
+int aura_call_values(struct aura_node *node, int id, const struct aura_value *args, int n,
+		     struct aura_value *rets);
+int aura_call_buffer(struct aura_node *node, int id, struct aura_buffer **retbuf, struct aura_buffer *buf);
+int aura_object_set_struct_layout(struct aura_node *node, const char *name,
+				  const size_t *arg_offsets, const size_t *ret_offsets);
+
+int aura_call_timeout(struct aura_node *dev, const char *name, int timeout_ms, struct aura_buffer **ret, ...);
+
+void aura_set_call_timeout(struct aura_node *node, int timeout_ms);
+void aura_set_late_response_window(struct aura_node *node, int window_ms);
+
+int aura_object_set_cache(struct aura_node *node, const char *name, int ttl_ms);
+int aura_cache_invalidate(struct aura_node *node, const char *name);
+int aura_get_cache_stats(struct aura_node *node, const char *name, struct aura_cache_stats *stats);
+
+void aura_set_outbound_limits(struct aura_node *node, int max_count, size_t max_bytes);
+void aura_outbound_watermark_cb(struct aura_node *node, int high, int low, void (*cb)(struct aura_node *node, bool congested, void *arg), void *arg);
+void aura_set_outbound_blocking(struct aura_node *node, bool block);
+void aura_get_outbound_stats(struct aura_node *node, struct aura_queue_stats *stats, bool reset_hwm);
+int aura_object_set_priority(struct aura_node *node, const char *name, int prio);
+void aura_set_outbound_starve_limit(struct aura_node *node, int limit);
+
 int aura_set_event_callback_raw(struct aura_node *node, int id, void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg), void *arg);
 
 int aura_set_event_callback(struct aura_node *node, const char *event, void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg), void *arg);
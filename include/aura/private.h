@@ -22,8 +22,65 @@ int aura_core_call (struct aura_node *node,
 		    struct aura_buffer *argbuf);
 
 
+/* Pending call table */
+struct aura_call_slot *aura_call_slot_get(struct aura_node *node,
+					  struct aura_object *o,
+					  void (*calldonecb)(struct aura_node *dev, int status,
+							     struct aura_buffer *ret, void *arg),
+					  void *arg);
+void aura_call_slot_put(struct aura_node *node, struct aura_call_slot *slot);
+struct aura_call_slot *aura_call_slot_find(struct aura_node *node, struct aura_buffer *buf);
+struct aura_call_slot *aura_call_slot_find_sent(struct aura_node *node, struct aura_object *o);
+void aura_call_slot_sent(struct aura_node *node, struct aura_call_slot *slot);
+void aura_call_slot_complete(struct aura_node *node, struct aura_call_slot *slot,
+			     int status, struct aura_buffer *buf);
+void aura_call_slot_attach(struct aura_call_slot *slot, struct aura_buffer *buf);
+int aura_call_slot_reclaim(struct aura_node *node, struct aura_call_slot *slot);
+int aura_call_slot_cancel(struct aura_node *node, struct aura_call_slot *slot);
+void aura_call_slot_expire(struct aura_node *node, struct aura_call_slot *slot);
+void aura_call_slot_answered(struct aura_node *node, struct aura_call_slot *slot, struct aura_buffer *buf);
+struct aura_call_slot *aura_call_slot_find_leader(struct aura_node *node, struct aura_object *o,
+						  struct aura_buffer *buf);
+void aura_call_slot_lead(struct aura_node *node, struct aura_call_slot *slot, struct aura_buffer *buf);
+void aura_call_slot_follow(struct aura_call_slot *leader, struct aura_call_slot *slot);
+void aura_call_slot_set_deadline(struct aura_node *node, struct aura_call_slot *slot, int timeout_ms);
+void aura_call_table_fail_all(struct aura_node *node);
+void aura_call_table_destroy(struct aura_node *node);
+void aura_call_batch_call_done(struct aura_call_batch *batch, int status);
+void aura_call_batch_call_drop(struct aura_call_batch *batch);
+int aura_core_start_call_future(struct aura_node *node, struct aura_object *o,
+				struct aura_future *future, struct aura_buffer *buf);
+void aura_future_complete(struct aura_future *future, int status, struct aura_buffer *buf);
+void aura_future_drop(struct aura_future *future);
+void aura_future_pool_destroy(struct aura_node *node);
+void aura_eventloop_xcall_process(struct aura_eventloop *loop);
+void aura_eventloop_process_wakeup(struct aura_eventloop *loop);
+void aura_eventloop_xcall_cleanup(struct aura_eventloop *loop);
+
 uint64_t aura_platform_timestamp();
 
+/* Buffer pool size class of a buffer of size bytes, -1 if it's too large to be pooled */
+static inline int aura_bufferpool_class(int size)
+{
+	int shift;
+
+	if (size <= (1 << AURA_BUFFER_POOL_MIN_SHIFT))
+		return 0;
+	shift = 32 - __builtin_clz(size - 1);
+	if (shift > AURA_BUFFER_POOL_MAX_SHIFT)
+		return -1;
+	return shift - AURA_BUFFER_POOL_MIN_SHIFT;
+}
+
+static inline int aura_bufferpool_class_size(int cls)
+{
+	return 1 << (cls + AURA_BUFFER_POOL_MIN_SHIFT);
+}
+
+void aura_bufferpool_init(struct aura_node *nd);
+bool aura_globalpool_enabled(void);
+struct aura_buffer *aura_globalpool_get(int cls);
+void aura_globalpool_put(struct aura_buffer *buf);
 int aura_node_buffer_pool_gc_once(struct aura_node *pos);
 int aura_node_buffer_pool_gc_full(struct aura_node *pos);
 
@@ -47,4 +104,18 @@ struct aura_buffer *aura_node_queue_read(struct aura_node *node,
 void aura_node_dispatch_event(struct aura_node *node, enum node_event event, const struct aura_pollfds *fd);
 void aura_node_write(struct aura_node *node, struct aura_buffer *buf);
 struct aura_buffer *aura_node_read(struct aura_node *node);
+struct aura_buffer *aura_node_peek(struct aura_node *node);
+void aura_node_requeue(struct aura_node *node, struct aura_buffer *buf);
+bool aura_node_outbound_full(struct aura_node *node, int count, size_t bytes);
+void aura_node_outbound_queue(struct aura_node *node, struct aura_buffer *buf);
+void aura_node_outbound_remove(struct aura_node *node, struct aura_buffer *buf);
+void aura_node_outbound_flush(struct aura_node *node, bool destroy);
+bool aura_node_outbound_empty(struct aura_node *node);
+
+struct aura_cache_entry;
+struct aura_buffer *aura_cache_lookup(struct aura_node *node, struct aura_object *o,
+				      struct aura_buffer *argbuf, struct aura_cache_entry **entry);
+void aura_cache_store(struct aura_node *node, struct aura_object *o,
+		      struct aura_cache_entry *entry, int status, struct aura_buffer *retbuf);
+void aura_cache_flush(struct aura_object *o);
 #endif
@@ -0,0 +1,50 @@
+#ifndef AURA_XCALL_H
+#define AURA_XCALL_H
+
+#include <aura/list.h>
+
+struct aura_node;
+struct aura_object;
+struct aura_buffer;
+struct aura_eventloop;
+struct aura_export_table;
+struct aura_xcall_cq;
+
+/** \addtogroup xcall
+ *  @{
+ */
+
+/**
+ * A call submitted to a node from a thread other than the one running
+ * node's eventloop.
+ */
+struct aura_xcall {
+	/** AURA_CALL_* status of the call or a negative error code if it could not be started */
+	int			status;
+	/** Response buffer (if any). Valid until aura_xcall_release() */
+	struct aura_buffer *	retbuf;
+	/** User argument passed to aura_xcall_submit() */
+	void *			arg;
+
+	/* Private */
+	struct aura_node *	node;
+	struct aura_object *	object;
+	struct aura_export_table *tbl;
+	struct aura_buffer *	argbuf;
+	struct aura_xcall_cq *	cq;
+	struct list_head	qentry;
+};
+
+/**
+ * @}
+ */
+
+int aura_eventloop_xcall_enable(struct aura_eventloop *loop, int size);
+int aura_xcall_submit(struct aura_node *node, const char *name, struct aura_xcall_cq *cq, void *arg, ...);
+void aura_xcall_release(struct aura_xcall *xc);
+
+struct aura_xcall_cq *aura_xcall_cq_create(void);
+void aura_xcall_cq_destroy(struct aura_xcall_cq *cq);
+struct aura_xcall *aura_xcall_cq_wait(struct aura_xcall_cq *cq, int timeout_ms);
+
+#endif /* end of include guard: AURA_XCALL_H */
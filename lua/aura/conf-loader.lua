@@ -2,6 +2,18 @@ function BIN(v)
    return FMT_BIN..tostring(v).."."
 end
 
+function ARRAY(tp, count)
+   return FMT_ARRAY..tp..tostring(count).."."
+end
+
+function VBIN(max)
+   return FMT_VBIN8..tostring(max).."."
+end
+
+function VBIN16(max)
+   return FMT_VBIN16..tostring(max).."."
+end
+
 function NONE(name)
    return { name, UINT16..UINT16, ""}
 end
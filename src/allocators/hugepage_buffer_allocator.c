@@ -0,0 +1,257 @@
+#include <aura/aura.h>
+#include <aura/hugepage_buffer_allocator.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/*
+ * Arena allocator. Buffers are carved out of huge page sized regions, one size
+ * class (slab) per power of two of the data size. Released buffers are kept on
+ * their class free list and are only unmapped along with the whole arena.
+ * Buffers too large for a region get a mapping of their own.
+ */
+
+#define SLAB_MIN_SHIFT	5
+#define SLAB_MAX_SHIFT	(AURA_HUGEPAGE_SHIFT - 3)
+#define SLAB_CLASSES	(SLAB_MAX_SHIFT - SLAB_MIN_SHIFT + 1)
+#define CHUNK_ALIGN	64
+
+struct hugepage_chunk {
+	/* Slab class, -1 for a buffer with a mapping of its own */
+	int			cls;
+	/* Length of the own mapping */
+	size_t			len;
+	struct aura_buffer	buf;
+} __attribute__((aligned(CHUNK_ALIGN)));
+
+struct hugepage_region {
+	void *			base;
+	struct list_head	qentry;
+};
+
+struct hugepage_arena {
+	bool					lock;
+	/* Some mapping could not be locked */
+	bool					lock_failed;
+	struct list_head			regions;
+	/* Free space of the newest region */
+	char *					next;
+	char *					end;
+	/* Free chunks of each class, linked via buf.qentry */
+	struct list_head			free[SLAB_CLASSES];
+	struct aura_hugepage_allocator_stats	stats;
+};
+
+static int slab_class(int size)
+{
+	int shift = SLAB_MIN_SHIFT;
+
+	while ((1 << shift) < size)
+		shift++;
+	return (shift > SLAB_MAX_SHIFT) ? -1 : shift - SLAB_MIN_SHIFT;
+}
+
+static size_t chunk_size(int cls)
+{
+	size_t len = sizeof(struct hugepage_chunk) + (1 << (cls + SLAB_MIN_SHIFT));
+
+	return (len + CHUNK_ALIGN - 1) & ~(size_t) (CHUNK_ALIGN - 1);
+}
+
+/* Map len bytes, a multiple of the region size, with huge pages if we can get them */
+static void *arena_map(struct hugepage_arena *a, size_t len, bool *hugetlb)
+{
+	void *p = MAP_FAILED;
+
+	*hugetlb = false;
+#ifdef MAP_HUGETLB
+	p = mmap(NULL, len, PROT_READ | PROT_WRITE,
+		 MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB
+#ifdef MAP_HUGE_SHIFT
+		 | (AURA_HUGEPAGE_SHIFT << MAP_HUGE_SHIFT)
+#endif
+		 , -1, 0);
+	*hugetlb = (p != MAP_FAILED);
+#endif
+
+	if (p == MAP_FAILED) {
+		/* No reserved huge pages. Align to one so that transparent huge pages can kick in */
+		size_t slack = AURA_HUGEPAGE_REGION_SIZE;
+		char *raw = mmap(NULL, len + slack, PROT_READ | PROT_WRITE,
+				 MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		size_t head;
+
+		if (raw == MAP_FAILED)
+			return NULL;
+		head = -(uintptr_t) raw & (AURA_HUGEPAGE_REGION_SIZE - 1);
+		if (head)
+			munmap(raw, head);
+		if (slack - head)
+			munmap(raw + head + len, slack - head);
+		p = raw + head;
+#ifdef MADV_HUGEPAGE
+		madvise(p, len, MADV_HUGEPAGE);
+#endif
+	}
+
+	if (a->lock && mlock(p, len)) {
+		slog(1, SLOG_WARN, "hugepage: Failed to lock %zu bytes: %s", len, strerror(errno));
+		a->lock_failed = true;
+	}
+	a->stats.locked = a->lock && !a->lock_failed;
+	a->stats.mapped += len;
+	slog(4, SLOG_DEBUG, "hugepage: Mapped %zu bytes at %p (%s)",
+	     len, p, *hugetlb ? "hugetlb" : "thp");
+	return p;
+}
+
+static bool arena_grow(struct hugepage_arena *a)
+{
+	struct hugepage_region *r = malloc(sizeof(*r));
+	bool hugetlb;
+
+	if (!r)
+		return false;
+	r->base = arena_map(a, AURA_HUGEPAGE_REGION_SIZE, &hugetlb);
+	if (!r->base) {
+		free(r);
+		return false;
+	}
+	list_add_tail(&r->qentry, &a->regions);
+	a->next = r->base;
+	a->end = a->next + AURA_HUGEPAGE_REGION_SIZE;
+	a->stats.regions++;
+	if (hugetlb)
+		a->stats.hugetlb_regions++;
+	return true;
+}
+
+static void *arena_create(struct aura_node *node, bool lock)
+{
+	struct hugepage_arena *a = calloc(1, sizeof(*a));
+	int i;
+
+	if (!a)
+		BUG(node, "Memory allocation failure");
+
+	a->lock = lock;
+	INIT_LIST_HEAD(&a->regions);
+	for (i = 0; i < SLAB_CLASSES; i++)
+		INIT_LIST_HEAD(&a->free[i]);
+	return a;
+}
+
+static void *hugepage_alloc_create(struct aura_node *node)
+{
+	return arena_create(node, false);
+}
+
+static void *hugepage_locked_alloc_create(struct aura_node *node)
+{
+	return arena_create(node, true);
+}
+
+static void hugepage_alloc_destroy(struct aura_node *node, void *data)
+{
+	struct hugepage_arena *a = data;
+	struct hugepage_region *pos, *tmp;
+
+	if (a->stats.buffers)
+		slog(0, SLOG_WARN, "hugepage: %d buffers are still out", a->stats.buffers);
+
+	list_for_each_entry_safe(pos, tmp, &a->regions, qentry) {
+		munmap(pos->base, AURA_HUGEPAGE_REGION_SIZE);
+		free(pos);
+	}
+	free(a);
+}
+
+static struct aura_buffer *hugepage_buffer_request(struct aura_node *node, void *data, int size)
+{
+	struct hugepage_arena *a = data;
+	struct hugepage_chunk *chunk;
+	int cls = slab_class(size);
+
+	if (cls < 0) {
+		size_t len = sizeof(*chunk) + size;
+		bool hugetlb;
+
+		len = (len + AURA_HUGEPAGE_REGION_SIZE - 1) & ~(AURA_HUGEPAGE_REGION_SIZE - 1);
+		chunk = arena_map(a, len, &hugetlb);
+		if (!chunk)
+			return NULL;
+		chunk->len = len;
+	} else if (!list_empty(&a->free[cls])) {
+		chunk = list_entry(a->free[cls].next, struct hugepage_chunk, buf.qentry);
+		list_del(&chunk->buf.qentry);
+	} else {
+		/* Whatever is left of the region is too small, start a new one */
+		if (((size_t) (a->end - a->next) < chunk_size(cls)) && !arena_grow(a))
+			return NULL;
+		chunk = (struct hugepage_chunk *) a->next;
+		a->next += chunk_size(cls);
+	}
+
+	chunk->cls = cls;
+	chunk->buf.data = (char *) (chunk + 1);
+	a->stats.buffers++;
+	return &chunk->buf;
+}
+
+static void hugepage_buffer_release(struct aura_node *node, void *data, struct aura_buffer *buf)
+{
+	struct hugepage_arena *a = data;
+	struct hugepage_chunk *chunk = container_of(buf, struct hugepage_chunk, buf);
+
+	a->stats.buffers--;
+	if (chunk->cls < 0) {
+		a->stats.mapped -= chunk->len;
+		munmap(chunk, chunk->len);
+	} else {
+		list_add(&buf->qentry, &a->free[chunk->cls]);
+	}
+}
+
+struct aura_buffer_allocator g_aura_hugepage_buffer_allocator = {
+	.name		= "hugepage",
+	.create		= hugepage_alloc_create,
+	.request	= hugepage_buffer_request,
+	.release	= hugepage_buffer_release,
+	.destroy	= hugepage_alloc_destroy
+};
+AURA_BUFFER_ALLOCATOR(g_aura_hugepage_buffer_allocator);
+
+/* The same, with all the memory locked for latency-sensitive deployments */
+struct aura_buffer_allocator g_aura_hugepage_locked_buffer_allocator = {
+	.name		= "hugepage-locked",
+	.create		= hugepage_locked_alloc_create,
+	.request	= hugepage_buffer_request,
+	.release	= hugepage_buffer_release,
+	.destroy	= hugepage_alloc_destroy
+};
+AURA_BUFFER_ALLOCATOR(g_aura_hugepage_locked_buffer_allocator);
+
+/** \addtogroup bufapi
+ * @{
+ */
+
+/**
+ * Get the counters of the node's hugepage allocator, see aura_node_set_buffer_allocator()
+ *
+ * @param node
+ * @param stats Where to put the counters
+ * @return 0 on success, -EINVAL if the node doesn't use the hugepage allocator
+ */
+int aura_hugepage_allocator_get_stats(struct aura_node *node, struct aura_hugepage_allocator_stats *stats)
+{
+	struct hugepage_arena *a = aura_node_allocatordata_get(node);
+
+	if ((node->allocator != &g_aura_hugepage_buffer_allocator) &&
+	    (node->allocator != &g_aura_hugepage_locked_buffer_allocator))
+		return -EINVAL;
+	*stats = a->stats;
+	return 0;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,121 @@
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <aura/list.h>
+#include <aura/aura.h>
+#include <aura/private.h>
+#include <aura/buffer_allocator.h>
+
+static LIST_HEAD(allocators);
+static struct aura_buffer_allocator *current_allocator;
+
+void aura_buffer_allocator_register(struct aura_buffer_allocator *a)
+{
+	list_add_tail(&a->linkage, &allocators);
+}
+
+/**
+ * Find a registered buffer allocator by name
+ *
+ * @param name allocator name
+ * @return the allocator or NULL if there's no such thing
+ */
+struct aura_buffer_allocator *aura_buffer_allocator_lookup(const char *name)
+{
+	struct aura_buffer_allocator *pos;
+
+	list_for_each_entry(pos, &allocators, linkage)
+	if (strcmp(pos->name, name) == 0)
+		return pos;
+	return NULL;
+}
+
+/**
+ * Retrieve the buffer allocator new nodes get
+ *
+ * @return the allocator, NULL for malloc()
+ */
+struct aura_buffer_allocator *aura_buffer_allocator_get(void)
+{
+	return current_allocator;
+}
+
+/** \addtogroup bufapi
+ * @{
+ */
+
+/**
+ * Select the buffer allocator for the nodes opened from now on. Available: malloc
+ * (the default), hugepage, hugepage-locked. Nodes of transports that need their
+ * own allocator keep it.
+ *
+ * The AURA_USE_ALLOCATOR environment variable does the same at startup.
+ *
+ * @param name allocator name, NULL or "malloc" for the default
+ * @return 0 on success, -ENOENT if there's no such allocator
+ */
+int aura_buffer_allocator_select(const char *name)
+{
+	struct aura_buffer_allocator *a = NULL;
+
+	if (name && strcmp(name, "malloc")) {
+		a = aura_buffer_allocator_lookup(name);
+		if (!a)
+			return -ENOENT;
+	}
+	current_allocator = a;
+	return 0;
+}
+
+/**
+ * Switch the node to another buffer allocator. This is only possible while all
+ * the buffers of the node are released, e.g. right after it goes online.
+ * The free buffers of the node's pool are released to the old allocator.
+ *
+ * @param node
+ * @param name allocator name, NULL or "malloc" for the default
+ * @return 0 on success, -ENOENT if there's no such allocator, -EPERM if the node's
+ *         transport needs its own one, -EBUSY if the node has buffers out,
+ *         -ENOMEM if the allocator failed to initialize
+ */
+int aura_node_set_buffer_allocator(struct aura_node *node, const char *name)
+{
+	struct aura_buffer_allocator *a = NULL;
+	void *data = NULL;
+
+	if (name && strcmp(name, "malloc")) {
+		a = aura_buffer_allocator_lookup(name);
+		if (!a)
+			return -ENOENT;
+	}
+	if (node->tr->allocator)
+		return -EPERM;
+	if (node->num_buffers_out)
+		return -EBUSY;
+
+	if (a) {
+		data = a->create(node);
+		if (!data)
+			return -ENOMEM;
+	}
+
+	aura_bufferpool_gc(node, -1, 0);
+	if (node->allocator_data)
+		node->allocator->destroy(node, node->allocator_data);
+	node->allocator = a;
+	node->allocator_data = data;
+	node->global_buffer_pool = !a && aura_globalpool_enabled();
+	return 0;
+}
+
+/**
+ * @}
+ */
+
+static void __attribute__((constructor (102))) init_allocator_factory()
+{
+	char *name = getenv("AURA_USE_ALLOCATOR");
+
+	if (name && aura_buffer_allocator_select(name))
+		slog(0, SLOG_WARN, "No such buffer allocator: %s, check env variable AURA_USE_ALLOCATOR", name);
+}
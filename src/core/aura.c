@@ -131,6 +131,7 @@ struct aura_node *aura_open(const char *name, const char *opts)
 {
 	struct aura_node *node = calloc(1, sizeof(*node));
 	int ret = 0;
+	int i;
 
 	if (!node)
 		return NULL;
@@ -141,21 +142,32 @@ struct aura_node *aura_open(const char *name, const char *opts)
 		goto err_free_node;
 	}
 
-	INIT_LIST_HEAD(&node->outbound_buffers);
+	for (i = 0; i < AURA_CALL_PRIO_COUNT; i++)
+		INIT_LIST_HEAD(&node->outbound_queues[i]);
 	INIT_LIST_HEAD(&node->inbound_buffers);
 	INIT_LIST_HEAD(&node->event_buffers);
-	INIT_LIST_HEAD(&node->buffer_pool);
 	INIT_LIST_HEAD(&node->timer_list);
 	INIT_LIST_HEAD(&node->fd_list);
+	INIT_LIST_HEAD(&node->pending_calls);
+	INIT_LIST_HEAD(&node->call_slot_pool);
+	INIT_LIST_HEAD(&node->call_deadlines);
+	INIT_LIST_HEAD(&node->future_pool);
 
 	node->gc_threshold = 10; /* This should be more than enough */
+	aura_bufferpool_init(node);
+	/* Transports that need their own allocator get it, the rest the selected one */
+	node->allocator = node->tr->allocator ? node->tr->allocator : aura_buffer_allocator_get();
+	/* Custom allocators keep their memory to themselves */
+	node->global_buffer_pool = !node->allocator && aura_globalpool_enabled();
+	node->outbound_starve_limit = 8;
+	node->late_response_window_ms = 1000;
 
 	node->status = AURA_STATUS_OFFLINE;
 
-	if (node->tr->allocator) {
-		node->allocator_data = node->tr->allocator->create(node);
+	if (node->allocator) {
+		node->allocator_data = node->allocator->create(node);
 		if (!node->allocator_data) {
-			slog(0, SLOG_ERROR, "Failed to initialize transport-specific buffer allocator");
+			slog(0, SLOG_ERROR, "Failed to initialize buffer allocator %s", node->allocator->name);
 			goto err_free_node;
 		}
 	}
@@ -214,16 +226,18 @@ void aura_close(struct aura_node *node)
 	/* After transport shutdown we need to clean up
 	 * remaining buffers */
 	cleanup_buffer_queue(&node->inbound_buffers, true);
-	cleanup_buffer_queue(&node->outbound_buffers, true);
+	aura_node_outbound_flush(node, true);
 	cleanup_buffer_queue(&node->event_buffers, true);
-	cleanup_buffer_queue(&node->buffer_pool, true);
+	aura_bufferpool_gc(node, -1, 0);
+	aura_call_table_destroy(node);
+	aura_future_pool_destroy(node);
 
 	if (node->tr->close)
 		node->tr->close(node);
 
 	/* Destroy the memory allocator, if any */
 	if (node->allocator_data)
-		node->tr->allocator->destroy(node, node->allocator_data);
+		node->allocator->destroy(node, node->allocator_data);
 
 	/* Nuke all running timers */
 	struct aura_timer *pos;
@@ -266,32 +280,42 @@ void aura_node_write(struct aura_node *node, struct aura_buffer *buf)
 	node->current_object = o;
 	aura_buffer_rewind(buf);
 
-	/* Set the payload size accordingly */
-	buf->payload_size = o->retlen;
+	/*
+	 * Set the payload size accordingly. Responses of variable size are as
+	 * long as the transport says, it's up to it to set the payload size
+	 */
+	if (!o->ret_plan || !o->ret_plan->variable || !buf->payload_size)
+		buf->payload_size = o->retlen;
 
 	slog(4, SLOG_DEBUG, "Handling %s id %d (%s) sync_call_running=%d",
 	     object_is_method(o) ? "response" : "event",
 	     o->id, o->name, node->sync_call_running);
 
+	/* Whatever comes from the node must fit in the buffer it came in */
+	if (o->ret_plan && aura_deserialize_check(buf, o->ret_plan)) {
+		struct aura_call_slot *slot = object_is_method(o) ? aura_call_slot_find(node, buf) : NULL;
+
+		slog(0, SLOG_WARN, "Dropping malformed %s %d (%s)",
+		     object_is_method(o) ? "response" : "event", o->id, o->name);
+		if (slot)
+			aura_call_slot_complete(node, slot, AURA_CALL_TRANSPORT_FAIL, NULL);
+		aura_buffer_release(buf);
+		return;
+	}
+
 	if (object_is_method(o)) {
-		if (!o->pending) {
+		struct aura_call_slot *slot = aura_call_slot_find(node, buf);
+
+		if (!slot) {
 			slog(0, SLOG_WARN, "Dropping orphan call result %d (%s)",
 			     o->id, o->name);
 			aura_buffer_release(buf);
-		} else if (o->calldonecb) {
-			slog(4, SLOG_DEBUG, "Callback for method/event %d (%s)",
-			     o->id, o->name);
-			o->calldonecb(node, AURA_CALL_COMPLETED, buf, o->arg);
-			aura_buffer_release(buf);
-		} else if (node->sync_call_running) {
-			slog(4, SLOG_DEBUG, "Completing call for method %d (%s)",
-			     o->id, o->name);
-			node->sync_call_result = AURA_CALL_COMPLETED;
-			node->sync_ret_buf = buf;
+		} else {
+			slog(4, SLOG_DEBUG, "Completing call %u for method %d (%s)",
+			     slot->tag, o->id, o->name);
+			aura_call_slot_answered(node, slot, buf);
+			aura_call_slot_complete(node, slot, AURA_CALL_COMPLETED, buf);
 		}
-		o->pending--;
-		if (o->pending < 0)
-			BUG(node, "Internal BUG: pending evt count lesser than zero");
 	} else {
 		/* This one is tricky. We have an event with no callback */
 		if (o->calldonecb) {
@@ -417,6 +441,7 @@ void aura_etable_changed_cb(struct aura_node *								node,
 /**
  * Set up a generic callback to catch all events that have no callbacks installed.
  * Warning: This callback will not be called if you enable synchronous event processing
+ * The callback may keep the buffer with aura_buffer_ref(), just like event callbacks.
  *
  * @param node
  * @param cb The callback function to call
@@ -442,6 +467,7 @@ void aura_unhandled_evt_cb(struct aura_node *						node,
  * When a node goes offline and online aura will try to migrate all the callbacks to a
  * newly created export table
  * Warning: This callback will not be called if you enable synchronous event processing
+ * The callback may keep the buffer with aura_buffer_ref(), just like event callbacks.
  *
  * @param node
  * @param cb The callback function to call
@@ -457,25 +483,19 @@ void aura_object_migration_failed_cb(struct aura_node *						node,
 	node->object_migration_failed_arg = arg;
 }
 
-/**
- * Start a call for object obj for node @node.
- * Normally you do not need this function - use aura_call() and aura_call_raw()
- * synchronous calls and aura_start_call() and aura_start_call_raw() for async.
- *
- * @param node
- * @param o
- * @param calldonecb
- * @param arg
- * @param buf
- * @return
- */
-int aura_core_start_call(struct aura_node *node,
-			 struct aura_object *o,
-			 void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
-			 void *arg,
-			 struct aura_buffer *buf)
+static int start_call(struct aura_node *node,
+		      struct aura_object *o,
+		      void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+		      void *arg,
+		      struct aura_buffer *buf,
+		      int timeout_ms,
+		      struct aura_future *future,
+		      struct aura_call_handle *handle,
+		      bool sync)
 {
 	struct aura_eventloop *loop = aura_node_eventloop_get_autocreate(node);
+	struct aura_call_slot *leader;
+	struct aura_call_slot *slot;
 
 	if (!o)
 		return -EBADSLT;
@@ -483,19 +503,41 @@ int aura_core_start_call(struct aura_node *node,
 	if (node->status != AURA_STATUS_ONLINE)
 		return -ENOEXEC;
 
-	if (o->pending)
-		return -EIO;
-
 	if (!loop)
 		BUG(node, "Node has no assosiated event system. Fix your code!");
 
-	o->calldonecb = calldonecb;
-	o->arg = arg;
+	leader = o->coalesce ? aura_call_slot_find_leader(node, o, buf) : NULL;
+
+	if (!leader && aura_node_outbound_full(node, 1, buf->size))
+		return -EAGAIN;
+
+	slot = aura_call_slot_get(node, o, calldonecb, arg);
+	slot->future = future;
+	if (timeout_ms > 0)
+		aura_call_slot_set_deadline(node, slot, timeout_ms);
+	if (handle) {
+		handle->node = node;
+		handle->slot = slot;
+		handle->tag = slot->tag;
+	}
+	/* Mark the call we're waiting for before the transport has a chance to complete it */
+	if (sync)
+		node->sync_call_tag = slot->tag;
+
+	/* An identical call is already on its way, just wait for its response */
+	if (leader) {
+		aura_call_slot_follow(leader, slot);
+		aura_buffer_release(buf);
+		return 0;
+	}
+
 	buf->object = o;
-	o->pending++;
+	aura_call_slot_attach(slot, buf);
+	if (o->coalesce)
+		aura_call_slot_lead(node, slot, buf);
 
-	bool is_first = list_empty(&node->outbound_buffers);
-	aura_queue_buffer(&node->outbound_buffers, buf);
+	bool is_first = aura_node_outbound_empty(node);
+	aura_node_outbound_queue(node, buf);
 	/* If this is the first buffer queued, notify transport immediately */
 	if (is_first)
 		node->tr->handle_event(node, NODE_EVENT_HAVE_OUTBOUND, NULL);
@@ -503,48 +545,149 @@ int aura_core_start_call(struct aura_node *node,
 	return 0;
 }
 
-
 /**
- * Synchronously call an object. arguments should be placed in argbuf.
- * The retbuf will be set to point to response buffer if the call succeeds.
+ * Start a call for object obj for node @node.
+ * Normally you do not need this function - use aura_call() and aura_call_raw()
+ * synchronous calls and aura_start_call() and aura_start_call_raw() for async.
+ *
+ * Any number of calls to the same object may be in flight at a time. Each one
+ * gets a slot in the node's pending call table with its own callback and argument.
  *
  * @param node
  * @param o
- * @param retbuf
- * @param argbuf
+ * @param calldonecb
+ * @param arg
+ * @param buf
+ * @return
+ */
+int aura_core_start_call(struct aura_node *node,
+			 struct aura_object *o,
+			 void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+			 void *arg,
+			 struct aura_buffer *buf)
+{
+	return start_call(node, o, calldonecb, arg, buf, node->call_timeout_ms, NULL, NULL, false);
+}
+
+/**
+ * Start a call for object o that completes the future instead of firing a callback.
+ * See aura_call_async()
  *
+ * @param node
+ * @param o
+ * @param future
+ * @param buf
  * @return
  */
-int aura_core_call(
-	struct aura_node *	node,
-	struct aura_object *	o,
-	struct aura_buffer **	retbuf,
-	struct aura_buffer *	argbuf)
+int aura_core_start_call_future(struct aura_node *node,
+				struct aura_object *o,
+				struct aura_future *future,
+				struct aura_buffer *buf)
+{
+	return start_call(node, o, NULL, NULL, buf, node->call_timeout_ms, future, NULL, false);
+}
+
+static int core_call(struct aura_node *node, struct aura_object *o,
+		     struct aura_buffer **retbuf, struct aura_buffer *argbuf,
+		     int timeout_ms)
 {
 	int ret;
 	struct aura_eventloop *loop = aura_node_eventloop_get_autocreate(node);
+	struct aura_cache_entry *entry = NULL;
 
 	if (node->sync_call_running)
 		BUG(node, "Internal bug: Synchronos call within a synchronos call");
 
+	if (o && (node->status == AURA_STATUS_ONLINE)) {
+		*retbuf = aura_cache_lookup(node, o, argbuf, &entry);
+		if (*retbuf) {
+			aura_buffer_release(argbuf);
+			return AURA_CALL_COMPLETED;
+		}
+	}
+
 	node->sync_call_running = true;
 
-	if ((ret = aura_core_start_call(node, o, NULL, NULL, argbuf))) {
+	/* Wait for some room in the outbound queue, if asked to */
+	while (node->outbound_block && (node->status == AURA_STATUS_ONLINE) &&
+	       aura_node_outbound_full(node, 1, argbuf->size))
+		aura_eventloop_dispatch(loop, AURA_EVTLOOP_ONCE);
+
+	if ((ret = start_call(node, o, NULL, NULL, argbuf, timeout_ms, NULL, NULL, true))) {
 		node->sync_call_result = ret;
+		free(entry);
 		goto bailout;
 	}
 
-	while (o->pending)
+	while (node->sync_call_tag)
 		aura_eventloop_dispatch(loop, AURA_EVTLOOP_ONCE);
 
 	slog(4, SLOG_DEBUG, "Call completed");
 	*retbuf = node->sync_ret_buf;
+	aura_cache_store(node, o, entry, node->sync_call_result, *retbuf);
 
 bailout:
 	node->sync_call_running = false;
 	return node->sync_call_result;
 }
 
+
+/**
+ * Synchronously call an object. arguments should be placed in argbuf.
+ * The retbuf will be set to point to response buffer if the call succeeds.
+ *
+ * @param node
+ * @param o
+ * @param retbuf
+ * @param argbuf
+ *
+ * @return
+ */
+int aura_core_call(
+	struct aura_node *	node,
+	struct aura_object *	o,
+	struct aura_buffer **	retbuf,
+	struct aura_buffer *	argbuf)
+{
+	return core_call(node, o, retbuf, argbuf, node->call_timeout_ms);
+}
+
+/**
+ * Set the default timeout for all calls issued on this node. Calls that do not
+ * complete in time fail with AURA_CALL_TIMEOUT status. Requests that
+ * have not been sent by the transport yet are dropped from the outbound queue,
+ * late responses to the ones already sent are discarded for a while, see
+ * aura_set_late_response_window().
+ *
+ * The default is 0, i.e. calls may take as long as they want.
+ *
+ * @param node
+ * @param timeout_ms Timeout in milliseconds, 0 to disable
+ */
+void aura_set_call_timeout(struct aura_node *node, int timeout_ms)
+{
+	node->call_timeout_ms = timeout_ms;
+}
+
+/**
+ * Set how long the response to a call that timed out after its request was sent
+ * is waited for, so that it is discarded instead of being taken for the response
+ * of the next call to the same method. Responses that come in fresh buffers
+ * carry no tag and are matched to calls in order, see aura_call_slot_find().
+ *
+ * A longer window copes with slower devices, but a request the device silently
+ * drops costs the next call to that method its response for as long.
+ *
+ * The default is 1000 ms.
+ *
+ * @param node
+ * @param window_ms Window in milliseconds, 0 to take late responses for the next call
+ */
+void aura_set_late_response_window(struct aura_node *node, int window_ms)
+{
+	node->late_response_window_ms = window_ms;
+}
+
 /**
  * @}
  * \addtogroup async
@@ -561,8 +704,9 @@ bailout:
  * @param calldonecb
  * @param arg
  * @return -EBADSLT if the requested id is not in etable
- *                 -ENODATA if serialization failed or another synchronous call for this id is pending
+ *                 -ENODATA if serialization failed
  *                 -ENOEXEC if the node is currently offline
+ *                 -EAGAIN if the outbound queue is full
  */
 int aura_start_call_raw(
 	struct aura_node *node,
@@ -581,7 +725,7 @@ int aura_start_call_raw(
 		return -EBADSLT;
 
 	va_start(ap, arg);
-	buf = aura_serialize(node, o->arg_fmt, o->arglen, ap);
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
 	va_end(ap);
 
 	if (!buf)
@@ -595,12 +739,62 @@ int aura_start_call_raw(
 	return ret;
 }
 
+/* Does a buffer made by the caller look like the arguments of object o? */
+static bool buffer_holds_args(struct aura_node *node, struct aura_object *o, struct aura_buffer *buf)
+{
+	if (buf->owner != node)
+		return false;
+	/* Variable-size arguments may take less than the maximum */
+	if (o->arg_plan && o->arg_plan->variable)
+		return buf->payload_size <= o->arglen;
+	return buf->payload_size == o->arglen;
+}
+
+/**
+ * Start a call for the object identified by its id with arguments already put
+ * into a buffer by the caller, e.g. to pass large blocks of data by reference
+ * with aura_buffer_put_iov() instead of copying them.
+ * Upon completion the specified callback will be fired with call results.
+ *
+ * buf should be obtained with aura_buffer_request() for this node and hold
+ * exactly the arguments of the object, no more than their maximum size for
+ * formats with variable-size fields. The core takes care of buf if the call
+ * has been started, otherwise it's still up to the caller.
+ *
+ * @param node
+ * @param id
+ * @param calldonecb
+ * @param arg
+ * @param buf
+ * @return -EBADSLT if the requested id is not in etable
+ *                 -EINVAL if the buffer doesn't hold the arguments of the object
+ *                 -ENOEXEC if the node is currently offline
+ *                 -EAGAIN if the outbound queue is full
+ */
+int aura_queue_call(
+	struct aura_node *node,
+	int id,
+	void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+	void *arg,
+	struct aura_buffer *buf)
+{
+	struct aura_object *o = aura_etable_find_id(node->tbl, id);
+
+	if (!o)
+		return -EBADSLT;
+
+	if (!buffer_holds_args(node, o, buf))
+		return -EINVAL;
+
+	return aura_core_start_call(node, o, calldonecb, arg, buf);
+}
+
 /**
  * Set the callback that will be called when event with supplied id arrives.
  * NULL calldonecb disables this event callback.
  * aura_buffer supplied to called in 'ret' contains any data assiciated with this event.
- * You should not free the data buffer in the callback or access the buffer from anywhere
- * but this callback. Make a copy if you need it.
+ * The buffer is released once the callback returns. To keep it longer, take a reference
+ * with aura_buffer_ref() and drop it with aura_buffer_unref() when done, no copy needed.
  *
  * @param node
  * @param id
@@ -631,8 +825,8 @@ int aura_set_event_callback_raw(
  * Set the callback that will be called when event with supplied name arrives.
  * NULL calldonecb disables this event callback.
  * aura_buffer supplied to called in 'ret' contains any data assiciated with this event.
- * You should not free the data buffer in the callback or access the buffer from anywhere
- * but this callback. Make a copy if you need it.
+ * The buffer is released once the callback returns. To keep it longer, take a reference
+ * with aura_buffer_ref() and drop it with aura_buffer_unref() when done, no copy needed.
  *
  * @param node
  * @param event
@@ -666,8 +860,9 @@ int aura_set_event_callback(
  * @param calldonecb
  * @param arg
  * @return -EBADSLT if the requested id is not in etable
- *                 -ENODATA if serialization failed or another synchronous call for this id is pending
+ *                 -ENODATA if serialization failed
  *                 -ENOEXEC if the node is currently offline
+ *                 -EAGAIN if the outbound queue is full
  */
 int aura_start_call(
 	struct aura_node *node,
@@ -686,11 +881,176 @@ int aura_start_call(
 		return -ENOENT;
 
 	va_start(ap, arg);
-	buf = aura_serialize(node, o->arg_fmt, o->arglen, ap);
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
+	va_end(ap);
+	if (!buf)
+		return -ENODATA;
+
+	ret = aura_core_start_call(node, o, calldonecb, arg, buf);
+
+	if (ret != 0)
+		aura_buffer_release(buf);
+
+	return ret;
+}
+
+/**
+ * Start a call to an object identified by name that fails with AURA_CALL_TIMEOUT
+ * status if not completed within timeout_ms milliseconds. This overrides the
+ * node's default set with aura_set_call_timeout().
+ *
+ * @param node
+ * @param name
+ * @param timeout_ms Timeout in milliseconds, 0 for no timeout
+ * @param calldonecb
+ * @param arg
+ * @return -EBADSLT if the requested id is not in etable
+ *                 -ENODATA if serialization failed
+ *                 -ENOEXEC if the node is currently offline
+ *                 -EAGAIN if the outbound queue is full
+ */
+int aura_start_call_deadline(
+	struct aura_node *node,
+	const char *name,
+	int timeout_ms,
+	void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+	void *arg,
+	...)
+{
+	struct aura_object *o;
+	va_list ap;
+	struct aura_buffer *buf;
+	int ret;
+
+	o = aura_etable_find(node->tbl, name);
+	if (!o)
+		return -ENOENT;
+
+	va_start(ap, arg);
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
+	va_end(ap);
+	if (!buf)
+		return -ENODATA;
+
+	ret = start_call(node, o, calldonecb, arg, buf, timeout_ms, NULL, NULL, false);
+
+	if (ret != 0)
+		aura_buffer_release(buf);
+
+	return ret;
+}
+
+/**
+ * Start a call to an object identified by name and fill in a handle that can be
+ * used to cancel it later with aura_call_cancel().
+ *
+ * @param node
+ * @param name
+ * @param handle
+ * @param calldonecb
+ * @param arg
+ * @return -EBADSLT if the requested id is not in etable
+ *                 -ENODATA if serialization failed
+ *                 -ENOEXEC if the node is currently offline
+ *                 -EAGAIN if the outbound queue is full
+ */
+int aura_start_call_handle(
+	struct aura_node *node,
+	const char *name,
+	struct aura_call_handle *handle,
+	void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+	void *arg,
+	...)
+{
+	struct aura_object *o;
+	va_list ap;
+	struct aura_buffer *buf;
+	int ret;
+
+	o = aura_etable_find(node->tbl, name);
+	if (!o)
+		return -ENOENT;
+
+	va_start(ap, arg);
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
+	va_end(ap);
+	if (!buf)
+		return -ENODATA;
+
+	ret = start_call(node, o, calldonecb, arg, buf, node->call_timeout_ms, NULL, handle, false);
+
+	if (ret != 0)
+		aura_buffer_release(buf);
+
+	return ret;
+}
+
+/**
+ * Cancel a call started with aura_start_call_handle(). The completion callback
+ * will not be called.
+ *
+ * A request that the transport has not picked up yet is dropped from the outbound
+ * queue right away. A request that has already been sent can't be taken back, so its
+ * response is discarded once it arrives.
+ *
+ * @param handle
+ * @return 1 if the request never left the outbound queue, 0 if it was already in flight,
+ *         -ENOENT if the call has already completed or been cancelled
+ */
+int aura_call_cancel(struct aura_call_handle *handle)
+{
+	struct aura_call_slot *slot = handle->slot;
+
+	/* Slots are recycled, the tag tells if this one is still ours */
+	if (!slot || (slot->tag != handle->tag) || slot->cancelled)
+		return -ENOENT;
+
+	return aura_call_slot_cancel(handle->node, slot);
+}
+
+/**
+ * Start a call to an object identified by name in the given priority class,
+ * overriding the object's one (See aura_object_set_priority()).
+ * Queued calls of higher classes are handed to the transport first.
+ *
+ * @param node
+ * @param name
+ * @param prio One of AURA_CALL_PRIO_*
+ * @param calldonecb
+ * @param arg
+ * @return -EBADSLT if the requested id is not in etable
+ *                 -EINVAL if prio is not valid
+ *                 -ENODATA if serialization failed
+ *                 -ENOEXEC if the node is currently offline
+ *                 -EAGAIN if the outbound queue is full
+ */
+int aura_start_call_prio(
+	struct aura_node *node,
+	const char *name,
+	int prio,
+	void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+	void *arg,
+	...)
+{
+	struct aura_object *o;
+	va_list ap;
+	struct aura_buffer *buf;
+	int ret;
+
+	if ((prio < AURA_CALL_PRIO_DEFAULT) || (prio >= AURA_CALL_PRIO_COUNT))
+		return -EINVAL;
+
+	o = aura_etable_find(node->tbl, name);
+	if (!o)
+		return -ENOENT;
+
+	va_start(ap, arg);
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
 	va_end(ap);
 	if (!buf)
 		return -ENODATA;
 
+	buf->prio = prio;
 	ret = aura_core_start_call(node, o, calldonecb, arg, buf);
 
 	if (ret != 0)
@@ -782,7 +1142,7 @@ int aura_call_raw(
 		return -EBADSLT;
 
 	va_start(ap, retbuf);
-	buf = aura_serialize(node, o->arg_fmt, o->arglen, ap);
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
 	va_end(ap);
 
 	if (!buf) {
@@ -793,6 +1153,92 @@ int aura_call_raw(
 	return aura_core_call(node, o, retbuf, buf);
 }
 
+/**
+ * Synchronously call an object identified by id with arguments already put
+ * into a buffer by the caller. This is the synchronous counterpart of
+ * aura_queue_call(), used by the stubs aura-codegen generates.
+ *
+ * buf should be obtained with aura_buffer_request() for this node and hold
+ * the arguments of the object, see aura_queue_call(). If the call succeeds,
+ * retbuf will be the pointer to aura_buffer containing the values. It's your
+ * responsibility to call aura_buffer_release() on it.
+ * The core takes care of buf if the call has been started, i.e. if this
+ * doesn't return a negative error code. Otherwise it's still up to the caller.
+ *
+ * @param node
+ * @param id
+ * @param retbuf
+ * @param buf
+ * @return AURA_CALL_* status of the call or
+ *                 -EBADSLT if the requested id is not in etable
+ *                 -EINVAL if the buffer doesn't hold the arguments of the object
+ *                 -ENOEXEC if the node is currently offline
+ *                 -EAGAIN if the outbound queue is full
+ */
+int aura_call_buffer(struct aura_node *node, int id, struct aura_buffer **retbuf, struct aura_buffer *buf)
+{
+	struct aura_object *o = aura_etable_find_id(node->tbl, id);
+
+	if (!o)
+		return -EBADSLT;
+
+	if (!buffer_holds_args(node, o, buf))
+		return -EINVAL;
+
+	return aura_core_call(node, o, retbuf, buf);
+}
+
+/**
+ * Synchronously call an object identified by id with an array of tagged values
+ * as arguments, and unpack the return values into another array. Unlike
+ * aura_call_raw(), this needs no varargs, which makes it the one to use
+ * from language bindings and generated code.
+ *
+ * There should be a value of the matching type for every argument, see
+ * aura_serialize_values(). rets should have room for a value per return
+ * field, see aura_deserialize_values() for how they are filled in.
+ *
+ * @param node
+ * @param id
+ * @param args arguments, may be NULL for methods with no arguments
+ * @param n number of arguments
+ * @param rets where to put the return values, NULL to drop them
+ * @return AURA_CALL_* status of the call or
+ *                 -EBADSLT if the requested id is not in etable
+ *                 -EINVAL if the arguments don't match the format
+ *                 -E2BIG if some binary argument doesn't fit its field
+ *                 -ENOEXEC if the node is currently offline
+ *                 -EAGAIN if the outbound queue is full
+ */
+int aura_call_values(struct aura_node *node, int id, const struct aura_value *args, int n,
+		     struct aura_value *rets)
+{
+	struct aura_object *o = aura_etable_find_id(node->tbl, id);
+	struct aura_buffer *buf, *retbuf;
+	int ret;
+
+	if (!o)
+		return -EBADSLT;
+
+	ret = aura_serialize_values(node, o->arg_plan, args, n, &buf);
+	if (ret)
+		return ret;
+
+	ret = aura_core_call(node, o, &retbuf, buf);
+	if (ret < 0) {
+		aura_buffer_release(buf);
+		return ret;
+	}
+
+	if (ret == AURA_CALL_COMPLETED) {
+		/* The node could have gone and come back with a new etable meanwhile */
+		if (rets && (retbuf->object == o))
+			aura_deserialize_values(retbuf, o->ret_plan, rets);
+		aura_buffer_release(retbuf);
+	}
+	return ret;
+}
+
 /**
  * Synchronously call a remote method of node identified by name.
  * If the call succeeds, retbuf will be the pointer to aura_buffer containing
@@ -818,7 +1264,7 @@ int aura_call(
 		return -EBADSLT;
 
 	va_start(ap, retbuf);
-	buf = aura_serialize(node, o->arg_fmt, o->arglen, ap);
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
 	va_end(ap);
 
 	if (!buf) {
@@ -829,6 +1275,43 @@ int aura_call(
 	return aura_core_call(node, o, retbuf, buf);
 }
 
+/**
+ * Synchronously call a remote method of node identified by name, giving up
+ * after timeout_ms milliseconds. This overrides the node's default set with
+ * aura_set_call_timeout().
+ *
+ * @param node
+ * @param name
+ * @param timeout_ms Timeout in milliseconds, 0 for no timeout
+ * @param retbuf
+ * @return AURA_CALL_TIMEOUT if the call did not complete in time
+ */
+int aura_call_timeout(
+	struct aura_node *	node,
+	const char *		name,
+	int			timeout_ms,
+	struct aura_buffer **	retbuf,
+	...)
+{
+	va_list ap;
+	struct aura_buffer *buf;
+	struct aura_object *o = aura_etable_find(node->tbl, name);
+
+	if (!o)
+		return -EBADSLT;
+
+	va_start(ap, retbuf);
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
+	va_end(ap);
+
+	if (!buf) {
+		slog(2, SLOG_WARN, "Serialization failed");
+		return -ENODATA;
+	}
+
+	return core_call(node, o, retbuf, buf, timeout_ms);
+}
+
 
 /**
  * Enable synchronous event processing.
@@ -931,13 +1414,15 @@ int aura_get_next_event(struct aura_node *node, const struct aura_object **obj,
  */
 void aura_call_fail(struct aura_node *node, struct aura_object *o)
 {
-	if (o->pending && o->calldonecb)
-		o->calldonecb(node, AURA_CALL_TRANSPORT_FAIL, NULL, o->arg);
-	if (o->pending)
-		o->pending--;
+	struct aura_call_slot *slot = aura_call_slot_find_sent(node, o);
 
-	node->sync_call_result = AURA_CALL_TRANSPORT_FAIL;
-	node->sync_ret_buf = NULL;
+	/* Fail the call to this object sent first */
+	if (slot) {
+		aura_call_slot_complete(node, slot, AURA_CALL_TRANSPORT_FAIL, NULL);
+		return;
+	}
+	slog(0, SLOG_WARN, "Transport failed call %d (%s) that is not pending",
+	     o->id, o->name);
 }
 
 /**
@@ -960,6 +1445,9 @@ void aura_set_status(struct aura_node *node, int status)
 	if (node->is_opening)
 		BUG(node, "Transport BUG: Do not call aura_set_status in open()");
 
+	/* Whatever we've cached may no longer be true */
+	aura_cache_invalidate(node, NULL);
+
 	if ((oldstatus == AURA_STATUS_OFFLINE) && (status == AURA_STATUS_ONLINE)) {
 		/* Dump etable */
 		int i;
@@ -978,23 +1466,11 @@ void aura_set_status(struct aura_node *node, int status)
 		slog(1, SLOG_INFO, "-------------8<-------------");
 	}
 	if ((oldstatus == AURA_STATUS_ONLINE) && (status == AURA_STATUS_OFFLINE)) {
-		int i;
-
 		slog(2, SLOG_INFO, "Node %s going offline, clearing outbound queue",
 		     node->tr->name);
-		cleanup_buffer_queue(&node->outbound_buffers, false);
-		/* Cancel any pending calls */
-		for (i = 0; i < node->tbl->next; i++) {
-			struct aura_object *o;
-			o = &node->tbl->objects[i];
-			if (o->pending && o->calldonecb)
-				o->calldonecb(node, AURA_CALL_TRANSPORT_FAIL, NULL, o->arg);
-			if (o->pending)
-				o->pending--;
-		}
-		/* If any of the synchronos calls are running - inform them */
-		node->sync_call_result = AURA_CALL_TRANSPORT_FAIL;
-		node->sync_ret_buf = NULL;
+		aura_node_outbound_flush(node, false);
+		/* Cancel any pending calls, synchronous call (if any) included */
+		aura_call_table_fail_all(node);
 	}
 
 	if (node->status_changed_cb)
@@ -1050,8 +1526,8 @@ const char *aura_node_call_strerror(int errcode)
 			return "Buffer allocation/marshalling failed";
 		case -ENOEXEC:
 			return "The node is currently offline";
-		case -EIO:
-			return "A call for this object is already running";
+		case -EAGAIN:
+			return "The outbound queue is full";
 		default:
 			return "Unknown error";
 	}
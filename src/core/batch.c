@@ -0,0 +1,265 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+#include <aura/eventloop.h>
+
+struct aura_batch_call {
+	void	(*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg);
+	void *	arg;
+};
+
+struct aura_call_batch {
+	struct aura_node *		node;
+	struct aura_export_table *	tbl;
+	/* Serialized calls, in the order they were added */
+	struct list_head		buffers;
+	struct aura_batch_call *	calls;
+	int				count;
+	int				size;
+	/* Calls submitted, but not yet completed */
+	int				outstanding;
+	int				numfailed;
+	void				(*batchdonecb)(struct aura_node *node, int numfailed, void *arg);
+	void *				arg;
+};
+
+static void batch_free(struct aura_call_batch *batch)
+{
+	free(batch->calls);
+	free(batch);
+}
+
+/**
+ * \addtogroup async
+ * @{
+ */
+
+/**
+ * Start a new batch of calls for this node.
+ *
+ * Calls added to the batch with aura_call_batch_add() and aura_call_batch_add_raw()
+ * are serialized right away, but nothing is queued for the transport until
+ * aura_call_batch_submit() is called. Submission puts all the calls into the
+ * outbound queue in one go and wakes up the transport only once, so that the
+ * transport can coalesce them.
+ *
+ * The batchdonecb (if any) is called once after all the calls in the batch
+ * have completed (and their own callbacks have been fired). numfailed is the
+ * number of calls that completed with status other than AURA_CALL_COMPLETED.
+ *
+ * @param node
+ * @param batchdonecb
+ * @param arg
+ * @return pointer to the batch or NULL
+ */
+struct aura_call_batch *aura_call_batch_begin(struct aura_node *node,
+					      void (*batchdonecb)(struct aura_node *node, int numfailed, void *arg),
+					      void *arg)
+{
+	struct aura_call_batch *batch = calloc(1, sizeof(*batch));
+
+	if (!batch)
+		return NULL;
+
+	batch->node = node;
+	batch->tbl = node->tbl;
+	batch->batchdonecb = batchdonecb;
+	batch->arg = arg;
+	INIT_LIST_HEAD(&batch->buffers);
+	return batch;
+}
+
+static int batch_add(struct aura_call_batch *batch, struct aura_object *o,
+		     void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+		     void *arg, va_list ap)
+{
+	struct aura_node *node = batch->node;
+	struct aura_buffer *buf;
+
+	if (!o)
+		return -EBADSLT;
+
+	if (batch->count == batch->size) {
+		int size = batch->size ? batch->size * 2 : 8;
+		struct aura_batch_call *tmp = realloc(batch->calls, size * sizeof(*tmp));
+		if (!tmp)
+			return -ENOMEM;
+		batch->calls = tmp;
+		batch->size = size;
+	}
+
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
+	if (!buf)
+		return -ENODATA;
+
+	buf->object = o;
+	aura_queue_buffer(&batch->buffers, buf);
+	batch->calls[batch->count].calldonecb = calldonecb;
+	batch->calls[batch->count].arg = arg;
+	batch->count++;
+	return 0;
+}
+
+/**
+ * Add a call to the object identified by its id to the batch.
+ *
+ * @param batch
+ * @param id
+ * @param calldonecb
+ * @param arg
+ * @return 0 on success, -EBADSLT if the requested id is not in etable,
+ *         -ENODATA if serialization failed
+ */
+int aura_call_batch_add_raw(struct aura_call_batch *batch, int id,
+			    void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+			    void *arg, ...)
+{
+	va_list ap;
+	int ret;
+
+	if (!batch->tbl || (batch->tbl != batch->node->tbl))
+		return -EBADSLT;
+
+	va_start(ap, arg);
+	ret = batch_add(batch, aura_etable_find_id(batch->tbl, id), calldonecb, arg, ap);
+	va_end(ap);
+	return ret;
+}
+
+/**
+ * Add a call to the object identified by name to the batch.
+ *
+ * @param batch
+ * @param name
+ * @param calldonecb
+ * @param arg
+ * @return 0 on success, -EBADSLT if there's no such object,
+ *         -ENODATA if serialization failed
+ */
+int aura_call_batch_add(struct aura_call_batch *batch, const char *name,
+			void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+			void *arg, ...)
+{
+	va_list ap;
+	int ret;
+
+	if (batch->tbl != batch->node->tbl)
+		return -EBADSLT;
+
+	va_start(ap, arg);
+	ret = batch_add(batch, aura_etable_find(batch->tbl, name), calldonecb, arg, ap);
+	va_end(ap);
+	return ret;
+}
+
+/**
+ * Submit all the calls in the batch.
+ *
+ * If submission fails the batch is left intact and can be submitted later or
+ * dropped with aura_call_batch_discard(). Once submitted, the batch belongs to
+ * the core and is freed after batchdonecb is called.
+ *
+ * @param batch
+ * @return 0 on success, -ENOEXEC if the node is currently offline,
+ *         -EBADSLT if the node's export table has changed since the calls were added,
+ *         -EAGAIN if the batch doesn't fit in node's outbound queue.
+ */
+int aura_call_batch_submit(struct aura_call_batch *batch)
+{
+	struct aura_node *node = batch->node;
+	struct aura_buffer *buf;
+	size_t bytes = 0;
+	bool is_first;
+	int i = 0;
+
+	if (node->status != AURA_STATUS_ONLINE)
+		return -ENOEXEC;
+
+	if (batch->tbl != node->tbl)
+		return -EBADSLT;
+
+	list_for_each_entry(buf, &batch->buffers, qentry)
+		bytes += buf->size;
+
+	if (aura_node_outbound_full(node, batch->count, bytes))
+		return -EAGAIN;
+
+	if (!batch->count) {
+		if (batch->batchdonecb)
+			batch->batchdonecb(node, 0, batch->arg);
+		batch_free(batch);
+		return 0;
+	}
+
+	aura_node_eventloop_get_autocreate(node);
+
+	list_for_each_entry(buf, &batch->buffers, qentry) {
+		struct aura_call_slot *slot;
+		slot = aura_call_slot_get(node, buf->object,
+					  batch->calls[i].calldonecb, batch->calls[i].arg);
+		slot->batch = batch;
+		if (node->call_timeout_ms > 0)
+			aura_call_slot_set_deadline(node, slot, node->call_timeout_ms);
+		aura_call_slot_attach(slot, buf);
+		i++;
+	}
+	batch->outstanding = batch->count;
+
+	is_first = aura_node_outbound_empty(node);
+	while ((buf = aura_dequeue_buffer(&batch->buffers)))
+		aura_node_outbound_queue(node, buf);
+	/* The transport may complete the whole batch right here, don't touch it afterwards */
+	if (is_first)
+		node->tr->handle_event(node, NODE_EVENT_HAVE_OUTBOUND, NULL);
+
+	return 0;
+}
+
+/**
+ * Drop a batch that has not been submitted, releasing all the serialized calls.
+ *
+ * @param batch
+ */
+void aura_call_batch_discard(struct aura_call_batch *batch)
+{
+	struct aura_buffer *buf;
+
+	while ((buf = aura_dequeue_buffer(&batch->buffers)))
+		aura_buffer_release(buf);
+	batch_free(batch);
+}
+
+/**
+ * @}
+ */
+
+/**
+ * Account for a completed call of a batch, firing batchdonecb and
+ * freeing the batch once the last one completes.
+ *
+ * @param batch
+ * @param status
+ */
+void aura_call_batch_call_done(struct aura_call_batch *batch, int status)
+{
+	if (status != AURA_CALL_COMPLETED)
+		batch->numfailed++;
+
+	if (--batch->outstanding)
+		return;
+
+	if (batch->batchdonecb)
+		batch->batchdonecb(batch->node, batch->numfailed, batch->arg);
+	batch_free(batch);
+}
+
+/**
+ * Drop a call of a batch without completing it (e.g. when the node is closed).
+ * The batch is silently freed once the last call is dropped.
+ *
+ * @param batch
+ */
+void aura_call_batch_call_drop(struct aura_call_batch *batch)
+{
+	if (!--batch->outstanding)
+		batch_free(batch);
+}
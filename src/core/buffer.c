@@ -1,29 +1,107 @@
 #include <aura/aura.h>
 #include <aura/private.h>
 #include <aura/buffer_allocator.h>
+#include <aura/timer.h>
+#include <sys/uio.h>
 
 struct aura_buffer *aura_buffer_internal_request(int size);
 void aura_buffer_internal_free(struct aura_buffer *buf);
 
+/* A span of buffer's payload that lives in caller's memory, see aura_buffer_put_iov() */
+struct aura_buffer_ref {
+	/* Where the data belongs within buffer's data */
+	int			offset;
+	int			len;
+	const void *		data;
+	void			(*release)(const void *data, void *arg);
+	void *			arg;
+	/* list_entry. Links the reference into buffer's refs, by offset */
+	struct list_head	qentry;
+};
+
+static void buffer_drop_ref(struct aura_buffer_ref *ref)
+{
+	list_del(&ref->qentry);
+	if (ref->release)
+		ref->release(ref->data, ref->arg);
+	free(ref);
+}
+
+static void buffer_drop_refs(struct aura_buffer *buf)
+{
+	struct aura_buffer_ref *pos, *tmp;
+
+	list_for_each_entry_safe(pos, tmp, &buf->refs, qentry)
+		buffer_drop_ref(pos);
+}
+
+/* Give buffer's memory back to where it came from */
+static void buffer_free(struct aura_buffer *buf)
+{
+	struct aura_node *nd = buf->owner;
+
+	buf->magic = 0;
+	buffer_drop_refs(buf);
+	if (nd->allocator)
+		nd->allocator->release(nd, nd->allocator_data, buf);
+	else
+		free(buf);
+}
+
 /** \addtogroup bufapi
  * @{
  */
 
-/* Let's see if we have a buffer in our pool here */
+/* Any free buffer of the class will do, take the most recently used one */
 static struct aura_buffer *fetch_buffer_from_pool(struct aura_node *	nd,
-						  int			size)
+						  int			cls)
 {
-	struct list_head *pos, *tmp;
-
-	list_for_each_safe(pos, tmp, &nd->buffer_pool){
-		struct aura_buffer *buf = list_entry(pos, struct aura_buffer, qentry);
-		if (buf->size >= size) {
-			list_del(pos);
-			nd->num_buffers_in_pool--;
-			return buf;
-		}
+	struct aura_buffer_class *c = &nd->buffer_classes[cls];
+	struct aura_buffer *buf;
+
+	if (list_empty(&c->free)) {
+		c->stats.misses++;
+		return NULL;
 	}
-	return NULL;
+
+	buf = list_entry(c->free.next, struct aura_buffer, qentry);
+	list_del(&buf->qentry);
+	c->stats.hits++;
+	c->stats.count--;
+	nd->num_buffers_in_pool--;
+	return buf;
+}
+
+/* Destroy the least recently used buffer of the class */
+static void bufferpool_drop(struct aura_node *nd, struct aura_buffer_class *c)
+{
+	struct aura_buffer *buf = list_entry(c->free.prev, struct aura_buffer, qentry);
+
+	list_del(&buf->qentry);
+	c->stats.count--;
+	c->stats.dropped++;
+	nd->num_buffers_in_pool--;
+	buffer_free(buf);
+}
+
+static bool bufferpool_over_threshold(struct aura_buffer_class *c, int threshold)
+{
+	return (threshold >= 0) && (c->stats.count > threshold);
+}
+
+void aura_bufferpool_init(struct aura_node *nd)
+{
+	int i;
+
+	for (i = 0; i < AURA_BUFFER_POOL_CLASSES; i++) {
+		struct aura_buffer_class *c = &nd->buffer_classes[i];
+
+		INIT_LIST_HEAD(&c->free);
+		memset(&c->stats, 0, sizeof(c->stats));
+		c->stats.size = aura_bufferpool_class_size(i);
+		c->stats.gc_threshold = nd->gc_threshold;
+	}
+	nd->num_buffers_in_pool = 0;
 }
 
 /**
@@ -34,14 +112,16 @@ static struct aura_buffer *fetch_buffer_from_pool(struct aura_node *	nd,
  */
 int aura_node_buffer_pool_gc_once(struct aura_node *pos)
 {
-	/* GC: Ditch one last buffer from pool if we have too many */
-	if (pos->num_buffers_in_pool >= pos->gc_threshold) {
-		struct aura_buffer *buf;
-		pos->num_buffers_in_pool--;
-		buf = list_entry(pos->buffer_pool.prev, struct aura_buffer, qentry);
-		list_del(pos->buffer_pool.prev);
-		aura_buffer_destroy(buf);
-		return 1;
+	int i;
+
+	/* GC: Ditch one buffer from the largest class that has too many */
+	for (i = AURA_BUFFER_POOL_CLASSES - 1; i >= 0; i--) {
+		struct aura_buffer_class *c = &pos->buffer_classes[i];
+
+		if (bufferpool_over_threshold(c, c->stats.gc_threshold)) {
+			bufferpool_drop(pos, c);
+			return 1;
+		}
 	}
 	return 0;
 }
@@ -55,11 +135,9 @@ int aura_node_buffer_pool_gc_once(struct aura_node *pos)
 int aura_node_buffer_pool_gc_full(struct aura_node *pos)
 {
 	int ret = 0;
-	int tmp;
-	do {
-		tmp = ret;
-		ret += aura_node_buffer_pool_gc_once(pos);
-	} while (ret != tmp);
+
+	while (aura_node_buffer_pool_gc_once(pos))
+		ret++;
 	return ret;
 }
 
@@ -78,27 +156,42 @@ struct aura_buffer *aura_buffer_request(struct aura_node *nd, int size)
 {
 	struct aura_buffer *ret = NULL;
 	int act_size = size;
+	int alloc_size, cls = -1;
 
 	act_size += nd->tr->buffer_overhead;
+	alloc_size = act_size;
 
 #ifdef AURA_USE_BUFFER_POOL
 	/* Try buffer pool first */
-	ret = fetch_buffer_from_pool(nd, act_size);
-	if (ret)
-		goto bailout; /* For the sake of readability */
+	cls = aura_bufferpool_class(act_size);
+	if ((cls >= 0) && nd->global_buffer_pool) {
+		ret = aura_globalpool_get(cls);
+		if (ret) {
+			nd->buffer_classes[cls].stats.hits++;
+			goto bailout;
+		}
+		nd->buffer_classes[cls].stats.misses++;
+		alloc_size = aura_bufferpool_class_size(cls);
+	} else if (cls >= 0) {
+		ret = fetch_buffer_from_pool(nd, cls);
+		if (ret)
+			goto bailout; /* For the sake of readability */
+		/* Big enough for any request of the class when it's back in the pool */
+		alloc_size = aura_bufferpool_class_size(cls);
+	}
 #endif
 
 	/* Fallback to alloc() */
-	if (!nd->tr->allocator) {
-		char *data = malloc(act_size + sizeof(struct aura_buffer));
+	if (!nd->allocator) {
+		char *data = malloc(alloc_size + sizeof(struct aura_buffer));
 		ret = (struct aura_buffer *)data;
 		if (!ret)
 			BUG(nd, "FATAL: malloc() failed");
 		ret->data = &data[sizeof(*ret)];
 	} else {
-		ret = nd->tr->allocator->request(nd, nd->allocator_data, act_size);
+		ret = nd->allocator->request(nd, nd->allocator_data, alloc_size);
 		if (!ret)
-			BUG(nd, "FATAL: buffer allocation by transport failed");
+			BUG(nd, "FATAL: buffer allocation by %s failed", nd->allocator->name);
 	}
 
 	/* Shut up compiler warning when buffer pool is disabled */
@@ -106,13 +199,27 @@ struct aura_buffer *aura_buffer_request(struct aura_node *nd, int size)
 bailout:
 	ret->magic = AURA_BUFFER_MAGIC_ID;
 	ret->size = act_size;
+	ret->pool_class = cls;
+	if (cls >= 0) {
+		struct aura_bufferpool_stats *stats = &nd->buffer_classes[cls].stats;
+		if (++stats->in_use > stats->peak)
+			stats->peak = stats->in_use;
+	}
 	ret->owner = nd;
+	ret->refcount = 1;
+	nd->num_buffers_out++;
+	ret->call_tag = 0;
+	ret->slot = NULL;
+	ret->prio = AURA_CALL_PRIO_DEFAULT;
+	ret->payload_size = 0;
+	INIT_LIST_HEAD(&ret->refs);
 	aura_buffer_rewind(ret);
 	return ret;
 }
 
 /**
- * Release an aura_buffer, returning it back to the node's buffer pool.
+ * Release an aura_buffer, dropping the caller's reference to it. Once the last
+ * reference is gone the buffer is returned back to the node's buffer pool.
  * Aura call with garbage-collect the buffer pool later
  *
  * @param nd
@@ -120,20 +227,74 @@ bailout:
  */
 void aura_buffer_release(struct aura_buffer *buf)
 {
-	/* Just put the buffer back into the pool at the very start */
-#ifdef AURA_USE_BUFFER_POOL
 	struct aura_node *nd = buf->owner;
+
 	if (buf->magic != AURA_BUFFER_MAGIC_ID)
 		BUG(nd,
 		    "FATAL: Attempting to release a buffer with invalid magic OR double free an aura_buffer");
+	if (buf->refcount <= 0)
+		BUG(nd, "FATAL: Attempting to release an aura_buffer that is already released");
+
+	/* Someone else still holds it */
+	if (__atomic_sub_fetch(&buf->refcount, 1, __ATOMIC_ACQ_REL))
+		return;
+
+	/* Just put the buffer back into the pool at the very start */
+#ifdef AURA_USE_BUFFER_POOL
+	if (buf->pool_class < 0) {
+		aura_buffer_destroy(buf);
+		return;
+	}
 
-	list_add(&buf->qentry, &nd->buffer_pool);
+	buffer_drop_refs(buf);
+	nd->buffer_classes[buf->pool_class].stats.in_use--;
+	nd->num_buffers_out--;
+	if (nd->global_buffer_pool) {
+		aura_globalpool_put(buf);
+		return;
+	}
+	list_add(&buf->qentry, &nd->buffer_classes[buf->pool_class].free);
+	nd->buffer_classes[buf->pool_class].stats.count++;
 	nd->num_buffers_in_pool++;
 #else
 	aura_buffer_destroy(buf);
 #endif
 }
 
+/**
+ * Take one more reference to the buffer, e.g. to keep an event buffer past the
+ * event callback or to hand the same buffer to several consumers without copying
+ * it. Each reference is dropped with aura_buffer_unref() or aura_buffer_release(),
+ * the buffer goes back to the pool with the last one.
+ *
+ * The count itself is atomic, but the last reference should be dropped where the
+ * node's buffers can be released, i.e. in the node's thread unless the process-wide
+ * pool is used. The data and the internal pointer are shared by all the holders,
+ * so they should not modify the buffer and should aura_buffer_rewind() it before
+ * reading it once again. All the references must be dropped before the node is closed.
+ *
+ * @param buf aura buffer
+ * @return buf
+ */
+struct aura_buffer *aura_buffer_ref(struct aura_buffer *buf)
+{
+	if (buf->magic != AURA_BUFFER_MAGIC_ID)
+		BUG(buf->owner, "FATAL: Attempting to reference a buffer with invalid magic");
+	__atomic_add_fetch(&buf->refcount, 1, __ATOMIC_RELAXED);
+	return buf;
+}
+
+/**
+ * Drop a reference to the buffer taken with aura_buffer_ref(). This is the
+ * same as aura_buffer_release().
+ *
+ * @param buf aura buffer
+ */
+void aura_buffer_unref(struct aura_buffer *buf)
+{
+	aura_buffer_release(buf);
+}
+
 /**
  * Force aura to immediately free the buffer, bypassing the node's buffer pool.
  * Do not call this function directly, unless you know what you are doing - use
@@ -147,42 +308,43 @@ void aura_buffer_destroy(struct aura_buffer *buf)
 	if (buf->magic != AURA_BUFFER_MAGIC_ID)
 		BUG(nd,
 		    "FATAL: Attempting to destroy a buffer with invalid magic OR double free an aura_buffer");
-	buf->magic = 0;
 
 	if (!nd)
 		BUG(NULL, "Buffer with no owner");
 
-	if (nd->tr->allocator)
-		nd->tr->allocator->release(nd, nd->allocator_data, buf);
-	else
-		free(buf);
+	/* It's not coming back to the pool */
+	if (buf->pool_class >= 0)
+		nd->buffer_classes[buf->pool_class].stats.in_use--;
+	nd->num_buffers_out--;
+	buffer_free(buf);
 }
 
 /**
- * Garbage-collect at most numdrop buffers from the buffer pool, if the total
- * number of buffers in the pool is greater than threshold.
+ * Garbage-collect at most numdrop buffers from the buffer pool, if the number
+ * of free buffers in their size class is greater than threshold.
  *
  * threshold == 0 and numdrop == -1 drop everything from the pool.
  *
  * @param nd
  * @param numdrop - maximum number of buffers to destroy during this iteration
- * @param threshold - maximum number of buffers to keep in the pool
+ * @param threshold - maximum number of buffers to keep in each size class
  */
 void aura_bufferpool_gc(struct aura_node *nd, int numdrop, int threshold)
 {
-	struct aura_buffer *pos, *tmp;
+	int i;
 
-	/* We iterate in reverse order, since the least used buffers
-	 * will naturally end up at the very end of the list
+	/* Larger classes first, that's where the memory is. Within a class
+	 * the least used buffers naturally end up at the very end of the list
 	 */
-	list_for_each_entry_safe_reverse(pos, tmp, &nd->buffer_pool, qentry){
-		if ((numdrop == -1)
-		    || (numdrop-- && nd->num_buffers_in_pool > threshold)) {
-			list_del(&pos->qentry);
-			nd->num_buffers_in_pool--;
-			aura_buffer_destroy(pos);
-		} else {
-			return; /* Done for now */
+	for (i = AURA_BUFFER_POOL_CLASSES - 1; i >= 0; i--) {
+		struct aura_buffer_class *c = &nd->buffer_classes[i];
+
+		while (!list_empty(&c->free)) {
+			if ((numdrop != -1) && !(numdrop && bufferpool_over_threshold(c, threshold)))
+				break;
+			if (numdrop != -1)
+				numdrop--;
+			bufferpool_drop(nd, c);
 		}
 	}
 }
@@ -194,24 +356,166 @@ void aura_bufferpool_gc(struct aura_node *nd, int numdrop, int threshold)
  */
 void aura_bufferpool_preheat(struct aura_node *nd, int size, int count)
 {
+	struct aura_buffer *pos, *tmp;
+	LIST_HEAD(bufs);
+
+	/* All at once, or we'd get the same buffer back every time */
 	while (count--) {
 		struct aura_buffer *buf = aura_buffer_request(nd, size);
-		aura_buffer_release(buf);
-		slog(0, SLOG_DEBUG, "!");
+		list_add(&buf->qentry, &bufs);
+	}
+	list_for_each_entry_safe(pos, tmp, &bufs, qentry) {
+		list_del(&pos->qentry);
+		aura_buffer_release(pos);
 	}
 }
 
 /**
- * Manually override buffer pool gc threshold.
+ * Manually override buffer pool gc threshold of all the size classes.
  * The automatic gc will start releasing buffers, one per loop once
- * the are more than threshold buffers in the free buffer pool
+ * the are more than threshold free buffers in a size class
  *
  * @param nd The node for which we're setting the new threshold
- * @param threshold The new threshold
+ * @param threshold The new threshold, -1 to never release anything
  */
 void aura_bufferpool_set_gc_threshold(struct aura_node *nd, int threshold)
 {
+	int i;
+
 	nd->gc_threshold = threshold;
+	for (i = 0; i < AURA_BUFFER_POOL_CLASSES; i++)
+		nd->buffer_classes[i].stats.gc_threshold = threshold;
+}
+
+/**
+ * Override buffer pool gc threshold of the size class that buffers of size
+ * bytes of payload go to.
+ *
+ * @param nd The node for which we're setting the new threshold
+ * @param size Payload size
+ * @param threshold The new threshold, -1 to never release anything
+ * @return 0 on success, -ERANGE if buffers of this size are not pooled
+ */
+int aura_bufferpool_set_class_gc_threshold(struct aura_node *nd, int size, int threshold)
+{
+	int cls = aura_bufferpool_class(size + nd->tr->buffer_overhead);
+
+	if (cls < 0)
+		return -ERANGE;
+	nd->buffer_classes[cls].stats.gc_threshold = threshold;
+	return 0;
+}
+
+/**
+ * Get the counters of the buffer pool size class that buffers of size bytes
+ * of payload go to.
+ *
+ * @param nd node
+ * @param size Payload size
+ * @param stats Where to put the counters
+ * @return 0 on success, -ERANGE if buffers of this size are not pooled
+ */
+int aura_bufferpool_get_stats(struct aura_node *nd, int size, struct aura_bufferpool_stats *stats)
+{
+	int cls = aura_bufferpool_class(size + nd->tr->buffer_overhead);
+
+	if (cls < 0)
+		return -ERANGE;
+	*stats = nd->buffer_classes[cls].stats;
+	return 0;
+}
+
+/**
+ * Run one period of the adaptive buffer pool GC. The eventloop does this every
+ * period_ms once aura_bufferpool_set_adaptive_gc() is called, there is no need
+ * to call it by hand unless the node's timers are not running.
+ *
+ * The working set of each size class follows the most buffers it had in use at
+ * once during a period. It goes up right away, but only comes down after the
+ * class stays below it for idle_periods periods in a row, and then only by
+ * decay_percent of the distance each period. Free buffers beyond what it takes
+ * to serve the working set again are released.
+ *
+ * @param nd node
+ */
+void aura_bufferpool_gc_tick(struct aura_node *nd)
+{
+	int i;
+
+	for (i = 0; i < AURA_BUFFER_POOL_CLASSES; i++) {
+		struct aura_buffer_class *c = &nd->buffer_classes[i];
+		struct aura_bufferpool_stats *s = &c->stats;
+
+		if (s->peak >= s->working_set) {
+			s->working_set = s->peak;
+			c->idle_periods = 0;
+		} else if (++c->idle_periods > nd->gc_params.idle_periods) {
+			int gap = s->working_set - s->peak;
+			s->working_set -= (gap * nd->gc_params.decay_percent + 99) / 100;
+		}
+
+		/* Next period starts with what is out there now */
+		s->peak = s->in_use;
+		s->gc_threshold = s->working_set - s->in_use;
+		if (s->gc_threshold < 0)
+			s->gc_threshold = 0;
+		while (bufferpool_over_threshold(c, s->gc_threshold))
+			bufferpool_drop(nd, c);
+	}
+}
+
+static void gc_timer_cb(struct aura_node *node, struct aura_timer *tm, void *arg)
+{
+	aura_bufferpool_gc_tick(node);
+}
+
+/**
+ * Let the node's buffer pool adapt to the load instead of keeping a fixed number
+ * of free buffers in each size class, see aura_bufferpool_gc_tick(). Bursts then
+ * don't cause malloc()/free() churn and the memory is given back once the node
+ * has been idle for a while. The gc thresholds of the size classes are maintained
+ * by the GC from now on.
+ *
+ * The working sets start from what the pool holds at the moment. Buffers released
+ * to the process-wide pool are not affected, see aura_bufferpool_global_set_limit().
+ *
+ * @param nd node
+ * @param params tunables, NULL to go back to the fixed gc threshold of the node
+ * @return 0 on success, -EINVAL if params don't make sense
+ */
+int aura_bufferpool_set_adaptive_gc(struct aura_node *nd, const struct aura_bufferpool_gc_params *params)
+{
+	struct timeval tv;
+	int i;
+
+	if (!params) {
+		if (nd->gc_timer)
+			aura_timer_stop(nd->gc_timer);
+		aura_bufferpool_set_gc_threshold(nd, nd->gc_threshold);
+		return 0;
+	}
+
+	if ((params->period_ms <= 0) || (params->idle_periods < 0) ||
+	    (params->decay_percent <= 0) || (params->decay_percent > 100))
+		return -EINVAL;
+
+	nd->gc_params = *params;
+	for (i = 0; i < AURA_BUFFER_POOL_CLASSES; i++) {
+		struct aura_buffer_class *c = &nd->buffer_classes[i];
+
+		c->stats.working_set = c->stats.in_use + c->stats.count;
+		c->stats.peak = c->stats.in_use;
+		c->idle_periods = 0;
+	}
+
+	if (!nd->gc_timer)
+		nd->gc_timer = aura_timer_create(nd, gc_timer_cb, NULL);
+	if (aura_timer_is_active(nd->gc_timer))
+		aura_timer_stop(nd->gc_timer);
+	tv.tv_sec = params->period_ms / 1000;
+	tv.tv_usec = (params->period_ms % 1000) * 1000;
+	aura_timer_start(nd->gc_timer, AURA_TIMER_PERIODIC, &tv);
+	return 0;
 }
 
 /**
@@ -256,6 +560,107 @@ void *aura_buffer_payload_ptr(struct aura_buffer *buf)
 	return pos;
 }
 
+/**
+ * \brief Reference len bytes of caller's memory at data as the next field of
+ * the buffer instead of copying them, e.g. a large firmware chunk or sample block.
+ *
+ * The space for the field is reserved in the buffer and the internal pointer
+ * is advanced by len bytes, just like aura_buffer_put_bin() does. Transports that
+ * can do vectored I/O send the data right from where it is, for others it's copied
+ * into the buffer once, when the transport picks the buffer up.
+ *
+ * The memory must stay valid and unchanged until release is called, which happens
+ * once the data has been copied or the buffer is released.
+ *
+ * This function will cause a panic if attempted to write beyond
+ * the buffer boundary.
+ *
+ * @param buf aura buffer
+ * @param data caller's memory
+ * @param len data length
+ * @param release called when the buffer no longer needs the data, may be NULL
+ * @param arg passed to release
+ */
+void aura_buffer_put_iov(struct aura_buffer *buf, const void *data, int len,
+			 void (*release)(const void *data, void *arg), void *arg)
+{
+	struct aura_node *node = buf->owner;
+	struct aura_buffer_ref *ref;
+
+	if (buf->pos + len > buf->size)
+		BUG(node, "attempt to access data beyound buffer boundary");
+
+	ref = malloc(sizeof(*ref));
+	if (!ref)
+		BUG(node, "FATAL: malloc() failed");
+	ref->offset = buf->pos;
+	ref->len = len;
+	ref->data = data;
+	ref->release = release;
+	ref->arg = arg;
+	list_add_tail(&ref->qentry, &buf->refs);
+
+	buf->pos += len;
+	buf->payload_size += len;
+}
+
+/**
+ * \brief Copy all the memory referenced by the buffer into it and drop the
+ * references. The core does this for transports that can't do vectored I/O.
+ *
+ * @param buf aura buffer
+ */
+void aura_buffer_flatten(struct aura_buffer *buf)
+{
+	struct aura_buffer_ref *pos, *tmp;
+
+	list_for_each_entry_safe(pos, tmp, &buf->refs, qentry) {
+		memcpy(&buf->data[pos->offset], pos->data, pos->len);
+		buffer_drop_ref(pos);
+	}
+}
+
+/* Append a non-empty segment, counting the ones that don't fit */
+static void iovec_add(struct iovec *iov, int max, int *count, const void *base, int len)
+{
+	if (len <= 0)
+		return;
+	if (*count < max) {
+		iov[*count].iov_base = (void *)base;
+		iov[*count].iov_len = len;
+	}
+	(*count)++;
+}
+
+/**
+ * \brief Describe the buffer as a vector of memory segments for writev() and friends,
+ * with references to caller memory in place of the space reserved for them.
+ *
+ * The segments cover the transport header and the payload, i.e. the first
+ * buffer_offset + payload length bytes of the buffer.
+ *
+ * @param buf aura buffer
+ * @param iov array to fill in
+ * @param max number of elements in iov
+ * @return number of segments the buffer takes. Only the first max are filled in.
+ */
+int aura_buffer_iovec(struct aura_buffer *buf, struct iovec *iov, int max)
+{
+	int end = buf->owner->tr->buffer_offset + buf->payload_size;
+	struct aura_buffer_ref *pos;
+	int start = 0;
+	int count = 0;
+
+	list_for_each_entry(pos, &buf->refs, qentry) {
+		iovec_add(iov, max, &count, &buf->data[start], pos->offset - start);
+		iovec_add(iov, max, &count, pos->data, pos->len);
+		start = pos->offset + pos->len;
+	}
+	iovec_add(iov, max, &count, &buf->data[start], end - start);
+
+	return count;
+}
+
 /**
  * Reposition the internal pointer of the buffer buf to the start of serialized data.
  * This function takes buffer_offset of the node's transport into account
@@ -0,0 +1,248 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+
+/* Maximum number of distinct argument sets cached per object */
+#define AURA_CACHE_MAX_ENTRIES 16
+
+struct aura_cache_entry {
+	/* Timestamp (ms) after which the entry is stale */
+	uint64_t		expires;
+	/* Export table the object belonged to when the call was started */
+	struct aura_export_table *tbl;
+	/* Actual lengths of the arguments and the response, these vary for variable-size formats */
+	int			args_len;
+	int			ret_len;
+	/* list_entry. Links the entry into object's cache, most recently used first */
+	struct list_head	qentry;
+	/* Serialized arguments (room for arglen bytes) followed by the response (retlen bytes) */
+	char			data[];
+};
+
+static void cache_entry_drop(struct aura_object *o, struct aura_cache_entry *e)
+{
+	list_del(&e->qentry);
+	o->cache_entries--;
+	free(e);
+}
+
+static const char *call_args(struct aura_node *node, struct aura_buffer *argbuf)
+{
+	return &argbuf->data[node->tr->buffer_offset];
+}
+
+/**
+ * \addtogroup internals
+ * @{
+ */
+
+/**
+ * Look up a fresh cached response for a call to object o with arguments in argbuf.
+ *
+ * On a hit the response is copied into a new buffer from node's pool. On a miss
+ * a new cache entry holding a copy of the arguments is returned via entry, so
+ * that the response can be stored with aura_cache_store() once the call completes.
+ * Objects with no cache policy always miss and get no entry.
+ *
+ * @param node
+ * @param o
+ * @param argbuf
+ * @param entry
+ * @return response buffer or NULL on a miss
+ */
+struct aura_buffer *aura_cache_lookup(struct aura_node *node, struct aura_object *o,
+				      struct aura_buffer *argbuf, struct aura_cache_entry **entry)
+{
+	const char *args = call_args(node, argbuf);
+	uint64_t now = aura_platform_timestamp();
+	struct aura_cache_entry *pos, *tmp;
+	struct aura_buffer *buf;
+
+	*entry = NULL;
+	if (!o->cache_ttl_ms)
+		return NULL;
+
+	/* Arguments are the key */
+	aura_buffer_flatten(argbuf);
+
+	list_for_each_entry_safe(pos, tmp, &o->cache, qentry) {
+		if ((pos->args_len != argbuf->payload_size) ||
+		    (memcmp(pos->data, args, pos->args_len) != 0))
+			continue;
+		if (pos->expires <= now) {
+			cache_entry_drop(o, pos);
+			break;
+		}
+
+		buf = aura_buffer_request(node, pos->ret_len);
+		memcpy(&buf->data[node->tr->buffer_offset], &pos->data[o->arglen], pos->ret_len);
+		buf->object = o;
+		buf->payload_size = pos->ret_len;
+		aura_buffer_rewind(buf);
+
+		list_move(&pos->qentry, &o->cache);
+		o->cache_stats.hits++;
+		node->cache_stats.hits++;
+		return buf;
+	}
+
+	o->cache_stats.misses++;
+	node->cache_stats.misses++;
+
+	*entry = malloc(sizeof(struct aura_cache_entry) + o->arglen + o->retlen);
+	if (!*entry)
+		BUG(node, "FATAL: malloc() failed");
+	(*entry)->tbl = node->tbl;
+	(*entry)->args_len = min_t(int, argbuf->payload_size, o->arglen);
+	memcpy((*entry)->data, args, (*entry)->args_len);
+	return NULL;
+}
+
+/**
+ * Fill in a cache entry obtained from aura_cache_lookup() with the call's response
+ * and put it into object's cache. The entry is freed if the call did not complete
+ * or the object is no longer there.
+ *
+ * @param node
+ * @param o
+ * @param entry
+ * @param status
+ * @param retbuf
+ */
+void aura_cache_store(struct aura_node *node, struct aura_object *o,
+		      struct aura_cache_entry *entry, int status, struct aura_buffer *retbuf)
+{
+	struct aura_cache_entry *pos, *tmp;
+
+	if (!entry)
+		return;
+
+	/* The export table may have changed and the policy may have been dropped meanwhile */
+	if ((status != AURA_CALL_COMPLETED) || !retbuf || (entry->tbl != node->tbl) || !o->cache_ttl_ms) {
+		free(entry);
+		return;
+	}
+
+	/* Replace the stale copy, if any, and make room */
+	list_for_each_entry_safe(pos, tmp, &o->cache, qentry)
+		if ((pos->args_len == entry->args_len) &&
+		    (memcmp(pos->data, entry->data, entry->args_len) == 0))
+			cache_entry_drop(o, pos);
+	if (o->cache_entries >= AURA_CACHE_MAX_ENTRIES)
+		cache_entry_drop(o, list_entry(o->cache.prev, struct aura_cache_entry, qentry));
+
+	entry->ret_len = min_t(int, retbuf->payload_size, o->retlen);
+	memcpy(&entry->data[o->arglen], &retbuf->data[node->tr->buffer_offset], entry->ret_len);
+	entry->expires = aura_platform_timestamp() + o->cache_ttl_ms;
+	list_add(&entry->qentry, &o->cache);
+	o->cache_entries++;
+}
+
+/**
+ * Drop all the cached responses of an object
+ *
+ * @param o
+ */
+void aura_cache_flush(struct aura_object *o)
+{
+	struct aura_cache_entry *pos, *tmp;
+
+	list_for_each_entry_safe(pos, tmp, &o->cache, qentry)
+		cache_entry_drop(o, pos);
+}
+
+/**
+ * @}
+ * \addtogroup sync
+ * @{
+ */
+
+/**
+ * Let synchronous calls to a method be served from a cache of recent responses.
+ *
+ * Once a call completes, its response is remembered for ttl_ms milliseconds. Calls
+ * with the same arguments made meanwhile get a copy of it right away, without
+ * touching the transport. Only enable this for methods that have no side effects,
+ * e.g. status and config getters.
+ *
+ * The cache is dropped whenever the node changes status, the policy survives
+ * the node going offline and online as long as the method doesn't change.
+ *
+ * @param node
+ * @param name
+ * @param ttl_ms Time to live in milliseconds, 0 to disable caching
+ * @return 0 on success, -ENOENT if there's no such object, -EBADF if it's an event
+ */
+int aura_object_set_cache(struct aura_node *node, const char *name, int ttl_ms)
+{
+	struct aura_object *o = aura_etable_find(node->tbl, name);
+
+	if (!o)
+		return -ENOENT;
+
+	if (!object_is_method(o))
+		return -EBADF;
+
+	o->cache_ttl_ms = ttl_ms;
+	if (!ttl_ms)
+		aura_cache_flush(o);
+	return 0;
+}
+
+/**
+ * Drop the cached responses of a method, e.g. once you know the device state
+ * has changed.
+ *
+ * @param node
+ * @param name NULL to drop the caches of all methods
+ * @return 0 on success, -ENOENT if there's no such object
+ */
+int aura_cache_invalidate(struct aura_node *node, const char *name)
+{
+	struct aura_object *o;
+	int i;
+
+	if (!node->tbl)
+		return name ? -ENOENT : 0;
+
+	if (name) {
+		o = aura_etable_find(node->tbl, name);
+		if (!o)
+			return -ENOENT;
+		aura_cache_flush(o);
+		return 0;
+	}
+
+	for (i = 0; i < node->tbl->next; i++)
+		aura_cache_flush(&node->tbl->objects[i]);
+	return 0;
+}
+
+/**
+ * Get cache hit and miss counters of a method or the whole node.
+ * Method counters are reset when the export table changes.
+ *
+ * @param node
+ * @param name NULL for the totals of all the methods of the node
+ * @param stats
+ * @return 0 on success, -ENOENT if there's no such object
+ */
+int aura_get_cache_stats(struct aura_node *node, const char *name, struct aura_cache_stats *stats)
+{
+	struct aura_object *o;
+
+	if (!name) {
+		*stats = node->cache_stats;
+		return 0;
+	}
+
+	o = aura_etable_find(node->tbl, name);
+	if (!o)
+		return -ENOENT;
+
+	*stats = o->cache_stats;
+	return 0;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,573 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+#include <aura/timer.h>
+
+/**
+ * \addtogroup internals
+ * @{
+ */
+
+/**
+ * Grab a free call slot for object o and link it to the end of node's
+ * pending call table. Slots are recycled via a per-node pool, so this only
+ * hits malloc() when the number of calls in flight grows.
+ *
+ * @param node
+ * @param o
+ * @param calldonecb
+ * @param arg
+ * @return pointer to the slot
+ */
+struct aura_call_slot *aura_call_slot_get(struct aura_node *node,
+					  struct aura_object *o,
+					  void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg),
+					  void *arg)
+{
+	struct aura_call_slot *slot;
+
+	if (!list_empty(&node->call_slot_pool)) {
+		slot = list_entry(node->call_slot_pool.next, struct aura_call_slot, qentry);
+		list_del(&slot->qentry);
+	} else {
+		slot = calloc(1, sizeof(*slot));
+		if (!slot)
+			BUG(node, "FATAL: malloc() failed");
+	}
+
+	/* Tag 0 marks a free slot, never hand it out */
+	if (!++node->next_call_tag)
+		++node->next_call_tag;
+
+	slot->tag = node->next_call_tag;
+	slot->object = o;
+	slot->calldonecb = calldonecb;
+	slot->arg = arg;
+	slot->batch = NULL;
+	slot->future = NULL;
+	slot->deadline = 0;
+	slot->request = NULL;
+	slot->sent = false;
+	slot->cancelled = false;
+	slot->stale = false;
+	slot->maybe_answered = false;
+	slot->follower = false;
+	slot->coalescable = false;
+	INIT_LIST_HEAD(&slot->followers);
+	o->pending++;
+	list_add_tail(&slot->qentry, &node->pending_calls);
+	return slot;
+}
+
+/**
+ * Unlink the slot from the pending call table and return it to the pool
+ *
+ * @param node
+ * @param slot
+ */
+void aura_call_slot_put(struct aura_node *node, struct aura_call_slot *slot)
+{
+	struct aura_object *o = slot->object;
+
+	if (!slot->tag)
+		BUG(node, "Internal BUG: Releasing a free call slot");
+
+	o->pending--;
+	if (o->pending < 0)
+		BUG(node, "Internal BUG: pending call count lesser than zero");
+
+	if (slot->deadline) {
+		list_del(&slot->dentry);
+		slot->deadline = 0;
+	}
+
+	if (slot->request) {
+		slot->request->slot = NULL;
+		slot->request = NULL;
+	}
+
+	slot->tag = 0;
+	slot->object = NULL;
+	slot->coalescable = false;
+	list_del(&slot->qentry);
+	list_add(&slot->qentry, &node->call_slot_pool);
+}
+
+/**
+ * Find the pending call a response buffer belongs to.
+ *
+ * Transports that hand the request buffer back to the core keep its call tag,
+ * so we match by tag. Responses that arrive in fresh buffers carry no tag. Devices
+ * complete calls to the same method in order, so we take the call to that object
+ * sent first, see aura_call_slot_find_sent(). Calls that timed out after their request was sent leave a stale
+ * slot behind for a while for that to work, so that a late response is dropped
+ * instead of completing the next call, see aura_call_slot_expire().
+ *
+ * @param node
+ * @param buf
+ * @return the matching slot or NULL if there's none
+ */
+struct aura_call_slot *aura_call_slot_find(struct aura_node *node, struct aura_buffer *buf)
+{
+	struct aura_call_slot *pos;
+
+	if (!buf->call_tag)
+		return aura_call_slot_find_sent(node, buf->object);
+
+	list_for_each_entry(pos, &node->pending_calls, qentry)
+		if (pos->tag == buf->call_tag)
+			return pos;
+	return NULL;
+}
+
+/**
+ * Find the call to an object that was sent first and is still pending.
+ * Calls of different priority classes may be sent in another order than they
+ * were started, so this is not necessarily the oldest one.
+ *
+ * @param node
+ * @param o
+ * @return the slot or NULL if no call to o is in flight
+ */
+struct aura_call_slot *aura_call_slot_find_sent(struct aura_node *node, struct aura_object *o)
+{
+	struct aura_call_slot *pos;
+
+	list_for_each_entry(pos, &node->pending_calls, qentry)
+		if ((pos->object == o) && pos->sent)
+			return pos;
+	return NULL;
+}
+
+/**
+ * The transport has taken the request of the call in this slot. Sent calls are
+ * kept in the pending call table in the order they were sent.
+ *
+ * @param node
+ * @param slot
+ */
+void aura_call_slot_sent(struct aura_node *node, struct aura_call_slot *slot)
+{
+	slot->sent = true;
+	list_move_tail(&slot->qentry, &node->pending_calls);
+}
+
+/**
+ * Account for a response matched to the call in this slot before completing it.
+ *
+ * Devices answer calls to the same method in order. Once a tagged response
+ * arrives, the stale slots of the calls before it won't get their responses
+ * anymore, so they are released. An untagged response taken by a stale slot may
+ * as well be the one of the next call in flight, if the device dropped the timed
+ * out request. That call doesn't leave a stale slot of its own if it times out,
+ * so that one dropped request can't cost every following call its response.
+ *
+ * @param node
+ * @param slot
+ * @param buf the response
+ */
+void aura_call_slot_answered(struct aura_node *node, struct aura_call_slot *slot, struct aura_buffer *buf)
+{
+	struct aura_call_slot *pos, *tmp;
+
+	if (buf->call_tag) {
+		list_for_each_entry_safe(pos, tmp, &node->pending_calls, qentry) {
+			if (pos == slot)
+				break;
+			if (pos->stale && (pos->object == slot->object))
+				aura_call_slot_put(node, pos);
+		}
+	} else if (slot->stale) {
+		pos = slot;
+		list_for_each_entry_continue(pos, &node->pending_calls, qentry) {
+			if ((pos->object == slot->object) && !pos->stale && pos->sent) {
+				pos->maybe_answered = true;
+				break;
+			}
+		}
+	}
+}
+
+static struct aura_buffer *buffer_clone(struct aura_node *node, struct aura_buffer *buf)
+{
+	struct aura_buffer *ret = aura_buffer_request(node, buf->size - node->tr->buffer_overhead);
+
+	memcpy(ret->data, buf->data, buf->size);
+	ret->object = buf->object;
+	ret->payload_size = buf->payload_size;
+	ret->pos = buf->pos;
+	return ret;
+}
+
+/**
+ * Find a call in flight an identical call to object o with arguments in buf can join.
+ *
+ * @param node
+ * @param o
+ * @param buf
+ * @return the slot of the call or NULL if there's none
+ */
+struct aura_call_slot *aura_call_slot_find_leader(struct aura_node *node, struct aura_object *o,
+						  struct aura_buffer *buf)
+{
+	const char *args = &buf->data[node->tr->buffer_offset];
+	struct aura_call_slot *pos;
+
+	/* We compare arguments byte by byte */
+	aura_buffer_flatten(buf);
+	list_for_each_entry(pos, &node->pending_calls, qentry) {
+		if ((pos->object != o) || !pos->coalescable || pos->cancelled)
+			continue;
+		if ((pos->args_len == buf->payload_size) &&
+		    (memcmp(pos->args, args, buf->payload_size) == 0))
+			return pos;
+	}
+	return NULL;
+}
+
+/**
+ * Let identical calls join the call in this slot. Keeps a copy of the arguments
+ * serialized in buf to compare the new calls with.
+ *
+ * @param node
+ * @param slot
+ * @param buf
+ */
+void aura_call_slot_lead(struct aura_node *node, struct aura_call_slot *slot, struct aura_buffer *buf)
+{
+	int len = buf->payload_size;
+
+	if (slot->args_size < len) {
+		char *args = realloc(slot->args, len);
+		if (!args)
+			BUG(node, "FATAL: malloc() failed");
+		slot->args = args;
+		slot->args_size = len;
+	}
+	memcpy(slot->args, &buf->data[node->tr->buffer_offset], len);
+	slot->args_len = len;
+	slot->coalescable = true;
+}
+
+/**
+ * Make the call in slot wait for the response of the leader call instead of
+ * sending a request of its own. The slot leaves the pending call table, so
+ * responses are only matched to the leader, but keeps its own deadline.
+ *
+ * @param leader
+ * @param slot
+ */
+void aura_call_slot_follow(struct aura_call_slot *leader, struct aura_call_slot *slot)
+{
+	slot->follower = true;
+	list_move_tail(&slot->qentry, &leader->followers);
+}
+
+/**
+ * Complete the call in this slot with the specified status.
+ * The slot is released before the callback fires, so that the callback may
+ * issue new calls. The response buffer (if any) is either handed to the callback
+ * and released afterwards, or passed over to the future or the synchronous call
+ * waiting for it.
+ *
+ * @param node
+ * @param slot
+ * @param status
+ * @param buf response buffer or NULL
+ */
+void aura_call_slot_complete(struct aura_node *node, struct aura_call_slot *slot,
+			     int status, struct aura_buffer *buf)
+{
+	void (*calldonecb)(struct aura_node *dev, int status, struct aura_buffer *ret, void *arg);
+	void *arg = slot->arg;
+	struct aura_call_batch *batch = slot->batch;
+	struct aura_future *future = slot->future;
+	uint32_t tag = slot->tag;
+	struct aura_call_slot *pos, *tmp;
+	LIST_HEAD(followers);
+
+	calldonecb = slot->calldonecb;
+	if (slot->cancelled) {
+		calldonecb = NULL;
+		future = NULL;
+	}
+	list_splice_init(&slot->followers, &followers);
+	aura_call_slot_put(node, slot);
+
+	/* The slot is gone, so new calls made by the callbacks won't join it */
+	list_for_each_entry_safe(pos, tmp, &followers, qentry)
+		aura_call_slot_complete(node, pos, status, buf ? buffer_clone(node, buf) : NULL);
+
+	if (calldonecb) {
+		calldonecb(node, status, buf, arg);
+		if (buf)
+			aura_buffer_release(buf);
+	} else if (future) {
+		aura_future_complete(future, status, buf);
+	} else if (node->sync_call_running && (node->sync_call_tag == tag)) {
+		node->sync_call_result = status;
+		node->sync_ret_buf = buf;
+		node->sync_call_tag = 0;
+	} else if (buf) {
+		aura_buffer_release(buf);
+	}
+
+	if (batch)
+		aura_call_batch_call_done(batch, status);
+}
+
+/**
+ * Remember buf as the request of the call in this slot, so that it can
+ * be taken out of the outbound queue in O(1) until the transport picks it up.
+ *
+ * @param slot
+ * @param buf
+ */
+void aura_call_slot_attach(struct aura_call_slot *slot, struct aura_buffer *buf)
+{
+	buf->call_tag = slot->tag;
+	buf->slot = slot;
+	slot->request = buf;
+	slot->sent = false;
+}
+
+/**
+ * Take the request buffer of the call in this slot out of the outbound queue
+ * and return it to the pool. Buffers already handed over to the transport are
+ * left alone, see aura_call_slot_expire() for what happens to their responses.
+ *
+ * @param node
+ * @param slot
+ * @return 1 if the request never reached the transport, 0 otherwise
+ */
+int aura_call_slot_reclaim(struct aura_node *node, struct aura_call_slot *slot)
+{
+	struct aura_buffer *buf = slot->request;
+
+	if (!buf || (buf == node->outbound_peeked))
+		return 0;
+
+	aura_node_outbound_remove(node, buf);
+	aura_buffer_release(buf);
+	return 1;
+}
+
+/**
+ * Cancel the call in this slot. A request that is still queued is dropped and
+ * the slot is released right away. If the request has already been handed over
+ * to the transport, the slot stays in the pending call table, so that the response
+ * is still matched to it, and is released quietly once that arrives.
+ * Neither way the completion callback fires.
+ *
+ * @param node
+ * @param slot
+ * @return 1 if the request never reached the transport, 0 otherwise
+ */
+int aura_call_slot_cancel(struct aura_node *node, struct aura_call_slot *slot)
+{
+	slot->cancelled = true;
+	/* Others still wait for the response */
+	if (!list_empty(&slot->followers))
+		return 0;
+	if (!aura_call_slot_reclaim(node, slot))
+		return 0;
+
+	aura_call_slot_complete(node, slot, AURA_CALL_TRANSPORT_FAIL, NULL);
+	return 1;
+}
+
+static void deadline_timer_arm(struct aura_node *node)
+{
+	struct aura_call_slot *first;
+	struct timeval tv;
+	uint64_t now = aura_platform_timestamp();
+	uint64_t delay = 0;
+
+	if (aura_timer_is_active(node->deadline_timer))
+		aura_timer_stop(node->deadline_timer);
+
+	if (list_empty(&node->call_deadlines))
+		return;
+
+	first = list_entry(node->call_deadlines.next, struct aura_call_slot, dentry);
+	if (first->deadline > now)
+		delay = first->deadline - now;
+
+	tv.tv_sec = delay / 1000;
+	tv.tv_usec = (delay % 1000) * 1000;
+	/* Zero timeout means 'disarm' to some eventloop backends */
+	if (!delay)
+		tv.tv_usec = 1;
+	aura_timer_start(node->deadline_timer, 0, &tv);
+}
+
+/**
+ * Fail the call in this slot with AURA_CALL_TIMEOUT. If the request has already
+ * been sent, a stale slot takes its place in the pending call table until the
+ * response arrives or the late response window passes, so that the response
+ * can't be taken for the one of the next call to the same method. Stale slots
+ * themselves just go away once their time is up.
+ *
+ * @param node
+ * @param slot
+ */
+void aura_call_slot_expire(struct aura_node *node, struct aura_call_slot *slot)
+{
+	if (slot->stale) {
+		aura_call_slot_put(node, slot);
+		return;
+	}
+
+	if (!aura_call_slot_reclaim(node, slot) && !slot->follower &&
+	    !slot->maybe_answered && (node->late_response_window_ms > 0)) {
+		struct aura_call_slot *stale = aura_call_slot_get(node, slot->object, NULL, NULL);
+
+		/* Same tag and place in the table */
+		stale->tag = slot->tag;
+		stale->cancelled = true;
+		stale->stale = true;
+		stale->sent = true;
+		list_move(&stale->qentry, &slot->qentry);
+		aura_call_slot_set_deadline(node, stale, node->late_response_window_ms);
+	}
+	aura_call_slot_complete(node, slot, AURA_CALL_TIMEOUT, NULL);
+}
+
+static void deadline_timer_cb(struct aura_node *node, struct aura_timer *tm, void *arg)
+{
+	uint64_t now = aura_platform_timestamp();
+
+	while (!list_empty(&node->call_deadlines)) {
+		struct aura_call_slot *slot;
+		slot = list_entry(node->call_deadlines.next, struct aura_call_slot, dentry);
+		if (slot->deadline > now)
+			break;
+		if (!slot->stale)
+			slog(2, SLOG_WARN, "Call %u for method %d (%s) timed out",
+			     slot->tag, slot->object->id, slot->object->name);
+		aura_call_slot_expire(node, slot);
+	}
+
+	deadline_timer_arm(node);
+}
+
+/**
+ * Fail the call in this slot with AURA_CALL_TIMEOUT if it doesn't complete
+ * within timeout_ms milliseconds.
+ *
+ * All the deadlines of a node are kept in a single sorted list with one eventloop
+ * timer armed for the earliest one.
+ *
+ * @param node
+ * @param slot
+ * @param timeout_ms
+ */
+void aura_call_slot_set_deadline(struct aura_node *node, struct aura_call_slot *slot, int timeout_ms)
+{
+	struct list_head *pos;
+
+	slot->deadline = aura_platform_timestamp() + timeout_ms;
+
+	/* Calls mostly share the same timeout, so look for our place from the end */
+	for (pos = node->call_deadlines.prev; pos != &node->call_deadlines; pos = pos->prev) {
+		struct aura_call_slot *tmp = list_entry(pos, struct aura_call_slot, dentry);
+		if (tmp->deadline <= slot->deadline)
+			break;
+	}
+	list_add(&slot->dentry, pos);
+
+	if (!node->deadline_timer)
+		node->deadline_timer = aura_timer_create(node, deadline_timer_cb, NULL);
+
+	/* Only a new earliest deadline requires rearming */
+	if (node->call_deadlines.next == &slot->dentry)
+		deadline_timer_arm(node);
+}
+
+/**
+ * Fail all the calls in node's pending call table with
+ * AURA_CALL_TRANSPORT_FAIL status.
+ *
+ * @param node
+ */
+void aura_call_table_fail_all(struct aura_node *node)
+{
+	while (!list_empty(&node->pending_calls)) {
+		struct aura_call_slot *slot;
+		slot = list_entry(node->pending_calls.next, struct aura_call_slot, qentry);
+		aura_call_slot_complete(node, slot, AURA_CALL_TRANSPORT_FAIL, NULL);
+	}
+}
+
+static void slot_free(struct aura_call_slot *slot)
+{
+	struct aura_call_slot *pos, *tmp;
+
+	list_for_each_entry_safe(pos, tmp, &slot->followers, qentry)
+		slot_free(pos);
+
+	if (slot->batch)
+		aura_call_batch_call_drop(slot->batch);
+	if (slot->future)
+		aura_future_drop(slot->future);
+	list_del(&slot->qentry);
+	free(slot->args);
+	free(slot);
+}
+
+/**
+ * Free all the call slots. No callbacks are fired.
+ *
+ * @param node
+ */
+void aura_call_table_destroy(struct aura_node *node)
+{
+	struct aura_call_slot *pos, *tmp;
+
+	list_for_each_entry_safe(pos, tmp, &node->pending_calls, qentry)
+		slot_free(pos);
+
+	list_for_each_entry_safe(pos, tmp, &node->call_slot_pool, qentry) {
+		list_del(&pos->qentry);
+		free(pos->args);
+		free(pos);
+	}
+}
+
+/**
+ * @}
+ * \addtogroup async
+ * @{
+ */
+
+/**
+ * Let identical calls to a method share a single request. A call with the same
+ * serialized arguments as a call that is already queued or in flight doesn't go to the
+ * node, but waits for the response of that one. The response is then copied
+ * to every caller, synchronous or not.
+ *
+ * Waiting calls keep their own deadlines and can be cancelled on their own,
+ * but if the call they wait for fails or times out, so do they. Only enable
+ * this for methods that have no side effects. Batched calls are never coalesced.
+ *
+ * @param node
+ * @param name
+ * @param enable
+ * @return 0 on success, -ENOENT if there's no such object, -EBADF if it's an event
+ */
+int aura_object_set_coalescing(struct aura_node *node, const char *name, bool enable)
+{
+	struct aura_object *o = aura_etable_find(node->tbl, name);
+
+	if (!o)
+		return -ENOENT;
+
+	if (!object_is_method(o))
+		return -EBADF;
+
+	o->coalesce = enable;
+	return 0;
+}
+
+/**
+ * @}
+ */
@@ -182,6 +182,7 @@ void aura_eventloop_destroy(struct aura_eventloop *loop)
 		aura_eventloop_del(node);
 	}
 
+	aura_eventloop_xcall_cleanup(loop);
 	loop->module->destroy(loop);
 	free(loop);
 }
@@ -210,6 +211,49 @@ void aura_eventloop_loopexit(struct aura_eventloop *loop, struct timeval *tv)
 	loop->module->loopbreak(loop, tv);
 }
 
+/**
+ * Wake up the loop from any thread. The loop will run its wakeup callback
+ * (see aura_eventloop_wakeup_cb()) and start any calls submitted from other threads.
+ *
+ * @param loop
+ * @return 0 on success, -ENOSYS if the eventloop module doesn't support this
+ */
+int aura_eventloop_wakeup(struct aura_eventloop *loop)
+{
+	if (!loop->module->wakeup)
+		return -ENOSYS;
+	loop->module->wakeup(loop);
+	return 0;
+}
+
+/**
+ * Set the callback to be called from the thread running the loop each time
+ * the loop is woken up with aura_eventloop_wakeup().
+ *
+ * @param loop
+ * @param cb
+ * @param arg
+ */
+void aura_eventloop_wakeup_cb(struct aura_eventloop *loop,
+			      void (*cb)(struct aura_eventloop *loop, void *arg),
+			      void *arg)
+{
+	loop->wakeup_cb = cb;
+	loop->wakeup_arg = arg;
+}
+
 /**
  * @}
  */
+
+/**
+ * Handle a wakeup. Eventloop modules call this one from the loop thread.
+ *
+ * @param loop
+ */
+void aura_eventloop_process_wakeup(struct aura_eventloop *loop)
+{
+	aura_eventloop_xcall_process(loop);
+	if (loop->wakeup_cb)
+		loop->wakeup_cb(loop, loop->wakeup_arg);
+}
@@ -1,4 +1,5 @@
 #include <aura/aura.h>
+#include <aura/private.h>
 #include <search.h>
 
 struct aura_export_table *aura_etable_create(struct aura_node *owner, int n)
@@ -42,6 +43,8 @@ void aura_etable_add(struct aura_export_table * tbl,
 
 	target = &tbl->objects[tbl->next];
 	target->id = tbl->next++;
+	target->prio = AURA_CALL_PRIO_NORMAL;
+	INIT_LIST_HEAD(&target->cache);
 	if (!name)
 		BUG(tbl->owner, "Internal BUG: object name can't be nil");
 	else
@@ -66,9 +69,11 @@ void aura_etable_add(struct aura_export_table * tbl,
 	if (!target->valid)
 		slog(0, SLOG_WARN, "Object %d (%s) has corrupt export table",
 		     target->id, target->name);
-	/* Calculate the sizes required */
-	target->arglen = aura_fmt_len(tbl->owner, argfmt);
-	target->retlen = aura_fmt_len(tbl->owner, retfmt);
+	/* Compile the formats and calculate the sizes required */
+	target->arg_plan = aura_fmt_compile(tbl->owner, argfmt);
+	target->ret_plan = aura_fmt_compile(tbl->owner, retfmt);
+	target->arglen = target->arg_plan ? target->arg_plan->len : 0;
+	target->retlen = target->ret_plan ? target->ret_plan->len : 0;
 
 	/* Add this shit to index */
 	e.key = target->name;
@@ -104,9 +109,43 @@ struct aura_object *aura_etable_find_id(struct aura_export_table *	tbl,
 	return &tbl->objects[id];
 }
 
+/* FNV-1a, NULL strings hash differently from empty ones */
+static uint32_t fingerprint_str(uint32_t hash, const char *str)
+{
+	if (!str)
+		return (hash ^ 0xff) * 16777619u;
+
+	do {
+		hash = (hash ^ (uint8_t)*str) * 16777619u;
+	} while (*str++);
+	return hash;
+}
+
+/**
+ * Calculate the fingerprint of an export table: a hash of the names and the
+ * formats of all the objects, in the order of their ids. Tables that hash
+ * the same can be called with the same ids and the same serialized data.
+ * Code generated by aura-codegen compares this with the one it was made for.
+ *
+ * @param tbl
+ * @return the fingerprint
+ */
+uint32_t aura_etable_fingerprint(struct aura_export_table *tbl)
+{
+	uint32_t hash = 2166136261u;
+	int i;
+
+	for (i = 0; i < tbl->next; i++) {
+		hash = fingerprint_str(hash, tbl->objects[i].name);
+		hash = fingerprint_str(hash, tbl->objects[i].arg_fmt);
+		hash = fingerprint_str(hash, tbl->objects[i].ret_fmt);
+	}
+	return hash;
+}
+
 #define format_matches(one, two) \
 	((!one && !two) || \
-	 (one && two && strcmp(one, two)))
+	 (one && two && !strcmp(one, two)))
 
 static int object_is_equal(struct aura_object *one, struct aura_object *two)
 {
@@ -135,6 +174,14 @@ static int migrate_object(struct aura_object *src, struct aura_object *dst)
 	if (object_is_equal(src, dst)) {
 		dst->calldonecb = src->calldonecb;
 		dst->arg = src->arg;
+		dst->prio = src->prio;
+		dst->cache_ttl_ms = src->cache_ttl_ms;
+		dst->coalesce = src->coalesce;
+		/* Same formats, same struct layouts */
+		dst->arg_map = src->arg_map;
+		dst->ret_map = src->ret_map;
+		src->arg_map = NULL;
+		src->ret_map = NULL;
 		slog(4, SLOG_DEBUG, "etable: Successful migration of obj %d->%d (%s)", src->id, dst->id, dst->name);
 		return 1;
 	}
@@ -215,6 +262,7 @@ void aura_etable_activate(struct aura_export_table *tbl)
 		etable_migrate(node->tbl, tbl);
 		aura_etable_destroy(node->tbl);
 	}
+	tbl->fingerprint = aura_etable_fingerprint(tbl);
 	node->tbl = tbl;
 }
 
@@ -226,6 +274,7 @@ void aura_etable_destroy(struct aura_export_table *tbl)
 	for (i = 0; i < tbl->next; i++) {
 		struct aura_object *tmp;
 		tmp = &tbl->objects[i];
+		aura_cache_flush(tmp);
 		free(tmp->name);
 		if (tmp->arg_fmt)
 			free(tmp->arg_fmt);
@@ -235,6 +284,10 @@ void aura_etable_destroy(struct aura_export_table *tbl)
 			free(tmp->arg_pprinted);
 		if (tmp->ret_pprinted)
 			free(tmp->ret_pprinted);
+		free(tmp->arg_plan);
+		free(tmp->ret_plan);
+		free(tmp->arg_map);
+		free(tmp->ret_map);
 	}
 	/* Get rid of the table itself */
 	hdestroy_r(&tbl->index);
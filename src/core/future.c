@@ -0,0 +1,306 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+#include <aura/eventloop.h>
+#include <aura/timer.h>
+
+struct aura_future {
+	struct aura_node *	node;
+	int			status;
+	bool			done;
+	/* Released by the user before the call completed */
+	bool			released;
+	struct aura_buffer *	retbuf;
+	/* list_entry. Links the future into node's future pool */
+	struct list_head	qentry;
+};
+
+static struct aura_future *future_get(struct aura_node *node)
+{
+	struct aura_future *f;
+
+	if (!list_empty(&node->future_pool)) {
+		f = list_entry(node->future_pool.next, struct aura_future, qentry);
+		list_del(&f->qentry);
+	} else {
+		f = malloc(sizeof(*f));
+		if (!f)
+			BUG(node, "FATAL: malloc() failed");
+	}
+
+	f->node = node;
+	f->status = 0;
+	f->done = false;
+	f->released = false;
+	f->retbuf = NULL;
+	return f;
+}
+
+static void future_put(struct aura_future *f)
+{
+	if (f->retbuf)
+		aura_buffer_release(f->retbuf);
+	f->retbuf = NULL;
+	list_add(&f->qentry, &f->node->future_pool);
+}
+
+/**
+ * Complete the future with the call status and response buffer (if any).
+ *
+ * @param future
+ * @param status
+ * @param buf
+ */
+void aura_future_complete(struct aura_future *future, int status, struct aura_buffer *buf)
+{
+	future->status = status;
+	future->retbuf = buf;
+	future->done = true;
+	if (future->released)
+		future_put(future);
+}
+
+/**
+ * Drop the future of a call that will never complete (e.g. when the node is closed).
+ * Futures already released by the user are freed right away.
+ *
+ * @param future
+ */
+void aura_future_drop(struct aura_future *future)
+{
+	if (future->released)
+		free(future);
+}
+
+/**
+ * Free all the futures in node's pool
+ *
+ * @param node
+ */
+void aura_future_pool_destroy(struct aura_node *node)
+{
+	struct aura_future *pos, *tmp;
+
+	list_for_each_entry_safe(pos, tmp, &node->future_pool, qentry) {
+		list_del(&pos->qentry);
+		free(pos);
+	}
+}
+
+static void future_timer_cb(struct aura_node *node, struct aura_timer *tm, void *arg)
+{
+	bool *expired = arg;
+
+	*expired = true;
+}
+
+static bool futures_ready(struct aura_future **futures, int count, bool all, int *which)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		if (futures[i]->done && !all) {
+			*which = i;
+			return true;
+		}
+		if (!futures[i]->done && all)
+			return false;
+	}
+	return all;
+}
+
+static int futures_wait(struct aura_future **futures, int count, int timeout_ms, bool all)
+{
+	struct aura_node *node = futures[0]->node;
+	struct aura_eventloop *loop = aura_node_eventloop_get_autocreate(node);
+	bool expired = false;
+	int which = 0;
+	int i;
+
+	for (i = 1; i < count; i++)
+		if (aura_node_eventloop_get(futures[i]->node) != loop)
+			BUG(node, "Can't wait for futures of nodes that don't share an eventloop");
+
+	if (futures_ready(futures, count, all, &which))
+		return which;
+
+	if (timeout_ms == 0) {
+		aura_eventloop_dispatch(loop, AURA_EVTLOOP_NONBLOCK);
+		return futures_ready(futures, count, all, &which) ? which : -ETIMEDOUT;
+	}
+
+	if (timeout_ms > 0) {
+		struct timeval tv;
+
+		if (!node->future_timer)
+			node->future_timer = aura_timer_create(node, future_timer_cb, NULL);
+		if (aura_timer_is_active(node->future_timer))
+			BUG(node, "Nested waits for futures of the same node are not supported");
+
+		aura_timer_update(node->future_timer, future_timer_cb, &expired);
+		tv.tv_sec = timeout_ms / 1000;
+		tv.tv_usec = (timeout_ms % 1000) * 1000;
+		aura_timer_start(node->future_timer, 0, &tv);
+	}
+
+	while (!futures_ready(futures, count, all, &which)) {
+		if (expired)
+			return -ETIMEDOUT;
+		aura_eventloop_dispatch(loop, AURA_EVTLOOP_ONCE);
+	}
+
+	if (timeout_ms > 0)
+		aura_timer_stop(node->future_timer);
+
+	return which;
+}
+
+/** \addtogroup async
+ *  @{
+ */
+
+/**
+ * Start a call to an object identified by name and return a future that
+ * will hold the result. Wait for it with aura_future_wait(), aura_future_wait_all()
+ * or aura_future_wait_any(), and release it with aura_future_release() when done.
+ *
+ * Futures are recycled via a per-node pool, so once the pool is warmed up
+ * no memory is allocated. All the futures must be released before the node is closed.
+ *
+ * This function never fails. If the call could not be started the future
+ * is complete right away and its status is the negative error code:
+ * -ENOENT if there's no such object, -ENODATA if serialization failed,
+ * -ENOEXEC if the node is currently offline.
+ *
+ * @param node
+ * @param name
+ * @return the future
+ */
+struct aura_future *aura_call_async(struct aura_node *node, const char *name, ...)
+{
+	struct aura_future *f = future_get(node);
+	struct aura_object *o;
+	struct aura_buffer *buf;
+	va_list ap;
+	int ret;
+
+	o = aura_etable_find(node->tbl, name);
+	if (!o) {
+		aura_future_complete(f, -ENOENT, NULL);
+		return f;
+	}
+
+	va_start(ap, name);
+	buf = aura_serialize_plan(node, o->arg_plan, ap);
+	va_end(ap);
+	if (!buf) {
+		aura_future_complete(f, -ENODATA, NULL);
+		return f;
+	}
+
+	ret = aura_core_start_call_future(node, o, f, buf);
+	if (ret != 0) {
+		aura_buffer_release(buf);
+		aura_future_complete(f, ret, NULL);
+	}
+
+	return f;
+}
+
+/**
+ * Wait for the future to complete, dispatching node's eventloop meanwhile.
+ *
+ * @param future
+ * @param timeout_ms 0 to just check, negative to wait forever
+ * @return 0 if the future is complete, -ETIMEDOUT otherwise
+ */
+int aura_future_wait(struct aura_future *future, int timeout_ms)
+{
+	int ret = futures_wait(&future, 1, timeout_ms, true);
+
+	return (ret < 0) ? ret : 0;
+}
+
+/**
+ * Wait for all of the futures to complete. The futures may belong to different
+ * nodes, but the nodes must share the same eventloop.
+ *
+ * @param futures
+ * @param count
+ * @param timeout_ms 0 to just check, negative to wait forever
+ * @return 0 if all the futures are complete, -ETIMEDOUT otherwise
+ */
+int aura_future_wait_all(struct aura_future **futures, int count, int timeout_ms)
+{
+	int ret;
+
+	if (!count)
+		return 0;
+	ret = futures_wait(futures, count, timeout_ms, true);
+	return (ret < 0) ? ret : 0;
+}
+
+/**
+ * Wait for any of the futures to complete. The futures may belong to different
+ * nodes, but the nodes must share the same eventloop.
+ *
+ * @param futures
+ * @param count
+ * @param timeout_ms 0 to just check, negative to wait forever
+ * @return index of the first complete future in the array, -ETIMEDOUT if none
+ */
+int aura_future_wait_any(struct aura_future **futures, int count, int timeout_ms)
+{
+	if (!count)
+		return -EINVAL;
+	return futures_wait(futures, count, timeout_ms, false);
+}
+
+/**
+ * @param future
+ * @return true if the call has completed
+ */
+bool aura_future_done(struct aura_future *future)
+{
+	return future->done;
+}
+
+/**
+ * @param future
+ * @return AURA_CALL_* status of a completed call or a negative error code
+ *         if the call could not be started
+ */
+int aura_future_status(struct aura_future *future)
+{
+	return future->status;
+}
+
+/**
+ * Get the response buffer of a completed call. The buffer belongs to the future
+ * and is released along with it.
+ *
+ * @param future
+ * @return response buffer or NULL if the call did not complete successfully
+ */
+struct aura_buffer *aura_future_retbuf(struct aura_future *future)
+{
+	return future->retbuf;
+}
+
+/**
+ * Release the future, returning it to node's pool. If the call has not completed
+ * yet, the future is recycled once it does and the result is discarded.
+ *
+ * @param future
+ */
+void aura_future_release(struct aura_future *future)
+{
+	if (!future->done) {
+		future->released = true;
+		return;
+	}
+	future_put(future);
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,331 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+#include <pthread.h>
+
+/*
+ * Process-wide buffer pool, shared by all the nodes that use the default
+ * allocator. Each thread keeps two magazines (small stacks of free buffers)
+ * per size class and only touches the shared depot to trade a whole magazine
+ * when both of them run empty or full, so the fast path takes no locks.
+ */
+
+#define MAGAZINE_ROUNDS 16
+
+struct magazine {
+	int			rounds;
+	struct aura_buffer *	bufs[MAGAZINE_ROUNDS];
+	struct magazine *	next;
+};
+
+struct depot {
+	pthread_mutex_t			lock;
+	/* Magazines with buffers in them and spare empty ones */
+	struct magazine *		full;
+	struct magazine *		empty;
+	/* count is the number of buffers in the depot, gc_threshold its limit */
+	struct aura_bufferpool_stats	stats;
+};
+
+struct thread_cache {
+	struct magazine *	loaded[AURA_BUFFER_POOL_CLASSES];
+	struct magazine *	prev[AURA_BUFFER_POOL_CLASSES];
+};
+
+static struct depot depots[AURA_BUFFER_POOL_CLASSES];
+static bool global_enabled;
+static pthread_key_t cache_key;
+static __thread struct thread_cache *tcache;
+
+static void buffers_free(struct magazine *m)
+{
+	while (m->rounds)
+		free(m->bufs[--m->rounds]);
+}
+
+/* Put a magazine with buffers into the depot, or free the buffers if it's full */
+static void depot_put_full(struct depot *d, struct magazine *m)
+{
+	pthread_mutex_lock(&d->lock);
+	if ((d->stats.gc_threshold >= 0) &&
+	    (d->stats.count + m->rounds > d->stats.gc_threshold)) {
+		d->stats.dropped += m->rounds;
+		pthread_mutex_unlock(&d->lock);
+		buffers_free(m);
+		pthread_mutex_lock(&d->lock);
+		m->next = d->empty;
+		d->empty = m;
+	} else {
+		d->stats.count += m->rounds;
+		m->next = d->full;
+		d->full = m;
+	}
+	pthread_mutex_unlock(&d->lock);
+}
+
+/* Returns the thread's magazines to the depots when the thread exits */
+static void thread_cache_destroy(void *arg)
+{
+	struct thread_cache *tc = arg;
+	int i;
+
+	for (i = 0; i < AURA_BUFFER_POOL_CLASSES; i++) {
+		struct magazine *mags[2] = { tc->loaded[i], tc->prev[i] };
+		int j;
+
+		for (j = 0; j < 2; j++) {
+			if (!mags[j])
+				continue;
+			if (mags[j]->rounds)
+				depot_put_full(&depots[i], mags[j]);
+			else
+				free(mags[j]);
+		}
+	}
+	free(tc);
+	tcache = NULL;
+}
+
+static struct thread_cache *thread_cache_get(void)
+{
+	if (tcache)
+		return tcache;
+
+	tcache = calloc(1, sizeof(*tcache));
+	if (tcache)
+		pthread_setspecific(cache_key, tcache);
+	return tcache;
+}
+
+static struct magazine *magazine_get_empty(struct depot *d)
+{
+	struct magazine *m;
+
+	pthread_mutex_lock(&d->lock);
+	m = d->empty;
+	if (m)
+		d->empty = m->next;
+	pthread_mutex_unlock(&d->lock);
+
+	if (!m)
+		m = calloc(1, sizeof(*m));
+	return m;
+}
+
+bool aura_globalpool_enabled(void)
+{
+	return global_enabled;
+}
+
+/* Take a buffer of size class cls, NULL if there are none */
+struct aura_buffer *aura_globalpool_get(int cls)
+{
+	struct thread_cache *tc = thread_cache_get();
+	struct depot *d = &depots[cls];
+	struct magazine *m, *full;
+
+	if (!tc)
+		return NULL;
+
+	m = tc->loaded[cls];
+	if (m && m->rounds)
+		return m->bufs[--m->rounds];
+
+	m = tc->prev[cls];
+	if (m && m->rounds) {
+		tc->prev[cls] = tc->loaded[cls];
+		tc->loaded[cls] = m;
+		return m->bufs[--m->rounds];
+	}
+
+	/* Both are empty, trade one of them for a full magazine */
+	pthread_mutex_lock(&d->lock);
+	full = d->full;
+	if (full) {
+		d->full = full->next;
+		d->stats.count -= full->rounds;
+		d->stats.hits++;
+		if (tc->prev[cls]) {
+			tc->prev[cls]->next = d->empty;
+			d->empty = tc->prev[cls];
+		}
+		tc->prev[cls] = tc->loaded[cls];
+		tc->loaded[cls] = full;
+	} else {
+		d->stats.misses++;
+	}
+	pthread_mutex_unlock(&d->lock);
+
+	return full ? full->bufs[--full->rounds] : NULL;
+}
+
+/* Return a buffer of the default allocator into its size class */
+void aura_globalpool_put(struct aura_buffer *buf)
+{
+	struct thread_cache *tc = thread_cache_get();
+	int cls = buf->pool_class;
+	struct depot *d = &depots[cls];
+	struct magazine *m;
+
+	if (!tc) {
+		free(buf);
+		return;
+	}
+
+	m = tc->loaded[cls];
+	if (m && (m->rounds < MAGAZINE_ROUNDS)) {
+		m->bufs[m->rounds++] = buf;
+		return;
+	}
+
+	m = tc->prev[cls];
+	if (m && (m->rounds < MAGAZINE_ROUNDS)) {
+		tc->prev[cls] = tc->loaded[cls];
+		tc->loaded[cls] = m;
+		m->bufs[m->rounds++] = buf;
+		return;
+	}
+
+	/* Both are full (or missing), hand one over to the depot */
+	m = magazine_get_empty(d);
+	if (!m) {
+		free(buf);
+		return;
+	}
+	if (tc->prev[cls])
+		depot_put_full(d, tc->prev[cls]);
+	tc->prev[cls] = tc->loaded[cls];
+	tc->loaded[cls] = m;
+	m->bufs[m->rounds++] = buf;
+}
+
+/** \addtogroup bufapi
+ * @{
+ */
+
+/**
+ * Make the nodes opened from now on use the process-wide buffer pool instead of their own.
+ * Buffers released by one node can then be reused by any other, and the memory kept in the
+ * pool is limited for the whole process rather than per node. Nodes with a
+ * transport-specific allocator always keep their own pools.
+ *
+ * Setting AURA_GLOBAL_BUFFER_POOL environment variable to the maximum number of
+ * buffers per size class does the same at startup.
+ *
+ * @param enable
+ */
+void aura_bufferpool_global_enable(bool enable)
+{
+	global_enabled = enable;
+}
+
+/**
+ * Limit the number of free buffers the shared depot of the global pool keeps per
+ * size class. Each thread caches up to 32 more buffers per class on top of that.
+ *
+ * @param max_buffers The limit, -1 for none
+ */
+void aura_bufferpool_global_set_limit(int max_buffers)
+{
+	int i;
+
+	for (i = 0; i < AURA_BUFFER_POOL_CLASSES; i++) {
+		pthread_mutex_lock(&depots[i].lock);
+		depots[i].stats.gc_threshold = max_buffers;
+		pthread_mutex_unlock(&depots[i].lock);
+	}
+}
+
+/**
+ * Get the counters of the global pool's depot for the size class of buffers of
+ * size bytes, transport overhead included. Hits and misses count the magazines
+ * threads got or failed to get from the depot.
+ *
+ * @param size Buffer size
+ * @param stats Where to put the counters
+ * @return 0 on success, -ERANGE if buffers of this size are not pooled
+ */
+int aura_bufferpool_global_get_stats(int size, struct aura_bufferpool_stats *stats)
+{
+	int cls = aura_bufferpool_class(size);
+
+	if (cls < 0)
+		return -ERANGE;
+	pthread_mutex_lock(&depots[cls].lock);
+	*stats = depots[cls].stats;
+	pthread_mutex_unlock(&depots[cls].lock);
+	return 0;
+}
+
+/**
+ * Free all the buffers in the global pool's depot and in the calling thread's cache.
+ * Other threads give their caches back to the depot when they exit.
+ */
+void aura_bufferpool_global_drain(void)
+{
+	int i;
+
+	if (tcache) {
+		for (i = 0; i < AURA_BUFFER_POOL_CLASSES; i++) {
+			struct magazine *mags[2] = { tcache->loaded[i], tcache->prev[i] };
+			int j;
+
+			for (j = 0; j < 2; j++) {
+				if (!mags[j])
+					continue;
+				buffers_free(mags[j]);
+				free(mags[j]);
+			}
+		}
+		free(tcache);
+		tcache = NULL;
+		pthread_setspecific(cache_key, NULL);
+	}
+
+	for (i = 0; i < AURA_BUFFER_POOL_CLASSES; i++) {
+		struct depot *d = &depots[i];
+		struct magazine *m;
+
+		pthread_mutex_lock(&d->lock);
+		while ((m = d->full)) {
+			d->full = m->next;
+			d->stats.dropped += m->rounds;
+			buffers_free(m);
+			free(m);
+		}
+		while ((m = d->empty)) {
+			d->empty = m->next;
+			free(m);
+		}
+		d->stats.count = 0;
+		pthread_mutex_unlock(&d->lock);
+	}
+}
+
+/**
+ * @}
+ */
+
+static void __attribute__((constructor (103))) globalpool_init()
+{
+	char *limit = getenv("AURA_GLOBAL_BUFFER_POOL");
+	int i;
+
+	pthread_key_create(&cache_key, thread_cache_destroy);
+	for (i = 0; i < AURA_BUFFER_POOL_CLASSES; i++) {
+		pthread_mutex_init(&depots[i].lock, NULL);
+		depots[i].stats.size = aura_bufferpool_class_size(i);
+		depots[i].stats.gc_threshold = 256;
+	}
+
+	if (limit) {
+		global_enabled = true;
+		if (atoi(limit) != 0)
+			aura_bufferpool_global_set_limit(atoi(limit));
+	}
+}
+
+/* Don't leave anything for leak checkers */
+static void __attribute__((destructor)) globalpool_fini()
+{
+	aura_bufferpool_global_drain();
+}
@@ -0,0 +1,408 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+#include <aura/eventloop.h>
+#include <pthread.h>
+#include <sched.h>
+
+/* Size of the cross-thread call ring of each loop in the pool */
+#define AURA_LOOPPOOL_XCALL_RING_SIZE 256
+
+struct looppool_cmd {
+	void			(*fn)(struct aura_eventloop *loop, void *arg);
+	void *			arg;
+	bool			done;
+	struct list_head	qentry;
+};
+
+struct looppool_worker {
+	struct aura_looppool *	pool;
+	struct aura_eventloop *	loop;
+	pthread_t		thread;
+	int			cpu;
+	bool			stopping;
+	/* Number of nodes in this loop. Protected by pool->lock */
+	int			numnodes;
+	/* Commands to be run by the worker thread */
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	struct list_head	cmds;
+};
+
+struct aura_looppool {
+	int				numloops;
+	enum aura_looppool_placement	placement;
+	pthread_mutex_t			lock;
+	struct looppool_worker		workers[];
+};
+
+static void worker_wakeup_cb(struct aura_eventloop *loop, void *arg)
+{
+	struct looppool_worker *w = arg;
+
+	pthread_mutex_lock(&w->lock);
+	while (!list_empty(&w->cmds)) {
+		struct looppool_cmd *cmd;
+		cmd = list_entry(w->cmds.next, struct looppool_cmd, qentry);
+		list_del(&cmd->qentry);
+		pthread_mutex_unlock(&w->lock);
+		cmd->fn(loop, cmd->arg);
+		pthread_mutex_lock(&w->lock);
+		cmd->done = true;
+	}
+	pthread_cond_broadcast(&w->cond);
+	pthread_mutex_unlock(&w->lock);
+}
+
+static void *worker_thread(void *arg)
+{
+	struct looppool_worker *w = arg;
+
+	if (w->cpu >= 0) {
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(w->cpu, &set);
+		if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set))
+			slog(1, SLOG_WARN, "looppool: Failed to pin loop thread to cpu %d", w->cpu);
+	}
+
+	/* Dispatch one event at a time so that nodes added on the way get started */
+	while (!w->stopping)
+		aura_eventloop_dispatch(w->loop, AURA_EVTLOOP_ONCE);
+
+	return NULL;
+}
+
+/* Run fn in the worker's thread and wait for it to complete */
+static void worker_exec(struct looppool_worker *w,
+			void (*fn)(struct aura_eventloop *loop, void *arg),
+			void *arg)
+{
+	struct looppool_cmd cmd = {
+		.fn	= fn,
+		.arg	= arg,
+	};
+
+	if (pthread_equal(pthread_self(), w->thread)) {
+		fn(w->loop, arg);
+		return;
+	}
+
+	pthread_mutex_lock(&w->lock);
+	list_add_tail(&cmd.qentry, &w->cmds);
+	pthread_mutex_unlock(&w->lock);
+
+	aura_eventloop_wakeup(w->loop);
+
+	pthread_mutex_lock(&w->lock);
+	while (!cmd.done)
+		pthread_cond_wait(&w->cond, &w->lock);
+	pthread_mutex_unlock(&w->lock);
+}
+
+static void cmd_stop(struct aura_eventloop *loop, void *arg)
+{
+	struct looppool_worker *w = arg;
+
+	w->stopping = true;
+}
+
+static void cmd_node_add(struct aura_eventloop *loop, void *arg)
+{
+	aura_eventloop_add(loop, arg);
+}
+
+static void cmd_node_del(struct aura_eventloop *loop, void *arg)
+{
+	/* Start anything already submitted for this node while it's still ours */
+	aura_eventloop_xcall_process(loop);
+	aura_eventloop_del(arg);
+}
+
+static void cmd_node_close(struct aura_eventloop *loop, void *arg)
+{
+	aura_close(arg);
+}
+
+static void worker_destroy(struct looppool_worker *w)
+{
+	aura_eventloop_destroy(w->loop);
+	pthread_cond_destroy(&w->cond);
+	pthread_mutex_destroy(&w->lock);
+}
+
+static struct looppool_worker *node_worker(struct aura_looppool *pool, struct aura_node *node)
+{
+	struct aura_eventloop *loop = aura_node_eventloop_get(node);
+	int i;
+
+	for (i = 0; i < pool->numloops; i++)
+		if (pool->workers[i].loop == loop)
+			return &pool->workers[i];
+	return NULL;
+}
+
+static uint32_t key_hash(const char *key)
+{
+	uint32_t h = 2166136261u;
+
+	while (*key) {
+		h ^= (uint8_t)*key++;
+		h *= 16777619u;
+	}
+	return h;
+}
+
+/** \addtogroup loop
+ *  @{
+ */
+
+/**
+ * Create a pool of event loops, each one running in its own thread.
+ *
+ * Nodes added to the pool are spread among the loops, so that a large
+ * number of nodes can be served by several cores. Each loop uses the currently
+ * selected eventloop module and accepts calls from other threads, see
+ * aura_xcall_submit().
+ *
+ * Once a node is in the pool, it belongs to its loop's thread. Only touch it
+ * via aura_xcall_submit() or take it out of the pool with aura_looppool_del() first.
+ *
+ * @param numloops Number of loops (and threads) to create
+ * @param cpus Array of numloops cpu numbers to pin loop threads to, -1 for no pinning.
+ *             NULL to not pin threads at all
+ * @param placement How aura_looppool_add() picks a loop
+ * @return pointer to the pool or NULL
+ */
+struct aura_looppool *aura_looppool_create(int numloops, const int *cpus,
+					   enum aura_looppool_placement placement)
+{
+	struct aura_looppool *pool;
+	int i;
+
+	if (numloops <= 0)
+		return NULL;
+
+	pool = calloc(1, sizeof(*pool) + numloops * sizeof(struct looppool_worker));
+	if (!pool)
+		return NULL;
+
+	pool->placement = placement;
+	pthread_mutex_init(&pool->lock, NULL);
+
+	for (i = 0; i < numloops; i++) {
+		struct looppool_worker *w = &pool->workers[i];
+
+		w->pool = pool;
+		w->cpu = cpus ? cpus[i] : -1;
+		pthread_mutex_init(&w->lock, NULL);
+		pthread_cond_init(&w->cond, NULL);
+		INIT_LIST_HEAD(&w->cmds);
+
+		w->loop = aura_eventloop_create_empty();
+		if (!w->loop)
+			goto err_destroy;
+
+		if (aura_eventloop_xcall_enable(w->loop, AURA_LOOPPOOL_XCALL_RING_SIZE)) {
+			slog(0, SLOG_ERROR, "looppool: eventloop module %s can't be woken up from other threads",
+			     w->loop->module->name);
+			aura_eventloop_destroy(w->loop);
+			goto err_destroy;
+		}
+		aura_eventloop_wakeup_cb(w->loop, worker_wakeup_cb, w);
+
+		if (pthread_create(&w->thread, NULL, worker_thread, w)) {
+			aura_eventloop_destroy(w->loop);
+			goto err_destroy;
+		}
+		pool->numloops++;
+	}
+
+	return pool;
+
+err_destroy:
+	pthread_cond_destroy(&pool->workers[i].cond);
+	pthread_mutex_destroy(&pool->workers[i].lock);
+	aura_looppool_destroy(pool);
+	return NULL;
+}
+
+/**
+ * Stop all the loop threads and destroy the pool. The nodes still in the pool are
+ * removed from their loops, but not closed - you'll have to aura_close() them yourself.
+ *
+ * @param pool
+ */
+void aura_looppool_destroy(struct aura_looppool *pool)
+{
+	int i;
+
+	for (i = 0; i < pool->numloops; i++) {
+		struct looppool_worker *w = &pool->workers[i];
+		worker_exec(w, cmd_stop, w);
+		pthread_join(w->thread, NULL);
+		worker_destroy(w);
+	}
+	pthread_mutex_destroy(&pool->lock);
+	free(pool);
+}
+
+/**
+ * Add a node to one of the pool's loops. The node should not be bound to any
+ * manually created eventloop.
+ *
+ * With AURA_LOOPPOOL_HASH placement nodes with the same key always end up on
+ * the same loop. If key is NULL, node's address is used instead.
+ *
+ * @param pool
+ * @param node
+ * @param key
+ * @return index of the loop the node has been added to
+ */
+int aura_looppool_add(struct aura_looppool *pool, struct aura_node *node, const char *key)
+{
+	struct looppool_worker *w;
+	int idx = 0;
+	int i;
+
+	pthread_mutex_lock(&pool->lock);
+	if (pool->placement == AURA_LOOPPOOL_HASH) {
+		uint32_t h = key ? key_hash(key) : (uint32_t)((uintptr_t)node >> 4);
+		idx = h % pool->numloops;
+	} else {
+		for (i = 1; i < pool->numloops; i++)
+			if (pool->workers[i].numnodes < pool->workers[idx].numnodes)
+				idx = i;
+	}
+	w = &pool->workers[idx];
+	w->numnodes++;
+	pthread_mutex_unlock(&pool->lock);
+
+	worker_exec(w, cmd_node_add, node);
+	return idx;
+}
+
+/**
+ * Move a node from its current loop to the loop idx of the same pool.
+ * Calls in flight are not affected. Calls submitted with aura_xcall_submit()
+ * that raced the move complete with -EAGAIN status.
+ *
+ * @param pool
+ * @param node
+ * @param idx
+ * @return 0 on success, -EINVAL if idx is out of range, -ENOENT if the node is not in the pool
+ */
+int aura_looppool_migrate(struct aura_looppool *pool, struct aura_node *node, int idx)
+{
+	struct looppool_worker *from = node_worker(pool, node);
+	struct looppool_worker *to;
+
+	if ((idx < 0) || (idx >= pool->numloops))
+		return -EINVAL;
+
+	if (!from)
+		return -ENOENT;
+
+	to = &pool->workers[idx];
+	if (from == to)
+		return 0;
+
+	worker_exec(from, cmd_node_del, node);
+	worker_exec(to, cmd_node_add, node);
+
+	pthread_mutex_lock(&pool->lock);
+	from->numnodes--;
+	to->numnodes++;
+	pthread_mutex_unlock(&pool->lock);
+	return 0;
+}
+
+/**
+ * Take the node out of the pool. The node is no longer bound to any eventloop
+ * and can be used from the calling thread again.
+ *
+ * @param pool
+ * @param node
+ */
+void aura_looppool_del(struct aura_looppool *pool, struct aura_node *node)
+{
+	struct looppool_worker *w = node_worker(pool, node);
+
+	if (!w)
+		BUG(node, "Node is not in this looppool");
+
+	worker_exec(w, cmd_node_del, node);
+
+	pthread_mutex_lock(&pool->lock);
+	w->numnodes--;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Close a node that is in the pool. The node is closed by its loop's thread.
+ *
+ * @param pool
+ * @param node
+ */
+void aura_looppool_close(struct aura_looppool *pool, struct aura_node *node)
+{
+	struct looppool_worker *w = node_worker(pool, node);
+
+	if (!w)
+		BUG(node, "Node is not in this looppool");
+
+	worker_exec(w, cmd_node_close, node);
+
+	pthread_mutex_lock(&pool->lock);
+	w->numnodes--;
+	pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * @param pool
+ * @return number of loops in the pool
+ */
+int aura_looppool_size(struct aura_looppool *pool)
+{
+	return pool->numloops;
+}
+
+/**
+ * @param pool
+ * @param idx
+ * @return number of nodes served by loop idx
+ */
+int aura_looppool_load(struct aura_looppool *pool, int idx)
+{
+	int ret;
+
+	pthread_mutex_lock(&pool->lock);
+	ret = pool->workers[idx].numnodes;
+	pthread_mutex_unlock(&pool->lock);
+	return ret;
+}
+
+/**
+ * @param pool
+ * @param node
+ * @return index of the loop serving the node or -ENOENT if the node is not in the pool
+ */
+int aura_looppool_node_index(struct aura_looppool *pool, struct aura_node *node)
+{
+	struct looppool_worker *w = node_worker(pool, node);
+
+	return w ? (int)(w - pool->workers) : -ENOENT;
+}
+
+/**
+ * @param pool
+ * @param idx
+ * @return loop idx of the pool
+ */
+struct aura_eventloop *aura_looppool_get_loop(struct aura_looppool *pool, int idx)
+{
+	return pool->workers[idx].loop;
+}
+
+/**
+ * @}
+ */
@@ -67,21 +67,364 @@ void aura_requeue_buffer(struct list_head *list, struct aura_buffer *buf)
 
 
 
+/* How full the outbound queue is, in percent of the tightest limit */
+static int outbound_fill_pct(struct aura_node *node)
+{
+	struct aura_queue_stats *st = &node->outbound_stats;
+	int pct = 0;
+
+	if (node->outbound_max_count)
+		pct = st->count * 100 / node->outbound_max_count;
+	if (node->outbound_max_bytes)
+		pct = max_t(int, pct, st->bytes * 100 / node->outbound_max_bytes);
+	return pct;
+}
+
+static void outbound_check_watermarks(struct aura_node *node)
+{
+	bool congested = node->outbound_congested;
+	int pct;
+
+	if (!node->outbound_watermark_cb)
+		return;
+
+	pct = outbound_fill_pct(node);
+	if (!congested && (pct >= node->outbound_high_pct))
+		congested = true;
+	else if (congested && (pct <= node->outbound_low_pct))
+		congested = false;
+
+	if (congested != node->outbound_congested) {
+		node->outbound_congested = congested;
+		node->outbound_watermark_cb(node, congested, node->outbound_watermark_arg);
+	}
+}
+
+static void outbound_account(struct aura_node *node, int count, ssize_t bytes)
+{
+	struct aura_queue_stats *st = &node->outbound_stats;
+
+	st->count += count;
+	st->bytes += bytes;
+	st->count_hwm = max_t(int, st->count_hwm, st->count);
+	st->bytes_hwm = max_t(size_t, st->bytes_hwm, st->bytes);
+	outbound_check_watermarks(node);
+}
+
+/**
+ * Check if count more buffers totalling bytes would exceed node's outbound
+ * queue limits. An empty queue ignores the byte limit, so that a single call
+ * larger than the limit can still go through.
+ *
+ * @param node
+ * @param count
+ * @param bytes
+ * @return true if the buffers don't fit
+ */
+bool aura_node_outbound_full(struct aura_node *node, int count, size_t bytes)
+{
+	struct aura_queue_stats *st = &node->outbound_stats;
+
+	if (node->outbound_max_count && (st->count + count > node->outbound_max_count))
+		return true;
+	if (node->outbound_max_bytes && st->count && (st->bytes + bytes > node->outbound_max_bytes))
+		return true;
+	return false;
+}
+
+/* Priority class a buffer is queued in */
+static int outbound_class(struct aura_buffer *buf)
+{
+	if (buf->prio == AURA_CALL_PRIO_DEFAULT)
+		buf->prio = buf->object ? buf->object->prio : AURA_CALL_PRIO_NORMAL;
+	return buf->prio;
+}
+
+/*
+ * Pick the next buffer to hand out: the head of the highest non-empty class,
+ * unless a lower class has been passed over starve_limit times in a row.
+ */
+static struct aura_buffer *outbound_pick(struct aura_node *node)
+{
+	struct aura_buffer *buf = NULL;
+	int i;
+
+	for (i = 0; i < AURA_CALL_PRIO_COUNT; i++) {
+		struct aura_buffer *head = aura_peek_buffer(&node->outbound_queues[i]);
+		if (!head)
+			continue;
+		if (!buf)
+			buf = head;
+		else if (node->outbound_starve_limit &&
+			 (node->outbound_starved[i] >= node->outbound_starve_limit))
+			return head;
+	}
+	return buf;
+}
+
+/* Hand the transport the buffer in a shape it can send */
+static void outbound_prepare(struct aura_node *node, struct aura_buffer *buf)
+{
+	if (!(node->tr->flags & AURA_TRANSPORT_VECTORED_IO))
+		aura_buffer_flatten(buf);
+}
+
+/* Account for buf being dequeued ahead of everything else still waiting */
+static void outbound_starve(struct aura_node *node, struct aura_buffer *buf)
+{
+	int i;
+
+	for (i = 0; i < AURA_CALL_PRIO_COUNT; i++) {
+		if (i == buf->prio || list_empty(&node->outbound_queues[i]))
+			node->outbound_starved[i] = 0;
+		else
+			node->outbound_starved[i]++;
+	}
+}
+
+/**
+ * Add a buffer to the tail of node's outbound queue of buffer's priority class
+ *
+ * @param node
+ * @param buf
+ */
+void aura_node_outbound_queue(struct aura_node *node, struct aura_buffer *buf)
+{
+	aura_queue_buffer(&node->outbound_queues[outbound_class(buf)], buf);
+	outbound_account(node, 1, buf->size);
+}
+
+/**
+ * Remove a buffer from node's outbound queue
+ *
+ * @param node
+ * @param buf
+ */
+void aura_node_outbound_remove(struct aura_node *node, struct aura_buffer *buf)
+{
+	list_del(&buf->qentry);
+	if (buf == node->outbound_peeked)
+		node->outbound_peeked = NULL;
+	if (buf->slot) {
+		buf->slot->request = NULL;
+		buf->slot = NULL;
+	}
+	outbound_account(node, -1, -(ssize_t)buf->size);
+}
+
+/**
+ * Release all the buffers in node's outbound queue
+ *
+ * @param node
+ * @param destroy free the buffers instead of returning them to the pool
+ */
+void aura_node_outbound_flush(struct aura_node *node, bool destroy)
+{
+	struct aura_buffer *buf;
+	int i;
+
+	for (i = 0; i < AURA_CALL_PRIO_COUNT; i++) {
+		while ((buf = aura_peek_buffer(&node->outbound_queues[i]))) {
+			aura_node_outbound_remove(node, buf);
+			if (destroy)
+				aura_buffer_destroy(buf);
+			else
+				aura_buffer_release(buf);
+		}
+		node->outbound_starved[i] = 0;
+	}
+}
+
+/**
+ * @param node
+ * @return true if node's outbound queue is empty
+ */
+bool aura_node_outbound_empty(struct aura_node *node)
+{
+	return node->outbound_stats.count == 0;
+}
+
+/**
+ * Dequeue the next buffer from node's outbound queue. Buffers of higher priority
+ * classes come first, but lower classes still get their turn once in a while
+ * (See aura_set_outbound_starve_limit()). If the transport has peeked at a buffer
+ * with aura_node_peek(), that one is returned.
+ *
+ * @param node
+ * @return
+ */
 struct aura_buffer *aura_node_read(struct aura_node *node)
 {
 	struct aura_buffer *ret;
 
-	ret = aura_peek_buffer(&node->outbound_buffers);
+	ret = node->outbound_peeked ? node->outbound_peeked : outbound_pick(node);
 	if (ret) {
-		list_del(node->outbound_buffers.next);
+		struct aura_call_slot *slot = ret->slot;
+
+		outbound_prepare(node, ret);
+		outbound_starve(node, ret);
+		aura_node_outbound_remove(node, ret);
+		if (slot)
+			aura_call_slot_sent(node, slot);
 		aura_buffer_rewind(ret);
 	}
 	return ret;
 }
 
-int aura_node_outbound_avail(struct aura_node *node)
+/**
+ * Put a buffer obtained with aura_node_read() back to the head of node's
+ * outbound queue, e.g. when the transport failed to send it.
+ *
+ * @param node
+ * @param buf
+ */
+void aura_node_requeue(struct aura_node *node, struct aura_buffer *buf)
+{
+	struct aura_call_slot *slot = buf->call_tag ? aura_call_slot_find(node, buf) : NULL;
+
+	/* Rare enough to afford a lookup. Cancelled calls are not worth sending anymore */
+	if (slot && slot->cancelled) {
+		aura_call_slot_complete(node, slot, AURA_CALL_TRANSPORT_FAIL, NULL);
+		aura_buffer_release(buf);
+		return;
+	}
+	if (slot)
+		aura_call_slot_attach(slot, buf);
+	list_add(&buf->qentry, &node->outbound_queues[outbound_class(buf)]);
+	outbound_account(node, 1, buf->size);
+}
+
+/**
+ * Get the next buffer from node's outbound queue, leaving it in the queue.
+ * Use this one if your transport dequeues the buffer only after it's done
+ * with it. The core will not take the buffer from the queue behind your back
+ * (e.g. when the call times out) until it's dequeued with aura_node_read().
+ * Until then this function keeps returning the same buffer, even if a call of
+ * a higher priority class has been queued meanwhile.
+ *
+ * @param node
+ * @return
+ */
+struct aura_buffer *aura_node_peek(struct aura_node *node)
+{
+	if (!node->outbound_peeked) {
+		node->outbound_peeked = outbound_pick(node);
+		if (node->outbound_peeked)
+			outbound_prepare(node, node->outbound_peeked);
+	}
+	return node->outbound_peeked;
+}
+
+/**
+ * @}
+ * \addtogroup async
+ * @{
+ */
+
+/**
+ * Limit the depth of node's outbound queue. Once either of the limits is reached
+ * starting new calls fails with -EAGAIN, or blocks if blocking mode is enabled for
+ * synchronous calls (see aura_set_outbound_blocking()).
+ *
+ * @param node
+ * @param max_count maximum number of queued calls, 0 for no limit
+ * @param max_bytes maximum total size of queued calls, 0 for no limit
+ */
+void aura_set_outbound_limits(struct aura_node *node, int max_count, size_t max_bytes)
+{
+	node->outbound_max_count = max_count;
+	node->outbound_max_bytes = max_bytes;
+	outbound_check_watermarks(node);
+}
+
+/**
+ * Get notified when node's outbound queue becomes congested and when it drains.
+ * The callback is called with congested set to true once the queue fills up to high percent
+ * of its limits (See aura_set_outbound_limits()) and with congested set to false once it drains
+ * down to low percent.
+ *
+ * @param node
+ * @param high
+ * @param low
+ * @param cb NULL to disable
+ * @param arg
+ */
+void aura_outbound_watermark_cb(struct aura_node *node, int high, int low,
+				void (*cb)(struct aura_node *node, bool congested, void *arg),
+				void *arg)
+{
+	node->outbound_high_pct = high;
+	node->outbound_low_pct = low;
+	node->outbound_watermark_cb = cb;
+	node->outbound_watermark_arg = arg;
+	node->outbound_congested = false;
+	outbound_check_watermarks(node);
+}
+
+/**
+ * Make synchronous calls wait for room in a full outbound queue, dispatching
+ * node's eventloop meanwhile, instead of failing with -EAGAIN.
+ *
+ * @param node
+ * @param block
+ */
+void aura_set_outbound_blocking(struct aura_node *node, bool block)
+{
+	node->outbound_block = block;
+}
+
+/**
+ * Get current depth and high-water marks of node's outbound queue.
+ *
+ * @param node
+ * @param stats
+ * @param reset_hwm reset the high-water marks to the current depth
+ */
+void aura_get_outbound_stats(struct aura_node *node, struct aura_queue_stats *stats, bool reset_hwm)
+{
+	*stats = node->outbound_stats;
+	if (reset_hwm) {
+		node->outbound_stats.count_hwm = node->outbound_stats.count;
+		node->outbound_stats.bytes_hwm = node->outbound_stats.bytes;
+	}
+}
+
+/**
+ * Set the priority class of all the calls to an object, unless overridden
+ * per call with aura_start_call_prio(). The setting survives the node
+ * going offline and online as long as the object doesn't change.
+ *
+ * @param node
+ * @param name
+ * @param prio One of AURA_CALL_PRIO_*, AURA_CALL_PRIO_DEFAULT resets it to normal
+ * @return 0 on success, -ENOENT if there's no such object, -EINVAL if prio is not valid
+ */
+int aura_object_set_priority(struct aura_node *node, const char *name, int prio)
+{
+	struct aura_object *o;
+
+	if ((prio < AURA_CALL_PRIO_DEFAULT) || (prio >= AURA_CALL_PRIO_COUNT))
+		return -EINVAL;
+
+	o = aura_etable_find(node->tbl, name);
+	if (!o)
+		return -ENOENT;
+
+	o->prio = (prio == AURA_CALL_PRIO_DEFAULT) ? AURA_CALL_PRIO_NORMAL : prio;
+	return 0;
+}
+
+/**
+ * Protect lower priority classes from starvation. Once a class with queued
+ * calls has been passed over limit times in a row, its next call goes
+ * ahead of higher classes. The default limit is 8.
+ *
+ * @param node
+ * @param limit 0 for strict priority order
+ */
+void aura_set_outbound_starve_limit(struct aura_node *node, int limit)
 {
-	return list_empty(&node->outbound_buffers);
+	node->outbound_starve_limit = limit;
 }
 
 
@@ -1,3 +1,4 @@
+#include <limits.h>
 #include <aura/aura.h>
 #include <aura/private.h>
 
@@ -58,6 +59,25 @@ DECLARE_PUTFUNC(int32_t, s32, __swap32);
 DECLARE_PUTFUNC(uint64_t, u64, __swap64);
 DECLARE_PUTFUNC(int64_t, s64, __swap64);
 
+/* Floats travel as integers of the same size, so that they're swapped the same way */
+#define DECLARE_FLOATFUNCS(tp, name, inttp, intname)                    \
+	tp aura_buffer_get_ ## name(struct aura_buffer *buf)              \
+	{                                                               \
+		inttp v = aura_buffer_get_ ## intname(buf);             \
+		tp result;                                              \
+		memcpy(&result, &v, sizeof(result));                    \
+		return result;                                          \
+	}                                                               \
+	void aura_buffer_put_ ## name(struct aura_buffer *buf, tp value)  \
+	{                                                               \
+		inttp v;                                                \
+		memcpy(&v, &value, sizeof(v));                          \
+		aura_buffer_put_ ## intname(buf, v);                    \
+	}
+
+DECLARE_FLOATFUNCS(float, f32, uint32_t, u32);
+DECLARE_FLOATFUNCS(double, f64, uint64_t, u64);
+
 const void *aura_buffer_get_bin(struct aura_buffer *buf, int len)
 {
 	struct aura_node *node = buf->owner;
@@ -102,3 +122,86 @@ struct aura_buffer *aura_buffer_get_buf(struct aura_buffer *buf)
 		BUG(node, "Fetched an aura_buffer with invalid magic - check your code!");
 	return ret;
 }
+
+void aura_buffer_get_array(struct aura_buffer *buf, void *dst, int count, int size)
+{
+	struct aura_node *node = buf->owner;
+	int len;
+
+	if ((count < 0) || (size <= 0) || (count > INT_MAX / size))
+		BUG(node, "Invalid array of %d elements of %d bytes", count, size);
+	len = count * size;
+	if (len > buf->size - buf->pos)
+		BUG(node, "attempt to access data beyound buffer boundary");
+	if (node->need_endian_swap && size > 1)
+		aura_swap_array(dst, &buf->data[buf->pos], count, size);
+	else
+		memcpy(dst, &buf->data[buf->pos], len);
+	buf->pos += len;
+}
+
+void aura_buffer_put_array(struct aura_buffer *buf, const void *src, int count, int size)
+{
+	struct aura_node *node = buf->owner;
+	int len;
+
+	if ((count < 0) || (size <= 0) || (count > INT_MAX / size))
+		BUG(node, "Invalid array of %d elements of %d bytes", count, size);
+	len = count * size;
+	if (len > buf->size - buf->pos)
+		BUG(node, "attempt to access data beyound buffer boundary");
+	if (node->need_endian_swap && size > 1)
+		aura_swap_array(&buf->data[buf->pos], src, count, size);
+	else
+		memcpy(&buf->data[buf->pos], src, len);
+	buf->pos += len;
+	buf->payload_size += len;
+}
+
+#define DECLARE_ARRAYFUNCS(tp, name)                                            \
+	void aura_buffer_get_array_ ## name(struct aura_buffer *buf, tp *dst, int count) \
+	{                                                                       \
+		aura_buffer_get_array(buf, dst, count, sizeof(tp));             \
+	}                                                                       \
+	void aura_buffer_put_array_ ## name(struct aura_buffer *buf, const tp *src, int count) \
+	{                                                                       \
+		aura_buffer_put_array(buf, src, count, sizeof(tp));             \
+	}
+
+DECLARE_ARRAYFUNCS(uint8_t, u8);
+DECLARE_ARRAYFUNCS(int8_t, s8);
+DECLARE_ARRAYFUNCS(uint16_t, u16);
+DECLARE_ARRAYFUNCS(int16_t, s16);
+DECLARE_ARRAYFUNCS(uint32_t, u32);
+DECLARE_ARRAYFUNCS(int32_t, s32);
+DECLARE_ARRAYFUNCS(uint64_t, u64);
+DECLARE_ARRAYFUNCS(int64_t, s64);
+
+#define DECLARE_VBINFUNCS(lentp, tp, name)                                      \
+	const void *aura_buffer_get_ ## name(struct aura_buffer *buf, int *len) \
+	{                                                                       \
+		*len = aura_buffer_get_ ## tp(buf);                             \
+		return aura_buffer_get_bin(buf, *len);                          \
+	}                                                                       \
+	void aura_buffer_put_ ## name(struct aura_buffer *buf, const void *data, int len) \
+	{                                                                       \
+		if (buf->pos + (int)sizeof(lentp) + len > buf->size)           \
+			BUG(buf->owner, "attempt to access data beyound buffer boundary"); \
+		aura_buffer_put_ ## tp(buf, len);                               \
+		aura_buffer_put_bin(buf, data, len);                            \
+	}
+
+DECLARE_VBINFUNCS(uint8_t, u8, vbin8);
+DECLARE_VBINFUNCS(uint16_t, u16, vbin16);
+
+void aura_buffer_unpack(struct aura_buffer *buf, ...)
+{
+	va_list ap;
+
+	if (!buf->object)
+		BUG(buf->owner, "Can't unpack a buffer with no object attached");
+
+	va_start(ap, buf);
+	aura_deserialize(buf, buf->object->ret_plan, ap);
+	va_end(ap);
+}
@@ -1,10 +1,49 @@
+#include <limits.h>
 #include <aura/aura.h>
 #include <aura/private.h>
 
+/* Size of an array element of type t, 0 if t can't be an array element */
+static int fmt_elem_size(char t)
+{
+	switch (t) {
+	case URPC_U8:
+	case URPC_S8:
+		return 1;
+	case URPC_U16:
+	case URPC_S16:
+		return 2;
+	case URPC_U32:
+	case URPC_S32:
+		return 4;
+	case URPC_U64:
+	case URPC_S64:
+		return 8;
+	}
+	return 0;
+}
+
+/* Element count of the array format at fmt (past the 'a'), 0 if it's malformed */
+static int fmt_array_count(const char *fmt)
+{
+	int size = fmt_elem_size(*fmt);
+	long count;
+
+	if (!size)
+		return 0;
+	count = strtol(fmt + 1, NULL, 10);
+	if ((count <= 0) || (count > INT_MAX / size))
+		return 0;
+	return count;
+}
+
+/* Size of the length prefix of a variable-size field */
+#define vbin_prefix(t) ((t) == URPC_VBIN8 ? 1 : 2)
+#define vbin_max(t) ((t) == URPC_VBIN8 ? 0xff : 0xffff)
 
 /**
  * Returns the length of the buffer required to serialize the data of the following format
- * This doesn't include any transport-specific overhead
+ * This doesn't include any transport-specific overhead. For formats with variable-size
+ * fields this is the maximum, see aura_serialized_len() for the size of a particular call.
  *
  * @param node
  * @param fmt
@@ -30,10 +69,12 @@ int  aura_fmt_len(struct aura_node *node, const char *fmt)
 			break;
 		case URPC_U32:
 		case URPC_S32:
+		case URPC_F32:
 			len += 4;
 			break;
 		case URPC_U64:
 		case URPC_S64:
+		case URPC_F64:
 		case URPC_BUF:
 			len += 8;
 			break;
@@ -44,6 +85,21 @@ int  aura_fmt_len(struct aura_node *node, const char *fmt)
 			len += tmp;
 			while (*fmt && (*fmt++ != '.'));
 			break;
+		case URPC_VBIN8:
+		case URPC_VBIN16:
+			tmp = atoi(fmt);
+			if (tmp == 0)
+				BUG(node, "Internal serilizer bug processing: %s", fmt);
+			len += vbin_prefix(fmt[-1]) + tmp;
+			while (*fmt && (*fmt++ != '.'));
+			break;
+		case URPC_ARRAY:
+			tmp = fmt_elem_size(*fmt) * fmt_array_count(fmt);
+			if (tmp == 0)
+				BUG(node, "Internal serilizer bug processing: %s", fmt);
+			len += tmp;
+			while (*fmt && (*fmt++ != '.'));
+			break;
 		default:
 			BUG(node, "Serializer failed at token: %s", fmt);
 		}
@@ -51,6 +107,97 @@ int  aura_fmt_len(struct aura_node *node, const char *fmt)
 	return len;
 }
 
+/**
+ * Compile a format string into a flat array of fields with their sizes and offsets,
+ * so that serializers don't have to parse the string over and over again.
+ * The core compiles the formats of every object once it's added to the export
+ * table, see struct aura_object. The caller should free() the plan.
+ *
+ * @param node
+ * @param fmt
+ * @return the compiled format or NULL if fmt is NULL
+ */
+struct aura_fmt_plan *aura_fmt_compile(struct aura_node *node, const char *fmt)
+{
+	struct aura_fmt_plan *plan;
+
+	if (!fmt)
+		return NULL;
+
+	/* Every field takes at least one character */
+	plan = malloc(sizeof(*plan) + strlen(fmt) * sizeof(struct aura_fmt_op));
+	if (!plan)
+		BUG(node, "FATAL: malloc() failed");
+
+	plan->num_ops = 0;
+	plan->len = 0;
+	plan->variable = false;
+	while (*fmt) {
+		struct aura_fmt_op *op = &plan->ops[plan->num_ops];
+
+		op->type = *fmt++;
+		op->swap = false;
+		op->elem = URPC_NONE;
+		op->count = 1;
+		switch (op->type) {
+		case URPC_U8:
+		case URPC_S8:
+			op->size = 1;
+			break;
+		case URPC_U16:
+		case URPC_S16:
+			op->size = 2;
+			op->swap = true;
+			break;
+		case URPC_U32:
+		case URPC_S32:
+		case URPC_F32:
+			op->size = 4;
+			op->swap = true;
+			break;
+		case URPC_U64:
+		case URPC_S64:
+		case URPC_F64:
+			op->size = 8;
+			op->swap = true;
+			break;
+		case URPC_BUF:
+			op->size = 8;
+			break;
+		case URPC_BIN:
+			op->size = atoi(fmt);
+			if (op->size <= 0)
+				BUG(node, "Internal serilizer bug processing: %s", fmt);
+			while (*fmt && (*fmt++ != '.'));
+			break;
+		case URPC_VBIN8:
+		case URPC_VBIN16:
+			op->count = atoi(fmt);
+			if ((op->count <= 0) || (op->count > vbin_max(op->type)))
+				BUG(node, "Internal serilizer bug processing: %s", fmt);
+			op->size = vbin_prefix(op->type) + op->count;
+			plan->variable = true;
+			while (*fmt && (*fmt++ != '.'));
+			break;
+		case URPC_ARRAY:
+			op->count = fmt_array_count(fmt);
+			if (!op->count)
+				BUG(node, "Internal serilizer bug processing: %s", fmt);
+			op->elem = *fmt++;
+			op->size = fmt_elem_size(op->elem) * op->count;
+			op->swap = fmt_elem_size(op->elem) > 1;
+			while (*fmt && (*fmt++ != '.'));
+			break;
+		default:
+			BUG(node, "Serializer failed at token: %s", --fmt);
+		}
+		op->offset = plan->len;
+		plan->len += op->size;
+		plan->num_ops++;
+	}
+	return plan;
+}
+
 /**
  * Return a pretty-printed representation of format in an allocated string.
  * This function also validates the format and calculates the number of args
@@ -108,6 +255,12 @@ char *aura_fmt_pretty_print(const char *fmt, int *valid, int *num_args)
 		case URPC_S64:
 			shift = sprintf(tmp, " int64_t");
 			break;
+		case URPC_F32:
+			shift = sprintf(tmp, " float");
+			break;
+		case URPC_F64:
+			shift = sprintf(tmp, " double");
+			break;
 		case URPC_BUF:
 			shift = sprintf(tmp, " buf");
 			break;
@@ -118,6 +271,34 @@ char *aura_fmt_pretty_print(const char *fmt, int *valid, int *num_args)
 			shift = sprintf(tmp, " bin(%d)", len);
 			while (*fmt && (*fmt++ != '.'));
 			break;
+		case URPC_VBIN8:
+		case URPC_VBIN16:
+			len = atoi(fmt);
+			if (len == 0)
+				BUG(NULL, "Internal serilizer bug processing: %s", fmt);
+			shift = sprintf(tmp, " vbin%d(%d)", vbin_prefix(fmt[-1]) * 8, len);
+			while (*fmt && (*fmt++ != '.'));
+			break;
+		case URPC_ARRAY:
+		{
+			static const char *names[] = {
+				[URPC_U8 - '0'] = "uint8_t", [URPC_U16 - '0'] = "uint16_t",
+				[URPC_U32 - '0'] = "uint32_t", [URPC_U64 - '0'] = "uint64_t",
+				[URPC_S8 - '0'] = "int8_t", [URPC_S16 - '0'] = "int16_t",
+				[URPC_S32 - '0'] = "int32_t", [URPC_S64 - '0'] = "int64_t",
+			};
+			char elem = *fmt;
+
+			len = fmt_array_count(fmt);
+			if (!len) {
+				*valid = 0;
+				shift = sprintf(tmp, " ?[a]?");
+			} else {
+				shift = sprintf(tmp, " %s[%d]", names[elem - '0'], len);
+			}
+			while (*fmt && (*fmt++ != '.'));
+			break;
+		}
 		case 0x0:
 			shift = sprintf(tmp, " (null)");
 			break;
@@ -139,116 +320,683 @@ char *aura_fmt_pretty_print(const char *fmt, int *valid, int *num_args)
 
 // We can't make these functions due to issues of passing ap
 // as an arg on some platforms
-#define va_put_U8(buf, ap)                                \
-	{                                                       \
-		uint8_t v = (uint8_t)va_arg(ap, unsigned int); \
-		aura_buffer_put_u8(buf, v);     \
-	}
 
-#define va_put_S8(buf, ap)                                \
-	{                                                       \
-		int8_t v = (int8_t)va_arg(ap, int);            \
-		aura_buffer_put_s8(buf, v);                               \
-	}                                                       \
+#define noswap(v) v
 
-#define va_put_U16(buf, ap)                                       \
-	{                                                               \
-		uint16_t v = (uint16_t)va_arg(ap, unsigned int);       \
-		aura_buffer_put_u16(buf, v); \
-	}
+/* Store the length prefix of a variable-size field */
+#define put_vbin_len(p, op, len, swap16)                                        \
+	do {                                                                    \
+		if ((op)->type == URPC_VBIN8) {                                 \
+			*(uint8_t *)(p) = (len);                                \
+		} else {                                                        \
+			uint16_t l = (len);                                     \
+			*(uint16_t *)(p) = swap16(l);                           \
+		}                                                               \
+	} while (0)
 
-#define va_put_S16(buf, ap)                               \
-	{                                                       \
-		int16_t v = (int16_t)va_arg(ap, int);          \
-		aura_buffer_put_s16(buf, v); 						\
-	}
+#define get_vbin_len(p, op, swap16)                                             \
+	((op)->type == URPC_VBIN8 ? *(const uint8_t *)(p) :                     \
+	 (uint16_t)swap16(*(const uint16_t *)(p)))
 
-/* FixMe: Portability, we assume no promotion here for now */
-#define va_put_U32(buf, ap)                               \
-	{                                                       \
-		uint32_t v = (uint32_t) va_arg(ap, uint32_t);   \
-		aura_buffer_put_u32(buf, v); 						\
-	}
+/*
+ * Store the next argument from ap as field op at p, in node byte order, and
+ * advance p past it. The span has been checked already, so these go straight
+ * to memory.
+ */
+#define va_put_field(buf, p, op, ap, swap16, swap32, swap64, do_swap)         \
+	switch ((op)->type) {                                                   \
+	case URPC_U8:                                                           \
+		*(uint8_t *)(p) = (uint8_t)va_arg(ap, unsigned int);            \
+		break;                                                          \
+	case URPC_S8:                                                           \
+		*(int8_t *)(p) = (int8_t)va_arg(ap, int);                       \
+		break;                                                          \
+	case URPC_U16:                                                          \
+	{                                                                       \
+		uint16_t v = (uint16_t)va_arg(ap, unsigned int);                \
+		*(uint16_t *)(p) = swap16(v);                                   \
+		break;                                                          \
+	}                                                                       \
+	case URPC_S16:                                                          \
+	{                                                                       \
+		uint16_t v = (uint16_t)(int16_t)va_arg(ap, int);                \
+		*(uint16_t *)(p) = swap16(v);                                   \
+		break;                                                          \
+	}                                                                       \
+	/* FixMe: Portability, we assume no promotion here for now */           \
+	case URPC_U32:                                                          \
+	case URPC_S32:                                                          \
+	{                                                                       \
+		uint32_t v = va_arg(ap, uint32_t);                              \
+		*(uint32_t *)(p) = swap32(v);                                   \
+		break;                                                          \
+	}                                                                       \
+	case URPC_U64:                                                          \
+	case URPC_S64:                                                          \
+	{                                                                       \
+		uint64_t v = va_arg(ap, uint64_t);                              \
+		*(uint64_t *)(p) = swap64(v);                                   \
+		break;                                                          \
+	}                                                                       \
+	/* Floats are promoted to double when passed through varargs */        \
+	case URPC_F32:                                                          \
+	{                                                                       \
+		float f = (float)va_arg(ap, double);                            \
+		uint32_t v;                                                     \
+		memcpy(&v, &f, sizeof(v));                                      \
+		*(uint32_t *)(p) = swap32(v);                                   \
+		break;                                                          \
+	}                                                                       \
+	case URPC_F64:                                                          \
+	{                                                                       \
+		double f = va_arg(ap, double);                                  \
+		uint64_t v;                                                     \
+		memcpy(&v, &f, sizeof(v));                                      \
+		*(uint64_t *)(p) = swap64(v);                                   \
+		break;                                                          \
+	}                                                                       \
+	case URPC_BIN:                                                          \
+		memcpy(p, va_arg(ap, void *), (op)->size);                      \
+		break;                                                          \
+	case URPC_VBIN8:                                                        \
+	case URPC_VBIN16:                                                       \
+	{                                                                       \
+		const void *data = va_arg(ap, const void *);                    \
+		int len = va_arg(ap, int);                                      \
+		put_vbin_len(p, op, len, swap16);                               \
+		memcpy(&(p)[vbin_prefix((op)->type)], data, len);               \
+		(p) += vbin_prefix((op)->type) + len;                           \
+		continue;                                                       \
+	}                                                                       \
+	case URPC_ARRAY:                                                        \
+		if (do_swap && (op)->swap)                                      \
+			aura_swap_array(p, va_arg(ap, void *), (op)->count,     \
+					(op)->size / (op)->count);              \
+		else                                                            \
+			memcpy(p, va_arg(ap, void *), (op)->size);              \
+		break;                                                          \
+	case URPC_BUF:                                                          \
+		/* Transport-specific, let it do the job at the right spot */   \
+		(buf)->pos = (p) - (buf)->data;                                 \
+		aura_buffer_put_buf(buf, va_arg(ap, void *));                   \
+		break;                                                          \
+	}                                                                       \
+	(p) += (op)->size;
+
+/*
+ * Load field op from p into host byte order at dst and advance p past it.
+ * Binary blocks are copied, aura_buffer arguments are fetched by the transport
+ * into a pointer at dst. Variable-size fields are copied to dst with their
+ * length stored at len.
+ */
+#define get_field(buf, dst, len, p, op, swap16, swap32, swap64, do_swap)      \
+	switch ((op)->type) {                                                   \
+	case URPC_U8:                                                           \
+	case URPC_S8:                                                           \
+		*(uint8_t *)(dst) = *(const uint8_t *)(p);                      \
+		break;                                                          \
+	case URPC_U16:                                                          \
+	case URPC_S16:                                                          \
+	{                                                                       \
+		uint16_t v = *(const uint16_t *)(p);                            \
+		*(uint16_t *)(dst) = swap16(v);                                 \
+		break;                                                          \
+	}                                                                       \
+	case URPC_U32:                                                          \
+	case URPC_S32:                                                          \
+	case URPC_F32:                                                          \
+	{                                                                       \
+		uint32_t v = *(const uint32_t *)(p);                            \
+		*(uint32_t *)(dst) = swap32(v);                                 \
+		break;                                                          \
+	}                                                                       \
+	case URPC_U64:                                                          \
+	case URPC_S64:                                                          \
+	case URPC_F64:                                                          \
+	{                                                                       \
+		uint64_t v = *(const uint64_t *)(p);                            \
+		*(uint64_t *)(dst) = swap64(v);                                 \
+		break;                                                          \
+	}                                                                       \
+	case URPC_BIN:                                                          \
+		memcpy(dst, p, (op)->size);                                     \
+		break;                                                          \
+	case URPC_VBIN8:                                                        \
+	case URPC_VBIN16:                                                       \
+	{                                                                       \
+		int l = get_vbin_len(p, op, swap16);                            \
+		memcpy(dst, &(p)[vbin_prefix((op)->type)], l);                  \
+		*(len) = l;                                                     \
+		(p) += vbin_prefix((op)->type) + l;                             \
+		continue;                                                       \
+	}                                                                       \
+	case URPC_ARRAY:                                                        \
+		if (do_swap && (op)->swap)                                      \
+			aura_swap_array(dst, p, (op)->count, (op)->size / (op)->count); \
+		else                                                            \
+			memcpy(dst, p, (op)->size);                             \
+		break;                                                          \
+	case URPC_BUF:                                                          \
+		(buf)->pos = (p) - (buf)->data;                                 \
+		*(struct aura_buffer **)(dst) = aura_buffer_get_buf(buf);       \
+		break;                                                          \
+	}                                                                       \
+	(p) += (op)->size;
 
-#define va_put_S32(buf, ap)                               \
-	{                                                       \
-		int32_t v = (int32_t)va_arg(ap, int32_t);      \
-		aura_buffer_put_s32(buf, v); \
+/**
+ * Returns the length of the payload a call with arguments in ap would take with
+ * a compiled format. That's plan->len unless the format has variable-size fields.
+ *
+ * @param plan compiled format, see aura_fmt_compile(). NULL for no arguments
+ * @param ap
+ * @return the length or -E2BIG if some variable-size field is too long
+ */
+int aura_serialized_len(const struct aura_fmt_plan *plan, va_list ap)
+{
+	const struct aura_fmt_op *op;
+	int len = 0;
+
+	if (!plan)
+		return 0;
+	if (!plan->variable)
+		return plan->len;
+
+	for (op = plan->ops; op < &plan->ops[plan->num_ops]; op++) {
+		switch (op->type) {
+		case URPC_U8:
+		case URPC_S8:
+		case URPC_U16:
+		case URPC_S16:
+			(void)va_arg(ap, int);
+			break;
+		case URPC_U32:
+		case URPC_S32:
+			(void)va_arg(ap, uint32_t);
+			break;
+		case URPC_U64:
+		case URPC_S64:
+			(void)va_arg(ap, uint64_t);
+			break;
+		case URPC_F32:
+		case URPC_F64:
+			(void)va_arg(ap, double);
+			break;
+		case URPC_VBIN8:
+		case URPC_VBIN16:
+		{
+			int l;
+
+			(void)va_arg(ap, void *);
+			l = va_arg(ap, int);
+			if ((l < 0) || (l > op->count))
+				return -E2BIG;
+			len += vbin_prefix(op->type) + l;
+			continue;
+		}
+		default:
+			(void)va_arg(ap, void *);
+			break;
+		}
+		len += op->size;
 	}
+	return len;
+}
+
+/* Validate the whole span of a message to be written once, so that fields can be accessed unchecked */
+static char *plan_span_put(struct aura_buffer *buf, const struct aura_fmt_plan *plan, va_list ap)
+{
+	int len = plan->len;
+	va_list aq;
 
-#define va_put_U64(buf, ap)                               \
-	{                                                       \
-		uint64_t v = (uint64_t)va_arg(ap, uint64_t);   \
-		aura_buffer_put_u64(buf, v); \
+	if (plan->variable) {
+		va_copy(aq, ap);
+		len = aura_serialized_len(plan, aq);
+		va_end(aq);
+		if (len < 0)
+			BUG(buf->owner, "Variable-size argument is too long");
 	}
 
-#define va_put_S64(buf, ap)                               \
-	{                                                       \
-		int64_t v = (int64_t)va_arg(ap, uint64_t);     \
-		aura_buffer_put_s64(buf, v); 					\
-	}                                                       \
+	if (buf->pos + len > buf->size)
+		BUG(buf->owner, "attempt to access data beyound buffer boundary");
+	return &buf->data[buf->pos];
+}
+
+/**
+ * Check that a message to be read fits in the buffer, from its current position.
+ * Variable-size fields are checked against their maximum, too. Incoming messages
+ * are checked on arrival, so that a misbehaving node can't crash the host.
+ *
+ * @param buf
+ * @param plan compiled format
+ * @return 0 if the message is fine, -EBADMSG otherwise
+ */
+int aura_deserialize_check(struct aura_buffer *buf, const struct aura_fmt_plan *plan)
+{
+	const struct aura_fmt_op *op;
+	int pos = buf->pos;
 
-#define va_put_BIN(buf, len, ap)                        \
-	{                                               \
-		void *ptr = va_arg(ap, void *);         \
-		aura_buffer_put_bin(buf, ptr, len); \
+	if (plan->variable) {
+		for (op = plan->ops; op < &plan->ops[plan->num_ops]; op++) {
+			int len = op->size;
+
+			if (URPC_IS_VBIN(op->type)) {
+				const char *p = &buf->data[pos];
+
+				if (pos + vbin_prefix(op->type) > buf->size)
+					return -EBADMSG;
+				len = buf->owner->need_endian_swap ?
+				      get_vbin_len(p, op, __swap16) : get_vbin_len(p, op, noswap);
+				if (len > op->count)
+					return -EBADMSG;
+				len += vbin_prefix(op->type);
+			}
+			pos += len;
+			if (pos > buf->size)
+				return -EBADMSG;
+		}
+	} else {
+		pos += plan->len;
 	}
 
-#define va_put_BUF(buf, ap)                                       \
-	{                                                               \
-		struct aura_buffer *out = va_arg(ap, void *);           \
-		aura_buffer_put_buf(buf, out); \
+	if (pos > buf->size)
+		return -EBADMSG;
+	return 0;
+}
+
+/* Validate the whole span of a message to be read once, so that fields can be accessed unchecked */
+static char *plan_span_get(struct aura_buffer *buf, const struct aura_fmt_plan *plan)
+{
+	if (aura_deserialize_check(buf, plan))
+		BUG(buf->owner, "attempt to access data beyound buffer boundary");
+	return &buf->data[buf->pos];
+}
+
+/**
+ * Serialize a va_list ap of arguments according to a compiled format into an existing
+ * aura_buffer at its current position. The buffer must be large enough to hold the data.
+ * Array fields are passed as pointers to arrays of count elements in host byte order.
+ * Variable-size fields take two arguments: a pointer to the data and an int length.
+ *
+ * @param buf
+ * @param plan compiled format, see aura_fmt_compile(). NULL for no arguments
+ * @param ap
+ */
+void aura_serialize_into(struct aura_buffer *buf, const struct aura_fmt_plan *plan, va_list ap)
+{
+	const struct aura_fmt_op *op, *end;
+	char *start, *p;
+
+	if (!plan)
+		return;
+
+	start = p = plan_span_put(buf, plan, ap);
+	end = &plan->ops[plan->num_ops];
+	if (buf->owner->need_endian_swap) {
+		for (op = plan->ops; op < end; op++) {
+			va_put_field(buf, p, op, ap, __swap16, __swap32, __swap64, true);
+		}
+	} else {
+		for (op = plan->ops; op < end; op++) {
+			va_put_field(buf, p, op, ap, noswap, noswap, noswap, false);
+		}
 	}
 
+	buf->pos = p - buf->data;
+	/* Calculate the relevant payload size */
+	buf->payload_size = p - start;
+}
+
 /**
- * Serialize a va_list ap of arguments according to format in an allocated aura_buffer
+ * Serialize a va_list ap of arguments according to a compiled format in an allocated aura_buffer
  * This function takes care to do all the needed endian swapping and buffer overhead handling.
+ * The buffer is only as large as this particular call needs.
  *
  * @param node
- * @param fmt
+ * @param plan compiled format, see aura_fmt_compile(). NULL for no arguments
  * @param ap
- * @return
+ * @return the buffer or NULL if some variable-size argument is too long
  */
-struct aura_buffer *aura_serialize(struct aura_node *node, const char *fmt, int size, va_list ap)
+struct aura_buffer *aura_serialize_plan(struct aura_node *node, const struct aura_fmt_plan *plan, va_list ap)
 {
-	struct aura_buffer *buf = aura_buffer_request(node, size);
-	size_t intitial_pos = buf->pos;
+	struct aura_buffer *buf;
+	int len = plan ? plan->len : 0;
+	va_list aq;
 
+	if (plan && plan->variable) {
+		va_copy(aq, ap);
+		len = aura_serialized_len(plan, aq);
+		va_end(aq);
+		if (len < 0)
+			return NULL;
+	}
+
+	buf = aura_buffer_request(node, len);
 	if (!buf)
 		return NULL;
 
-#define PUT(n)                                                  \
-case URPC_ ## n:                                        \
-	va_put_ ## n(buf, ap);  \
-	break;                                          \
+	aura_serialize_into(buf, plan, ap);
+	return buf;
+}
 
-	while (*fmt) {
-		switch (*fmt++) {
-			PUT(U8);
-			PUT(S8);
-			PUT(U16);
-			PUT(S16);
-			PUT(U32);
-			PUT(S32);
-			PUT(U64);
-			PUT(S64);
-			PUT(BUF);
+/**
+ * Serialize a va_list ap of arguments according to format in an allocated aura_buffer.
+ * This compiles the format on every call, use aura_serialize_plan() with a plan
+ * compiled once instead.
+ *
+ * @param node
+ * @param fmt
+ * @param size ignored, the buffer is as large as the arguments need
+ * @param ap
+ * @return the buffer or NULL if some variable-size argument is too long
+ */
+struct aura_buffer *aura_serialize(struct aura_node *node, const char *fmt, int size, va_list ap)
+{
+	struct aura_fmt_plan *plan = aura_fmt_compile(node, fmt);
+	struct aura_buffer *buf = aura_serialize_plan(node, plan, ap);
+
+	free(plan);
+	return buf;
+}
+
+/**
+ * Deserialize the data of a compiled format at buffer's current position into
+ * variables pointed to by a va_list ap of pointers, one per field, and advance
+ * the buffer past it. The span is checked against the buffer boundary once.
+ *
+ * Integers and floats are stored into variables of the respective type, binary blocks and
+ * arrays are copied to the memory pointed to, aura_buffer fields are stored
+ * into struct aura_buffer * variables. Variable-size fields take two pointers:
+ * the data is copied to the first one, which should have room for the maximum
+ * length, and the actual length is stored into an int pointed to by the second.
+ *
+ * @param buf
+ * @param plan compiled format, see aura_fmt_compile(). NULL for no data
+ * @param ap
+ */
+void aura_deserialize(struct aura_buffer *buf, const struct aura_fmt_plan *plan, va_list ap)
+{
+	const struct aura_fmt_op *op, *end;
+	char *p;
+
+	if (!plan)
+		return;
+
+	p = plan_span_get(buf, plan);
+	end = &plan->ops[plan->num_ops];
+	if (buf->owner->need_endian_swap) {
+		for (op = plan->ops; op < end; op++) {
+			void *dst = va_arg(ap, void *);
+			int *len = URPC_IS_VBIN(op->type) ? va_arg(ap, int *) : NULL;
+
+			get_field(buf, dst, len, p, op, __swap16, __swap32, __swap64, true);
+		}
+	} else {
+		for (op = plan->ops; op < end; op++) {
+			void *dst = va_arg(ap, void *);
+			int *len = URPC_IS_VBIN(op->type) ? va_arg(ap, int *) : NULL;
+
+			get_field(buf, dst, len, p, op, noswap, noswap, noswap, false);
+		}
+	}
+
+	buf->pos = p - buf->data;
+}
+
+/**
+ * Deserialize the data of a compiled format at buffer's current position into
+ * a flat host byte order copy at dst, laid out at the offsets of the plan,
+ * and advance the buffer past it. dst must hold plan->len bytes.
+ * Variable-size fields are stored as their length, an uint8_t or uint16_t like
+ * the prefix on the wire, followed by the data.
+ * This is what the bindings use to parse responses with a single bounds check.
+ *
+ * @param buf
+ * @param plan compiled format, see aura_fmt_compile(). NULL for no data
+ * @param dst
+ */
+void aura_deserialize_flat(struct aura_buffer *buf, const struct aura_fmt_plan *plan, void *dst)
+{
+	const struct aura_fmt_op *op, *end;
+	char *out = dst;
+	char *p;
+
+	if (!plan)
+		return;
+
+	p = plan_span_get(buf, plan);
+	end = &plan->ops[plan->num_ops];
+	if (buf->owner->need_endian_swap) {
+		for (op = plan->ops; op < end; op++) {
+			char *field = &out[op->offset];
+			int len;
+
+			if (URPC_IS_VBIN(op->type)) {
+				len = get_vbin_len(p, op, __swap16);
+				put_vbin_len(field, op, len, noswap);
+				field += vbin_prefix(op->type);
+			}
+			get_field(buf, field, &len, p, op, __swap16, __swap32, __swap64, true);
+		}
+	} else {
+		for (op = plan->ops; op < end; op++) {
+			char *field = &out[op->offset];
+			int len;
+
+			if (URPC_IS_VBIN(op->type)) {
+				len = get_vbin_len(p, op, noswap);
+				put_vbin_len(field, op, len, noswap);
+				field += vbin_prefix(op->type);
+			}
+			get_field(buf, field, &len, p, op, noswap, noswap, noswap, false);
+		}
+	}
+
+	buf->pos = p - buf->data;
+}
+
+/* Store a value as field op at p in node byte order and advance p past it */
+#define put_value(buf, p, op, v, swap16, swap32, swap64, do_swap)             \
+	switch ((op)->type) {                                                   \
+	case URPC_U8:                                                           \
+	case URPC_S8:                                                           \
+		*(uint8_t *)(p) = (v)->u8;                                      \
+		break;                                                          \
+	case URPC_U16:                                                          \
+	case URPC_S16:                                                          \
+		*(uint16_t *)(p) = swap16((v)->u16);                            \
+		break;                                                          \
+	case URPC_U32:                                                          \
+	case URPC_S32:                                                          \
+	case URPC_F32:                                                          \
+		*(uint32_t *)(p) = swap32((v)->u32);                            \
+		break;                                                          \
+	case URPC_U64:                                                          \
+	case URPC_S64:                                                          \
+	case URPC_F64:                                                          \
+		*(uint64_t *)(p) = swap64((v)->u64);                            \
+		break;                                                          \
+	case URPC_BIN:                                                          \
+		/* Shorter blocks are padded with zeroes */                     \
+		memcpy(p, (v)->bin.ptr, (v)->bin.len);                          \
+		memset(&(p)[(v)->bin.len], 0, (op)->size - (v)->bin.len);      \
+		break;                                                          \
+	case URPC_VBIN8:                                                        \
+	case URPC_VBIN16:                                                       \
+		put_vbin_len(p, op, (v)->bin.len, swap16);                      \
+		memcpy(&(p)[vbin_prefix((op)->type)], (v)->bin.ptr, (v)->bin.len); \
+		(p) += vbin_prefix((op)->type) + (v)->bin.len;                  \
+		continue;                                                       \
+	case URPC_ARRAY:                                                        \
+		if (do_swap && (op)->swap)                                      \
+			aura_swap_array(p, (v)->bin.ptr, (op)->count,           \
+					(op)->size / (op)->count);              \
+		else                                                            \
+			memcpy(p, (v)->bin.ptr, (op)->size);                    \
+		break;                                                          \
+	case URPC_BUF:                                                          \
+		(buf)->pos = (p) - (buf)->data;                                 \
+		aura_buffer_put_buf(buf, (v)->buf);                             \
+		break;                                                          \
+	}                                                                       \
+	(p) += (op)->size;
+
+/* Check values against a compiled format, returns the length of the message they make */
+static int values_len(const struct aura_fmt_plan *plan, const struct aura_value *values, int n)
+{
+	const struct aura_fmt_op *op;
+	int len = 0;
+
+	if (n != (plan ? plan->num_ops : 0))
+		return -EINVAL;
+	if (!n)
+		return 0;
+
+	for (op = plan->ops; op < &plan->ops[n]; op++, values++) {
+		if (values->type != op->type)
+			return -EINVAL;
+
+		switch (op->type) {
 		case URPC_BIN:
-		{
-			int len = atoi(fmt);
-			if (len == 0)
-				BUG(NULL, "Internal serilizer bug processing: %s", fmt);
-			va_put_BIN(buf, len, ap);
-			while (*fmt && (*fmt++ != '.'));
+			if ((values->bin.len < 0) || (values->bin.len > op->size))
+				return -E2BIG;
+			break;
+		case URPC_VBIN8:
+		case URPC_VBIN16:
+			if ((values->bin.len < 0) || (values->bin.len > op->count))
+				return -E2BIG;
+			len += vbin_prefix(op->type) + values->bin.len;
+			continue;
+		case URPC_ARRAY:
+			/* All of the elements, nothing less */
+			if (values->bin.len != op->size)
+				return -EINVAL;
 			break;
 		}
+		len += op->size;
+	}
+	return len;
+}
+
+/**
+ * Serialize an array of values according to a compiled format in an allocated
+ * aura_buffer. This is what bindings and generated code should use instead of
+ * building a va_list: values are type-checked against the format, and there's
+ * no integer promotion to worry about.
+ *
+ * There should be a value for every field of the format, of the same type.
+ * Binary blocks may be shorter than the field, the rest is filled with zeroes.
+ * Arrays point to all of their elements in host byte order, their length must
+ * be that of the field.
+ *
+ * @param node
+ * @param plan compiled format, see aura_fmt_compile(). NULL for no arguments
+ * @param args
+ * @param n number of values in args
+ * @param bufp where to store the buffer
+ * @return 0 on success, -EINVAL if the values don't match the format,
+ *         -E2BIG if some binary data doesn't fit its field, -ENOMEM
+ */
+int aura_serialize_values(struct aura_node *node, const struct aura_fmt_plan *plan,
+			  const struct aura_value *args, int n, struct aura_buffer **bufp)
+{
+	const struct aura_fmt_op *op, *end;
+	struct aura_buffer *buf;
+	int len = values_len(plan, args, n);
+	char *start, *p;
+
+	if (len < 0)
+		return len;
+
+	buf = aura_buffer_request(node, len);
+	if (!buf)
+		return -ENOMEM;
+
+	start = p = &buf->data[buf->pos];
+	if (n) {
+		end = &plan->ops[n];
+		if (node->need_endian_swap) {
+			for (op = plan->ops; op < end; op++, args++) {
+				put_value(buf, p, op, args, __swap16, __swap32, __swap64, true);
+			}
+		} else {
+			for (op = plan->ops; op < end; op++, args++) {
+				put_value(buf, p, op, args, noswap, noswap, noswap, false);
+			}
 		}
-		;
 	}
-	;
 
-	/* Calculate the relevant payload size */
-	buf->payload_size = buf->pos - intitial_pos;
+	buf->pos = p - buf->data;
+	buf->payload_size = p - start;
+	*bufp = buf;
+	return 0;
+}
 
-	return buf;
+/* Where a value of this field goes, NULL if the caller isn't interested */
+static void *value_dst(const struct aura_fmt_op *op, struct aura_value *v)
+{
+	v->type = op->type;
+	switch (op->type) {
+	case URPC_BIN:
+	case URPC_ARRAY:
+		v->bin.len = op->size;
+		return v->bin.ptr;
+	case URPC_VBIN8:
+	case URPC_VBIN16:
+		return v->bin.ptr;
+	case URPC_BUF:
+		return &v->buf;
+	default:
+		return &v->u64;
+	}
+}
+
+/**
+ * Deserialize the data of a compiled format at buffer's current position into
+ * an array of values, one per field, and advance the buffer past it.
+ *
+ * The type of every value is set to that of the field. Binary blocks, arrays
+ * and variable-size data are copied to bin.ptr, which should have room for
+ * the maximum size of the field, and their length is stored into bin.len.
+ * They are skipped if bin.ptr is NULL.
+ *
+ * @param buf
+ * @param plan compiled format, see aura_fmt_compile(). NULL for no data
+ * @param rets
+ */
+void aura_deserialize_values(struct aura_buffer *buf, const struct aura_fmt_plan *plan,
+			     struct aura_value *rets)
+{
+	const struct aura_fmt_op *op, *end;
+	char *p;
+
+	if (!plan)
+		return;
+
+	p = plan_span_get(buf, plan);
+	end = &plan->ops[plan->num_ops];
+	if (buf->owner->need_endian_swap) {
+		for (op = plan->ops; op < end; op++, rets++) {
+			void *dst = value_dst(op, rets);
+
+			if (!dst) {
+				p += URPC_IS_VBIN(op->type) ?
+				     vbin_prefix(op->type) + get_vbin_len(p, op, __swap16) : op->size;
+				continue;
+			}
+			get_field(buf, dst, &rets->bin.len, p, op, __swap16, __swap32, __swap64, true);
+		}
+	} else {
+		for (op = plan->ops; op < end; op++, rets++) {
+			void *dst = value_dst(op, rets);
+
+			if (!dst) {
+				p += URPC_IS_VBIN(op->type) ?
+				     vbin_prefix(op->type) + get_vbin_len(p, op, noswap) : op->size;
+				continue;
+			}
+			get_field(buf, dst, &rets->bin.len, p, op, noswap, noswap, noswap, false);
+		}
+	}
+
+	buf->pos = p - buf->data;
 }
@@ -0,0 +1,211 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+
+/* A block copied between a host struct and the wire, in elements of size bytes */
+struct aura_struct_field {
+	int	host;
+	int	wire;
+	int	count;
+	/* Element size, byte-swapped on the way if more than 1 */
+	int	size;
+};
+
+/* How to copy a host struct to a message of some format and back */
+struct aura_struct_map {
+	/* Fields merged into blocks that are the same on both sides, for nodes of our endianness */
+	int				num_runs;
+	struct aura_struct_field *	runs;
+	/* Every field on its own, for nodes that need byte-swapping */
+	int				num_fields;
+	struct aura_struct_field *	fields;
+	struct aura_struct_field	storage[];
+};
+
+static int struct_map_build(const struct aura_fmt_plan *plan, const size_t *offsets,
+			    struct aura_struct_map **mapp)
+{
+	int num = plan ? plan->num_ops : 0;
+	struct aura_struct_map *map;
+	int i;
+
+	map = malloc(sizeof(*map) + 2 * num * sizeof(struct aura_struct_field));
+	if (!map)
+		return -ENOMEM;
+
+	map->fields = &map->storage[0];
+	map->runs = &map->storage[num];
+	map->num_fields = num;
+	map->num_runs = 0;
+
+	for (i = 0; i < num; i++) {
+		const struct aura_fmt_op *op = &plan->ops[i];
+		struct aura_struct_field *f = &map->fields[i];
+		struct aura_struct_field *run = map->num_runs ? &map->runs[map->num_runs - 1] : NULL;
+
+		if ((op->type == URPC_BUF) || URPC_IS_VBIN(op->type)) {
+			free(map);
+			return -EINVAL;
+		}
+
+		f->host = offsets ? offsets[i] : op->offset;
+		f->wire = op->offset;
+		f->size = op->swap ? op->size / op->count : 1;
+		f->count = op->size / f->size;
+
+		/* Adjacent on both sides? Just copy them in one go */
+		if (run && (run->host + run->count == f->host) && (run->wire + run->count == f->wire)) {
+			run->count += op->size;
+			continue;
+		}
+		run = &map->runs[map->num_runs++];
+		run->host = f->host;
+		run->wire = f->wire;
+		run->count = op->size;
+		run->size = 1;
+	}
+
+	free(*mapp);
+	*mapp = map;
+	return 0;
+}
+
+static void struct_map_apply(const struct aura_struct_map *map, char *dst, const char *src,
+			     bool swap, bool to_wire)
+{
+	const struct aura_struct_field *f, *end;
+
+	if (!swap) {
+		f = map->runs;
+		end = &map->runs[map->num_runs];
+	} else {
+		f = map->fields;
+		end = &map->fields[map->num_fields];
+	}
+
+	for (; f < end; f++) {
+		char *to = to_wire ? &dst[f->wire] : &dst[f->host];
+		const char *from = to_wire ? &src[f->host] : &src[f->wire];
+
+		if (f->size > 1)
+			aura_swap_array(to, from, f->count, f->size);
+		else
+			memcpy(to, from, f->count);
+	}
+}
+
+/* The layout defaults to a packed struct that looks just like the message */
+static int struct_maps_get(struct aura_object *o)
+{
+	int ret = 0;
+
+	if (!o->arg_map)
+		ret = struct_map_build(o->arg_plan, NULL, &o->arg_map);
+	if (!ret && !o->ret_map)
+		ret = struct_map_build(o->ret_plan, NULL, &o->ret_map);
+	return ret;
+}
+
+/**
+ * \addtogroup sync
+ * @{
+ */
+
+/**
+ * Declare the layout of host structs that hold the arguments and the return
+ * values of a method, for use with aura_call_struct().
+ *
+ * Offsets are given one per field of the respective format, in order, e.g. with
+ * offsetof(). NULL means a packed struct that has the fields in the same places
+ * as the message itself. The copying is planned once here, so that each call
+ * boils down to a memcpy() of a few blocks, or of one if the layout is packed.
+ *
+ * Binary blocks and arrays map to arrays in the struct. aura_buffer and
+ * variable-size fields are not supported.
+ *
+ * @param node
+ * @param name
+ * @param arg_offsets offsets of argument fields in the argument struct
+ * @param ret_offsets offsets of return value fields in the return struct
+ * @return 0 on success, -ENOENT if there's no such object, -EINVAL if the object
+ *         has fields that can't be mapped to a struct
+ */
+int aura_object_set_struct_layout(struct aura_node *node, const char *name,
+				  const size_t *arg_offsets, const size_t *ret_offsets)
+{
+	struct aura_object *o = aura_etable_find(node->tbl, name);
+	int ret;
+
+	if (!o)
+		return -ENOENT;
+
+	ret = struct_map_build(o->arg_plan, arg_offsets, &o->arg_map);
+	if (!ret)
+		ret = struct_map_build(o->ret_plan, ret_offsets, &o->ret_map);
+	return ret;
+}
+
+/**
+ * Synchronously call an object identified by id, taking the arguments from a
+ * host struct and putting the return values into another one. The structs
+ * should be laid out as declared with aura_object_set_struct_layout(), or be
+ * packed copies of the messages if nothing was declared.
+ *
+ * The caller never deals with aura_buffer and the arguments don't go through
+ * varargs.
+ *
+ * @param node
+ * @param id
+ * @param arg_struct arguments, may be NULL for methods with no arguments
+ * @param ret_struct where to put the return values, NULL to drop them
+ * @return AURA_CALL_* status of the call or
+ *                 -EBADSLT if the requested id is not in etable
+ *                 -EINVAL if the object has fields that can't be mapped to a struct,
+ *                         or arg_struct is NULL for a method with arguments
+ *                 -EBADMSG if the response is too short for the return values
+ *                 -ENOEXEC if the node is currently offline
+ *                 -EAGAIN if the outbound queue is full
+ */
+int aura_call_struct(struct aura_node *node, int id, const void *arg_struct, void *ret_struct)
+{
+	struct aura_object *o = aura_etable_find_id(node->tbl, id);
+	struct aura_buffer *buf, *retbuf;
+	int ret;
+
+	if (!o)
+		return -EBADSLT;
+
+	ret = struct_maps_get(o);
+	if (ret)
+		return ret;
+	if (!arg_struct && o->arglen)
+		return -EINVAL;
+
+	buf = aura_buffer_request(node, o->arglen);
+	struct_map_apply(o->arg_map, aura_buffer_payload_ptr(buf), arg_struct,
+			 node->need_endian_swap, true);
+	buf->payload_size = o->arglen;
+
+	ret = aura_core_call(node, o, &retbuf, buf);
+	if (ret < 0) {
+		aura_buffer_release(buf);
+		return ret;
+	}
+
+	if (ret == AURA_CALL_COMPLETED) {
+		/* The node could have gone and come back with a new etable meanwhile */
+		if (ret_struct && (retbuf->object == o)) {
+			if (node->tr->buffer_offset + o->retlen > retbuf->size) {
+				aura_buffer_release(retbuf);
+				return -EBADMSG;
+			}
+			struct_map_apply(o->ret_map, ret_struct, aura_buffer_payload_ptr(retbuf),
+					 node->need_endian_swap, false);
+		}
+		aura_buffer_release(retbuf);
+	}
+	return ret;
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,199 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define AURA_SWAP_X86
+#endif
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+/*
+ * Bulk byte-swapping kernels for array fields of big-endian nodes.
+ * Every kernel handles dst == src and unaligned pointers.
+ */
+
+typedef void (*swap_fn)(void *dst, const void *src, int count);
+
+static void swap16_scalar(void *dst, const void *src, int count)
+{
+	const uint16_t *s = src;
+	uint16_t *d = dst;
+	int i;
+
+	for (i = 0; i < count; i++)
+		d[i] = __swap16(s[i]);
+}
+
+static void swap32_scalar(void *dst, const void *src, int count)
+{
+	const uint32_t *s = src;
+	uint32_t *d = dst;
+	int i;
+
+	for (i = 0; i < count; i++)
+		d[i] = __swap32(s[i]);
+}
+
+static void swap64_scalar(void *dst, const void *src, int count)
+{
+	const uint64_t *s = src;
+	uint64_t *d = dst;
+	int i;
+
+	for (i = 0; i < count; i++)
+		d[i] = __swap64(s[i]);
+}
+
+#ifdef AURA_SWAP_X86
+
+/* pshufb masks reversing the bytes of each element, one per element size */
+#define SHUF16 1, 0, 3, 2, 5, 4, 7, 6, 9, 8, 11, 10, 13, 12, 15, 14
+#define SHUF32 3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12
+#define SHUF64 7, 6, 5, 4, 3, 2, 1, 0, 15, 14, 13, 12, 11, 10, 9, 8
+
+#define DECLARE_SSSE3_SWAP(bits, scalar)                                         \
+	__attribute__((target("ssse3")))                                         \
+	static void swap ## bits ## _ssse3(void *dst, const void *src, int count) \
+	{                                                                        \
+		const __m128i mask = _mm_setr_epi8(SHUF ## bits);                \
+		const int per_vec = 128 / bits;                                  \
+		const char *s = src;                                             \
+		char *d = dst;                                                   \
+		int i;                                                           \
+                                                                                 \
+		for (i = 0; i + per_vec <= count; i += per_vec) {                \
+			__m128i v = _mm_loadu_si128((const __m128i *)s);         \
+			_mm_storeu_si128((__m128i *)d, _mm_shuffle_epi8(v, mask)); \
+			s += 16;                                                 \
+			d += 16;                                                 \
+		}                                                                \
+		scalar(d, s, count - i);                                         \
+	}
+
+#define DECLARE_AVX2_SWAP(bits, scalar)                                          \
+	__attribute__((target("avx2")))                                          \
+	static void swap ## bits ## _avx2(void *dst, const void *src, int count) \
+	{                                                                        \
+		const __m256i mask = _mm256_setr_epi8(SHUF ## bits, SHUF ## bits); \
+		const int per_vec = 256 / bits;                                  \
+		const char *s = src;                                             \
+		char *d = dst;                                                   \
+		int i;                                                           \
+                                                                                 \
+		for (i = 0; i + per_vec <= count; i += per_vec) {                \
+			__m256i v = _mm256_loadu_si256((const __m256i *)s);      \
+			_mm256_storeu_si256((__m256i *)d, _mm256_shuffle_epi8(v, mask)); \
+			s += 32;                                                 \
+			d += 32;                                                 \
+		}                                                                \
+		scalar(d, s, count - i);                                         \
+	}
+
+DECLARE_SSSE3_SWAP(16, swap16_scalar);
+DECLARE_SSSE3_SWAP(32, swap32_scalar);
+DECLARE_SSSE3_SWAP(64, swap64_scalar);
+
+DECLARE_AVX2_SWAP(16, swap16_scalar);
+DECLARE_AVX2_SWAP(32, swap32_scalar);
+DECLARE_AVX2_SWAP(64, swap64_scalar);
+
+#endif
+
+#ifdef __ARM_NEON
+
+#define DECLARE_NEON_SWAP(bits, scalar)                                          \
+	static void swap ## bits ## _neon(void *dst, const void *src, int count) \
+	{                                                                        \
+		const int per_vec = 128 / bits;                                  \
+		const uint8_t *s = src;                                          \
+		uint8_t *d = dst;                                                \
+		int i;                                                           \
+                                                                                 \
+		for (i = 0; i + per_vec <= count; i += per_vec) {                \
+			vst1q_u8(d, vrev ## bits ## q_u8(vld1q_u8(s)));          \
+			s += 16;                                                 \
+			d += 16;                                                 \
+		}                                                                \
+		scalar(d, s, count - i);                                         \
+	}
+
+DECLARE_NEON_SWAP(16, swap16_scalar);
+DECLARE_NEON_SWAP(32, swap32_scalar);
+DECLARE_NEON_SWAP(64, swap64_scalar);
+
+#endif
+
+/* Indexed by log2 of the element size minus one */
+static swap_fn kernels[3];
+
+static void swap_select_kernels(void)
+{
+	swap_fn k[3] = { swap16_scalar, swap32_scalar, swap64_scalar };
+
+#if defined(AURA_SWAP_X86)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		k[0] = swap16_avx2;
+		k[1] = swap32_avx2;
+		k[2] = swap64_avx2;
+	} else if (__builtin_cpu_supports("ssse3")) {
+		k[0] = swap16_ssse3;
+		k[1] = swap32_ssse3;
+		k[2] = swap64_ssse3;
+	}
+#elif defined(__ARM_NEON)
+	k[0] = swap16_neon;
+	k[1] = swap32_neon;
+	k[2] = swap64_neon;
+#endif
+	/* Racing threads all come up with the same answer */
+	kernels[1] = k[1];
+	kernels[2] = k[2];
+	__atomic_store_n(&kernels[0], k[0], __ATOMIC_RELEASE);
+}
+
+/**
+ * \addtogroup retparse
+ * @{
+ */
+
+/**
+ * Byte-swap an array of count elements of size bytes each from src to dst,
+ * using the fastest kernel the CPU supports. dst may be the same as src.
+ * Elements of size 1 are just copied.
+ *
+ * @param dst
+ * @param src
+ * @param count number of elements
+ * @param size element size: 1, 2, 4 or 8
+ */
+void aura_swap_array(void *dst, const void *src, int count, int size)
+{
+	if (!__atomic_load_n(&kernels[0], __ATOMIC_ACQUIRE))
+		swap_select_kernels();
+
+	switch (size) {
+	case 1:
+		if (dst != src)
+			memmove(dst, src, count);
+		break;
+	case 2:
+		kernels[0](dst, src, count);
+		break;
+	case 4:
+		kernels[1](dst, src, count);
+		break;
+	case 8:
+		kernels[2](dst, src, count);
+		break;
+	default:
+		BUG(NULL, "Can't byte-swap elements of %d bytes", size);
+	}
+}
+
+/**
+ * @}
+ */
@@ -0,0 +1,413 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+#include <aura/eventloop.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * Bounded MPSC ring of submitted calls. Any thread may push, only the
+ * thread running the eventloop pops. Each cell carries a sequence number
+ * that tells producers and the consumer whose turn it is, so no locks
+ * are needed (See D. Vyukov's bounded MPMC queue).
+ */
+struct aura_xring_cell {
+	atomic_size_t		seq;
+	struct aura_xcall *	xc;
+};
+
+struct aura_xring {
+	size_t			mask;
+	atomic_size_t		head;
+	/* Only touched by the eventloop thread */
+	size_t			tail;
+	/* Set once a wakeup has been sent, until the loop drains the ring */
+	atomic_int		wakeup_pending;
+	struct aura_xring_cell	cells[];
+};
+
+struct aura_xcall_cq {
+	pthread_mutex_t		lock;
+	pthread_cond_t		cond;
+	struct list_head	done;
+};
+
+static int xring_push(struct aura_xring *ring, struct aura_xcall *xc)
+{
+	struct aura_xring_cell *cell;
+	size_t pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+
+	for (;;) {
+		size_t seq;
+		intptr_t diff;
+
+		cell = &ring->cells[pos & ring->mask];
+		seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+		diff = (intptr_t)seq - (intptr_t)pos;
+		if (diff == 0) {
+			if (atomic_compare_exchange_weak_explicit(&ring->head, &pos, pos + 1,
+								  memory_order_relaxed,
+								  memory_order_relaxed))
+				break;
+		} else if (diff < 0) {
+			return -EAGAIN;
+		} else {
+			pos = atomic_load_explicit(&ring->head, memory_order_relaxed);
+		}
+	}
+
+	cell->xc = xc;
+	atomic_store_explicit(&cell->seq, pos + 1, memory_order_release);
+	return 0;
+}
+
+static struct aura_xcall *xring_pop(struct aura_xring *ring)
+{
+	struct aura_xring_cell *cell = &ring->cells[ring->tail & ring->mask];
+	struct aura_xcall *xc;
+	size_t seq = atomic_load_explicit(&cell->seq, memory_order_acquire);
+
+	if (seq != ring->tail + 1)
+		return NULL;
+
+	xc = cell->xc;
+	atomic_store_explicit(&cell->seq, ring->tail + ring->mask + 1, memory_order_release);
+	ring->tail++;
+	return xc;
+}
+
+/* Buffers that cross threads never come from node's pool */
+static struct aura_buffer *xbuf_alloc(struct aura_node *node, int size)
+{
+	char *data = malloc(size + sizeof(struct aura_buffer));
+	struct aura_buffer *buf = (struct aura_buffer *)data;
+
+	if (!buf)
+		return NULL;
+
+	buf->data = &data[sizeof(*buf)];
+	buf->magic = AURA_BUFFER_MAGIC_ID;
+	buf->size = size;
+	buf->owner = node;
+	buf->object = NULL;
+	buf->call_tag = 0;
+	buf->slot = NULL;
+	buf->prio = AURA_CALL_PRIO_DEFAULT;
+	buf->pool_class = -1;
+	buf->refcount = 1;
+	buf->payload_size = 0;
+	INIT_LIST_HEAD(&buf->refs);
+	aura_buffer_rewind(buf);
+	return buf;
+}
+
+static void xbuf_copy(struct aura_buffer *dst, struct aura_buffer *src)
+{
+	memcpy(dst->data, src->data, src->size);
+	dst->pos = src->pos;
+	dst->payload_size = src->payload_size;
+}
+
+static void xcall_complete(struct aura_xcall *xc, int status)
+{
+	struct aura_xcall_cq *cq = xc->cq;
+
+	xc->status = status;
+	pthread_mutex_lock(&cq->lock);
+	list_add_tail(&xc->qentry, &cq->done);
+	pthread_cond_signal(&cq->cond);
+	pthread_mutex_unlock(&cq->lock);
+}
+
+static void xcall_done_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	struct aura_xcall *xc = arg;
+
+	if (retbuf) {
+		xc->retbuf = xbuf_alloc(node, retbuf->size);
+		if (!xc->retbuf)
+			BUG(node, "FATAL: malloc() failed");
+		xbuf_copy(xc->retbuf, retbuf);
+	}
+	xcall_complete(xc, status);
+}
+
+static void xcall_start(struct aura_eventloop *loop, struct aura_xcall *xc)
+{
+	struct aura_node *node = xc->node;
+	struct aura_buffer *buf;
+	int ret;
+
+	/* The node has been moved to another loop, the caller should retry */
+	if (aura_node_eventloop_get(node) != loop) {
+		free(xc->argbuf);
+		xc->argbuf = NULL;
+		xcall_complete(xc, -EAGAIN);
+		return;
+	}
+
+	/* The etable may have changed while the call was travelling */
+	if (node->tbl != xc->tbl) {
+		free(xc->argbuf);
+		xc->argbuf = NULL;
+		xcall_complete(xc, -EBADSLT);
+		return;
+	}
+
+	buf = aura_buffer_request(node, xc->object->arglen);
+	xbuf_copy(buf, xc->argbuf);
+	free(xc->argbuf);
+	xc->argbuf = NULL;
+
+	ret = aura_core_start_call(node, xc->object, xcall_done_cb, xc, buf);
+	if (ret != 0) {
+		aura_buffer_release(buf);
+		xcall_complete(xc, ret);
+	}
+}
+
+/**
+ * Start all the calls submitted to this loop from other threads.
+ * Eventloop modules call this one from the loop thread once woken up.
+ *
+ * @param loop
+ */
+void aura_eventloop_xcall_process(struct aura_eventloop *loop)
+{
+	struct aura_xring *ring = loop->xring;
+	struct aura_xcall *xc;
+
+	if (!ring)
+		return;
+
+	/* Anything pushed after this point will wake us up again */
+	atomic_store(&ring->wakeup_pending, 0);
+	while ((xc = xring_pop(ring)))
+		xcall_start(loop, xc);
+}
+
+/**
+ * Fail all the calls still sitting in the loop's ring and free the ring.
+ *
+ * @param loop
+ */
+void aura_eventloop_xcall_cleanup(struct aura_eventloop *loop)
+{
+	struct aura_xring *ring = loop->xring;
+	struct aura_xcall *xc;
+
+	if (!ring)
+		return;
+
+	while ((xc = xring_pop(ring))) {
+		free(xc->argbuf);
+		xc->argbuf = NULL;
+		xcall_complete(xc, AURA_CALL_TRANSPORT_FAIL);
+	}
+	free(ring);
+	loop->xring = NULL;
+}
+
+/** \addtogroup xcall
+ *  @{
+ */
+
+/**
+ * Allow other threads to submit calls to nodes in this loop with aura_xcall_submit().
+ *
+ * This should be called from the thread running the loop before any other thread
+ * starts submitting calls. The ring holds up to size calls that have been submitted,
+ * but not yet picked up by the loop. size is rounded up to a power of two.
+ *
+ * @param loop
+ * @param size
+ * @return 0 on success, -ENOSYS if the eventloop module can't be woken up from another thread,
+ *         -ENOMEM if out of memory
+ */
+int aura_eventloop_xcall_enable(struct aura_eventloop *loop, int size)
+{
+	struct aura_xring *ring;
+	size_t num = 1;
+	size_t i;
+
+	if (loop->xring)
+		return 0;
+
+	if (!loop->module->wakeup)
+		return -ENOSYS;
+
+	while (num < (size_t)size)
+		num <<= 1;
+
+	ring = calloc(1, sizeof(*ring) + num * sizeof(struct aura_xring_cell));
+	if (!ring)
+		return -ENOMEM;
+
+	ring->mask = num - 1;
+	for (i = 0; i < num; i++)
+		atomic_init(&ring->cells[i].seq, i);
+	atomic_init(&ring->head, 0);
+	atomic_init(&ring->wakeup_pending, 0);
+	loop->xring = ring;
+	return 0;
+}
+
+/**
+ * Submit a call to a node from any thread. This function is thread-safe and does
+ * not block. The arguments are serialized by the calling thread, the call itself
+ * is started by the thread running the node's eventloop. Once the call completes
+ * the resulting struct aura_xcall is delivered to the completion queue cq.
+ * Fetch it with aura_xcall_cq_wait() and free with aura_xcall_release().
+ *
+ * The node's export table must not change while other threads are submitting calls,
+ * e.g. the node must stay online. Calls that raced an etable change complete with
+ * -EBADSLT status, calls that raced the node moving to another loop complete with -EAGAIN.
+ *
+ * @param node
+ * @param name
+ * @param cq
+ * @param arg
+ * @return 0 on success, -ENOSYS if cross-thread calls are not enabled for the node's loop
+ *         (see aura_eventloop_xcall_enable()), -ENOENT if there's no such object,
+ *         -ENOMEM if out of memory, -EAGAIN if the ring is full
+ */
+int aura_xcall_submit(struct aura_node *node, const char *name, struct aura_xcall_cq *cq, void *arg, ...)
+{
+	struct aura_eventloop *loop = aura_node_eventloop_get(node);
+	struct aura_xring *ring = loop ? loop->xring : NULL;
+	struct aura_xcall *xc;
+	struct aura_object *o;
+	va_list ap;
+	int ret;
+
+	if (!ring)
+		return -ENOSYS;
+
+	o = aura_etable_find(node->tbl, name);
+	if (!o)
+		return -ENOENT;
+
+	xc = calloc(1, sizeof(*xc));
+	if (!xc)
+		return -ENOMEM;
+
+	xc->argbuf = xbuf_alloc(node, o->arglen + node->tr->buffer_overhead);
+	if (!xc->argbuf) {
+		free(xc);
+		return -ENOMEM;
+	}
+
+	va_start(ap, arg);
+	aura_serialize_into(xc->argbuf, o->arg_plan, ap);
+	va_end(ap);
+
+	xc->node = node;
+	xc->object = o;
+	xc->tbl = node->tbl;
+	xc->cq = cq;
+	xc->arg = arg;
+
+	ret = xring_push(ring, xc);
+	if (ret != 0) {
+		free(xc->argbuf);
+		free(xc);
+		return ret;
+	}
+
+	/* Only the first call since the last drain has to wake the loop up */
+	if (!atomic_exchange(&ring->wakeup_pending, 1))
+		loop->module->wakeup(loop);
+
+	return 0;
+}
+
+/**
+ * Free a completed call along with its response buffer.
+ *
+ * @param xc
+ */
+void aura_xcall_release(struct aura_xcall *xc)
+{
+	free(xc->retbuf);
+	free(xc);
+}
+
+/**
+ * Create a completion queue. Normally each thread that submits calls has its own one.
+ *
+ * @return pointer to the queue or NULL
+ */
+struct aura_xcall_cq *aura_xcall_cq_create(void)
+{
+	struct aura_xcall_cq *cq = calloc(1, sizeof(*cq));
+
+	if (!cq)
+		return NULL;
+
+	pthread_mutex_init(&cq->lock, NULL);
+	pthread_cond_init(&cq->cond, NULL);
+	INIT_LIST_HEAD(&cq->done);
+	return cq;
+}
+
+/**
+ * Destroy a completion queue, releasing any calls that have not been fetched.
+ * No calls delivered to this queue may be in flight.
+ *
+ * @param cq
+ */
+void aura_xcall_cq_destroy(struct aura_xcall_cq *cq)
+{
+	struct aura_xcall *pos, *tmp;
+
+	list_for_each_entry_safe(pos, tmp, &cq->done, qentry)
+		aura_xcall_release(pos);
+
+	pthread_cond_destroy(&cq->cond);
+	pthread_mutex_destroy(&cq->lock);
+	free(cq);
+}
+
+/**
+ * Fetch the next completed call from the queue, waiting up to timeout_ms
+ * milliseconds for one to arrive.
+ *
+ * @param cq
+ * @param timeout_ms 0 to return immediately, negative to wait forever
+ * @return completed call or NULL if timed out
+ */
+struct aura_xcall *aura_xcall_cq_wait(struct aura_xcall_cq *cq, int timeout_ms)
+{
+	struct aura_xcall *xc = NULL;
+	struct timespec ts;
+
+	if (timeout_ms > 0) {
+		clock_gettime(CLOCK_REALTIME, &ts);
+		ts.tv_sec += timeout_ms / 1000;
+		ts.tv_nsec += (timeout_ms % 1000) * 1000000;
+		if (ts.tv_nsec >= 1000000000) {
+			ts.tv_sec++;
+			ts.tv_nsec -= 1000000000;
+		}
+	}
+
+	pthread_mutex_lock(&cq->lock);
+	while (list_empty(&cq->done)) {
+		if (timeout_ms == 0)
+			goto bailout;
+		if (timeout_ms < 0)
+			pthread_cond_wait(&cq->cond, &cq->lock);
+		else if ((pthread_cond_timedwait(&cq->cond, &cq->lock, &ts) == ETIMEDOUT) &&
+			 list_empty(&cq->done))
+			goto bailout;
+	}
+	xc = list_entry(cq->done.next, struct aura_xcall, qentry);
+	list_del(&xc->qentry);
+bailout:
+	pthread_mutex_unlock(&cq->lock);
+	return xc;
+}
+
+/**
+ * @}
+ */
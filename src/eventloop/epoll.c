@@ -20,6 +20,8 @@ struct aura_epoll_loop {
 	struct aura_pollfds	evtfd;
 	int			exit_after_ms;
 	struct timespec		ts_deadline;
+	/* evtfd is also used for cross-thread wakeups, tell them apart */
+	bool			loopbreak_pending;
 };
 
 static int lepoll_create(struct aura_eventloop *loop)
@@ -161,11 +163,16 @@ static void lepoll_dispatch(struct aura_eventloop *loop, int flags)
 				if (ret != sizeof(uint64_t))
 					BUG(NULL, "Error reading from eventfd descriptor ");
 
-				/* We've been interrupted via loopbreak. Should we break? */
-				if (!lp->exit_after_ms)
-					break;
-				/* Or just adjust our timeout ? */
-				timeout_ms = lp->exit_after_ms;
+				aura_eventloop_process_wakeup(loop);
+
+				if (lp->loopbreak_pending) {
+					lp->loopbreak_pending = false;
+					/* We've been interrupted via loopbreak. Should we break? */
+					if (!lp->exit_after_ms)
+						break;
+					/* Or just adjust our timeout ? */
+					timeout_ms = lp->exit_after_ms;
+				}
 			} else if (ap->eventsysdata != NULL) {
 				/* This must be a timer! Only timers have eventsysdata set here */
 				struct aura_timerfd_timer *ftm = ap->eventsysdata;
@@ -210,8 +217,17 @@ static void lepoll_loopbreak(struct aura_eventloop *loop, struct timeval *tv)
 	lp->exit_after_ms = timeout_ms;
 	lp->ts_deadline = clk_get();
 	lp->ts_deadline = clk_add_ms(lp->ts_deadline, timeout_ms);
+	lp->loopbreak_pending = true;
+
+	uint64_t tmp = 1;
+	write(lp->evtfd.fd, &tmp, sizeof(uint64_t));
+}
 
+static void lepoll_wakeup(struct aura_eventloop *loop)
+{
+	struct aura_epoll_loop *lp = aura_eventloop_moduledata_get(loop);
 	uint64_t tmp = 1;
+
 	write(lp->evtfd.fd, &tmp, sizeof(uint64_t));
 }
 
@@ -289,6 +305,7 @@ static struct aura_eventloop_module lepoll =
 	.fd_action	= lepoll_fd_action,
 	.dispatch	= lepoll_dispatch,
 	.loopbreak	= lepoll_loopbreak,
+	.wakeup		= lepoll_wakeup,
 	.node_added	= lepoll_node_added,
 	.node_removed	= lepoll_node_removed,
 };
@@ -1,32 +1,90 @@
 #include <stdlib.h>
+#include <unistd.h>
+#include <sys/eventfd.h>
+/* libevent's own LIST_HEAD() clashes with ours. It undefines it when done, so include it first */
+#include <event.h>
 #include <aura/aura.h>
 #include <aura/private.h>
 #include <aura/eventloop.h>
 #include <aura/list.h>
 #include <aura/timer.h>
-#include <event.h>
 
 struct aura_libevent_timer {
 	struct aura_timer	timer;
 	struct event		evt;
 };
 
+struct aura_libevent_loop {
+	struct event_base *	ebase;
+	/* Cross-thread wakeups */
+	int			evtfd;
+	struct event *		wakeup_evt;
+};
+
+static struct event_base *loop_ebase(struct aura_eventloop *loop)
+{
+	struct aura_libevent_loop *lp = aura_eventloop_moduledata_get(loop);
+
+	return lp->ebase;
+}
+
+static void wakeup_cb_fn(evutil_socket_t fd, short evt, void *arg)
+{
+	struct aura_eventloop *loop = arg;
+	uint64_t tmp;
+
+	if (read(fd, &tmp, sizeof(tmp)) != sizeof(tmp))
+		BUG(NULL, "Error reading from eventfd descriptor");
+	aura_eventloop_process_wakeup(loop);
+}
+
 static int libevent_create(struct aura_eventloop *loop)
 {
+	int ret = -ENOMEM;
+	struct aura_libevent_loop *lp;
+
 	slog(3, SLOG_WARN, "evtsys-libevent: Using experimental libevent backend");
-	struct event_base *ebase = event_base_new();
-	if (!ebase)
+	lp = calloc(1, sizeof(*lp));
+	if (!lp)
 		return -ENOMEM;
 
-	aura_eventloop_moduledata_set(loop, ebase);
+	lp->ebase = event_base_new();
+	if (!lp->ebase)
+		goto err_free_lp;
+
+	lp->evtfd = eventfd(0, EFD_NONBLOCK);
+	if (lp->evtfd == -1) {
+		ret = -EFAULT;
+		goto err_free_base;
+	}
+
+	lp->wakeup_evt = event_new(lp->ebase, lp->evtfd, EV_READ | EV_PERSIST,
+				   wakeup_cb_fn, loop);
+	if (!lp->wakeup_evt)
+		goto err_close_fd;
+	event_add(lp->wakeup_evt, NULL);
+
+	aura_eventloop_moduledata_set(loop, lp);
 	return 0;
+
+err_close_fd:
+	close(lp->evtfd);
+err_free_base:
+	event_base_free(lp->ebase);
+err_free_lp:
+	free(lp);
+	return ret;
 }
 
 void libevent_destroy(struct aura_eventloop *loop)
 {
-	struct event_base *ebase = aura_eventloop_moduledata_get(loop);
+	struct aura_libevent_loop *lp = aura_eventloop_moduledata_get(loop);
 
-	event_base_free(ebase);
+	event_free(lp->wakeup_evt);
+	close(lp->evtfd);
+	event_base_free(lp->ebase);
+	free(lp);
+	aura_eventloop_moduledata_set(loop, NULL);
 }
 
 static void dispatch_cb_fn(evutil_socket_t fd, short evt, void *arg)
@@ -42,7 +100,7 @@ static void libevent_fd_action(
 {
 	struct aura_pollfds *ap = (struct aura_pollfds *)app;
 	struct aura_node *node = ap->node;
-	struct event_base *ebase = aura_eventloop_moduledata_get(loop);
+	struct event_base *ebase = loop_ebase(loop);
 
 	if (action == AURA_FD_ADDED) {
 		ap->magic = 0xdeadbeaf;
@@ -70,7 +128,7 @@ static void libevent_fd_action(
 
 static void libevent_dispatch(struct aura_eventloop *loop, int flags)
 {
-	struct event_base *ebase = aura_eventloop_moduledata_get(loop);
+	struct event_base *ebase = loop_ebase(loop);
 	int libevent_flags = 0;
 
 	if (flags & AURA_EVTLOOP_NONBLOCK)
@@ -84,12 +142,20 @@ static void libevent_dispatch(struct aura_eventloop *loop, int flags)
 
 static void libevent_loopbreak(struct aura_eventloop *loop, struct timeval *tv)
 {
-	struct event_base *ebase = aura_eventloop_moduledata_get(loop);
+	struct event_base *ebase = loop_ebase(loop);
 
 	if (0 != event_base_loopexit(ebase, tv))
 		BUG(NULL, "event_base_loopexit() failed!");
 }
 
+static void libevent_wakeup(struct aura_eventloop *loop)
+{
+	struct aura_libevent_loop *lp = aura_eventloop_moduledata_get(loop);
+	uint64_t tmp = 1;
+
+	write(lp->evtfd, &tmp, sizeof(uint64_t));
+}
+
 static void libevent_node_added(struct aura_eventloop *loop, struct aura_node *node)
 {
 	/* Nothing to do here */
@@ -116,7 +182,7 @@ static void timer_dispatch_fn(int fd, short events, void *arg)
 static void libevent_timer_start(struct aura_eventloop *loop, struct aura_timer *tm)
 {
 	struct aura_libevent_timer *ltm;
-	struct event_base *ebase = aura_eventloop_moduledata_get(loop);
+	struct event_base *ebase = loop_ebase(loop);
 
 	ltm = container_of(tm, struct aura_libevent_timer, timer);
 	int flags = 0;
@@ -152,6 +218,7 @@ static struct aura_eventloop_module levt =
 	.fd_action	= libevent_fd_action,
 	.dispatch	= libevent_dispatch,
 	.loopbreak	= libevent_loopbreak,
+	.wakeup		= libevent_wakeup,
 	.node_added	= libevent_node_added,
 	.node_removed	= libevent_node_removed,
 };
@@ -206,176 +206,281 @@ static int lua_push_etable(lua_State *L, struct aura_export_table *tbl)
 	return 1;
 }
 
+static double array_get_elem(const struct aura_fmt_op *op, const void *array, int i)
+{
+	switch (op->elem) {
+	case URPC_U8:
+		return ((const uint8_t *)array)[i];
+	case URPC_S8:
+		return ((const int8_t *)array)[i];
+	case URPC_U16:
+		return ((const uint16_t *)array)[i];
+	case URPC_S16:
+		return ((const int16_t *)array)[i];
+	case URPC_U32:
+		return ((const uint32_t *)array)[i];
+	case URPC_S32:
+		return ((const int32_t *)array)[i];
+	case URPC_U64:
+		return ((const uint64_t *)array)[i];
+	default:
+		return ((const int64_t *)array)[i];
+	}
+}
+
+static void array_set_elem(const struct aura_fmt_op *op, void *array, int i, double v)
+{
+	switch (op->elem) {
+	case URPC_U8:
+		((uint8_t *)array)[i] = v;
+		break;
+	case URPC_S8:
+		((int8_t *)array)[i] = v;
+		break;
+	case URPC_U16:
+		((uint16_t *)array)[i] = v;
+		break;
+	case URPC_S16:
+		((int16_t *)array)[i] = v;
+		break;
+	case URPC_U32:
+		((uint32_t *)array)[i] = v;
+		break;
+	case URPC_S32:
+		((int32_t *)array)[i] = v;
+		break;
+	case URPC_U64:
+		((uint64_t *)array)[i] = v;
+		break;
+	default:
+		((int64_t *)array)[i] = v;
+		break;
+	}
+}
+
+/* Arrays are passed as plain lua tables */
+static void array_to_lua(lua_State *L, const struct aura_fmt_op *op, const void *array)
+{
+	int i;
+
+	lua_createtable(L, op->count, 0);
+	for (i = 0; i < op->count; i++) {
+		lua_pushnumber(L, array_get_elem(op, array, i));
+		lua_rawseti(L, -2, i + 1);
+	}
+}
+
+/* Returns the table at stackpos as an allocated host array or NULL */
+static void *lua_to_array(lua_State *L, struct aura_node *node, int stackpos, const struct aura_fmt_op *op)
+{
+	void *array;
+	int i;
+
+	if (!lua_istable(L, stackpos)) {
+		slog(0, SLOG_ERROR, "Expected a table for array argument #%d", stackpos);
+		return NULL;
+	}
+
+	/* Missing elements are zeroes */
+	array = calloc(op->count, op->size / op->count);
+	if (!array)
+		BUG(node, "FATAL: malloc() failed");
+	for (i = 0; i < op->count; i++) {
+		lua_rawgeti(L, stackpos, i + 1);
+		if (!lua_isnil(L, -1))
+			array_set_elem(op, array, i, lua_tonumber(L, -1));
+		lua_pop(L, 1);
+	}
+	return array;
+}
+
 static int buffer_to_lua(lua_State *L, struct aura_node *node, const struct aura_object *o, struct aura_buffer *buf)
 {
-	const char *fmt = o->ret_fmt;
-	int nargs = 0;
+	const struct aura_fmt_plan *plan = o->ret_plan;
+	char *data;
+	int i;
+
+	if (!plan)
+		return 0;
+
+	/* Unpack the whole response in one go, then walk the host copy */
+	data = malloc(plan->len);
+	if (!data)
+		BUG(node, "FATAL: malloc() failed");
+	aura_deserialize_flat(buf, plan, data);
 
-	while (*fmt) {
-		double tmp;
-		switch (*fmt++) {
+	for (i = 0; i < plan->num_ops; i++) {
+		const struct aura_fmt_op *op = &plan->ops[i];
+		const void *field = &data[op->offset];
+
+		switch (op->type) {
 		case URPC_U8:
-			tmp = aura_buffer_get_u8(buf);
-			lua_pushnumber(L, tmp);
+			lua_pushnumber(L, *(const uint8_t *)field);
 			break;
 		case URPC_S8:
-			tmp = aura_buffer_get_s8(buf);
-			lua_pushnumber(L, tmp);
+			lua_pushnumber(L, *(const int8_t *)field);
 			break;
 		case URPC_U16:
-			tmp = aura_buffer_get_u16(buf);
-			lua_pushnumber(L, tmp);
+			lua_pushnumber(L, *(const uint16_t *)field);
 			break;
 		case URPC_S16:
-			tmp = aura_buffer_get_s16(buf);
-			lua_pushnumber(L, tmp);
+			lua_pushnumber(L, *(const int16_t *)field);
 			break;
 		case URPC_U32:
-			tmp = aura_buffer_get_u32(buf);
-			lua_pushnumber(L, tmp);
+			lua_pushnumber(L, *(const uint32_t *)field);
 			break;
 		case URPC_S32:
-			tmp = aura_buffer_get_s32(buf);
-			lua_pushnumber(L, tmp);
+			lua_pushnumber(L, *(const int32_t *)field);
 			break;
 		case URPC_U64:
-			tmp = aura_buffer_get_u64(buf);
-			lua_pushnumber(L, tmp);
+			lua_pushnumber(L, *(const uint64_t *)field);
 			break;
 		case URPC_S64:
-			tmp = aura_buffer_get_s64(buf);
-			lua_pushnumber(L, tmp);
+			lua_pushnumber(L, *(const int64_t *)field);
+			break;
+		case URPC_F32:
+			lua_pushnumber(L, *(const float *)field);
+			break;
+		case URPC_F64:
+			lua_pushnumber(L, *(const double *)field);
 			break;
 		case URPC_BIN:
 		{
 			void *udata;
-			const void *srcdata;
-			int len = atoi(fmt);
 
-			if (len == 0)
-				BUG(node, "Internal deserilizer bug processing: %s", fmt);
-			udata = lua_newuserdata(L, len);
+			udata = lua_newuserdata(L, op->size);
 			if (!udata)
 				BUG(node, "Failed to allocate userdata");
-			srcdata = aura_buffer_get_bin(buf, len);
-			memcpy(udata, srcdata, len);
-			while (*fmt && (*fmt++ != '.'));
+			memcpy(udata, field, op->size);
 			break;
 		}
+		case URPC_ARRAY:
+			array_to_lua(L, op, field);
+			break;
+		case URPC_VBIN8:
+			lua_pushlstring(L, (const char *)field + 1, *(const uint8_t *)field);
+			break;
+		case URPC_VBIN16:
+			lua_pushlstring(L, (const char *)field + 2, *(const uint16_t *)field);
+			break;
 		default:
-			BUG(node, "Unexpected format token: %s", --fmt);
+			BUG(node, "Unexpected format token: %c", op->type);
 		}
-		nargs++;
 	}
-	;
 
-	return nargs;
+	free(data);
+	return plan->num_ops;
 }
 
 static struct aura_buffer *lua_to_buffer(lua_State *L, struct aura_node *node, int stackpos, struct aura_object *o)
 {
-	int i;
-	struct aura_buffer *buf;
-	const char *fmt;
+	struct aura_buffer *buf = NULL;
+	struct aura_value *args;
+	const struct aura_fmt_op *op;
+	int i, ret;
 
-	fmt = o->arg_fmt;
 	if (lua_gettop(L) - stackpos + 1 != o->num_args) {
 		slog(0, SLOG_ERROR, "Invalid argument count for %s: %d / %d",
 		     o->name, lua_gettop(L) - stackpos, o->num_args);
 		return NULL;
 	}
 
-	buf = aura_buffer_request(node, o->arglen);
-	if (!buf) {
-		slog(0, SLOG_ERROR, "Epic fail during buffer allocation");
-		return NULL;
+	if (!o->num_args) {
+		ret = aura_serialize_values(node, o->arg_plan, NULL, 0, &buf);
+		return ret ? NULL : buf;
 	}
 
-	/* Let's serialize the data, arguments are on the stack,
-	 * Starting from #3.
-	 */
+	args = calloc(o->num_args, sizeof(*args));
+	if (!args)
+		BUG(node, "FATAL: malloc() failed");
 
-	for (i = stackpos; i <= lua_gettop(L); i++) {
-		double tmp;
+	/* Arguments are on the stack starting from stackpos,
+	 * let the core do the serializing
+	 */
+	op = o->arg_plan->ops;
+	for (i = 0; i < o->num_args; i++, op++) {
+		struct aura_value *v = &args[i];
+		int pos = stackpos + i;
 
-		switch (*fmt++) {
+		v->type = op->type;
+		switch (op->type) {
 		case URPC_U8:
-			tmp = lua_tonumber(L, i);
-			aura_buffer_put_u8(buf, tmp);
+			v->u8 = lua_tonumber(L, pos);
 			break;
 		case URPC_S8:
-			tmp = lua_tonumber(L, i);
-			aura_buffer_put_s8(buf, tmp);
+			v->s8 = lua_tonumber(L, pos);
 			break;
 		case URPC_U16:
-			tmp = lua_tonumber(L, i);
-			aura_buffer_put_u16(buf, (uint16_t)tmp);
+			v->u16 = lua_tonumber(L, pos);
 			break;
 		case URPC_S16:
-			tmp = lua_tonumber(L, i);
-			aura_buffer_put_s16(buf, tmp);
+			v->s16 = lua_tonumber(L, pos);
 			break;
 		case URPC_U32:
-			tmp = lua_tonumber(L, i);
-			aura_buffer_put_u32(buf, tmp);
+			v->u32 = lua_tonumber(L, pos);
 			break;
 		case URPC_S32:
-			tmp = lua_tonumber(L, i);
-			aura_buffer_put_s32(buf, tmp);
+			v->s32 = lua_tonumber(L, pos);
+			break;
+		case URPC_U64:
+			v->u64 = lua_tonumber(L, pos);
 			break;
 		case URPC_S64:
-			tmp = lua_tonumber(L, i);
-			aura_buffer_put_s64(buf, tmp);
+			v->s64 = lua_tonumber(L, pos);
 			break;
-		case URPC_U64:
-			tmp = lua_tonumber(L, i);
-			aura_buffer_put_u64(buf, tmp);
+		case URPC_F32:
+			v->f32 = lua_tonumber(L, pos);
+			break;
+		case URPC_F64:
+			v->f64 = lua_tonumber(L, pos);
 			break;
 
-		/* Binary is the tricky part. String or usata? */
+		/* Binary is the tricky part. String or userdata? */
 		case URPC_BIN:
+		case URPC_VBIN8:
+		case URPC_VBIN16:
 		{
-			const char *srcbuf = NULL;
-			int len = 0;
-			int blen;
-			if (lua_isstring(L, i)) {
-				srcbuf = lua_tostring(L, i);
-				len = strlen(srcbuf);
-			} else if (lua_isuserdata(L, i)) {
-				srcbuf = lua_touserdata(L, i);
+			size_t len = 0;
+
+			if (lua_isstring(L, pos)) {
+				v->bin.ptr = (void *)lua_tolstring(L, pos, &len);
+			} else if ((op->type == URPC_BIN) && lua_isuserdata(L, pos)) {
+				/* That's what we return binary blocks as */
+				v->bin.ptr = lua_touserdata(L, pos);
+				len = op->size;
 			}
 
-			blen = atoi(fmt);
-
-			if (blen == 0) {
-				slog(0, SLOG_ERROR, "Internal serilizer bug processing: %s", fmt);
+			if (!v->bin.ptr) {
+				slog(0, SLOG_ERROR, "Expected a string for binary argument #%d", pos);
 				goto err;
 			}
 
-			if (!srcbuf) {
-				slog(0, SLOG_ERROR, "Internal bug fetching src pointer");
-				goto err;
-			}
-
-			if (blen < len)
-				len = blen;
-
-			aura_buffer_put_bin(buf, srcbuf, len);
-
-			while (*fmt && (*fmt++ != '.'));
-
+			/* Strings longer than the field are cut */
+			v->bin.len = min_t(size_t, len, URPC_IS_VBIN(op->type) ? op->count : op->size);
 			break;
 		}
+		case URPC_ARRAY:
+			v->bin.ptr = lua_to_array(L, node, pos, op);
+			if (!v->bin.ptr)
+				goto err;
+			v->bin.len = op->size;
+			break;
 		default:
-			BUG(node, "Unknown token: %c\n", *(--fmt));
+			BUG(node, "Unknown token: %c\n", op->type);
 			break;
 		}
 	}
 
-	return buf;
+	ret = aura_serialize_values(node, o->arg_plan, args, o->num_args, &buf);
+	if (ret)
+		slog(0, SLOG_ERROR, "Failed to serialize arguments of %s: %d", o->name, ret);
+
 err:
-	aura_buffer_release(buf);
-	return NULL;
+	for (i = 0; i < o->num_args; i++)
+		if (o->arg_plan->ops[i].type == URPC_ARRAY)
+			free(args[i].bin.ptr);
+	free(args);
+	return buf;
 }
 
 
@@ -0,0 +1,114 @@
+#include <aura/aura.h>
+#include <aura/eventloop.h>
+
+#define BURST 40
+
+static struct aura_buffer *bufs[BURST];
+
+static void burst(struct aura_node *n, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++)
+		bufs[i] = aura_buffer_request(n, 100);
+	for (i = 0; i < count; i++)
+		aura_buffer_release(bufs[i]);
+}
+
+static void expect(struct aura_node *n, int count, int working_set)
+{
+	struct aura_bufferpool_stats stats;
+
+	aura_bufferpool_get_stats(n, 100, &stats);
+	if ((stats.count != count) || (stats.working_set != working_set) || (stats.in_use != 0))
+		exit(1);
+}
+
+int main() {
+	struct aura_bufferpool_gc_params params = {
+		.period_ms	= 100000,
+		.idle_periods	= 2,
+		.decay_percent	= 50,
+	};
+	struct aura_bufferpool_stats stats;
+	struct aura_eventloop *loop;
+	int i;
+
+	slog_init(NULL, 18);
+
+	aura_bufferpool_global_enable(false);
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+	aura_bufferpool_gc(n, -1, 0);
+
+	if (aura_bufferpool_set_adaptive_gc(n, &params) != 0)
+		exit(1);
+
+	/* The working set follows a burst right away... */
+	burst(n, BURST);
+	aura_bufferpool_gc_tick(n);
+	expect(n, BURST, BURST);
+
+	/* ...and only shrinks after idle_periods of idleness, by decay_percent a time */
+	aura_bufferpool_gc_tick(n);
+	aura_bufferpool_gc_tick(n);
+	expect(n, BURST, BURST);
+	aura_bufferpool_gc_tick(n);
+	expect(n, BURST / 2, BURST / 2);
+
+	/* Another burst takes it back up */
+	burst(n, 30);
+	aura_bufferpool_get_stats(n, 100, &stats);
+	if ((stats.peak != 30) || (stats.count != 30))
+		exit(1);
+	aura_bufferpool_gc_tick(n);
+	expect(n, 30, 30);
+
+	/* Sustained idleness returns everything */
+	for (i = 0; i < 20; i++)
+		aura_bufferpool_gc_tick(n);
+	expect(n, 0, 0);
+
+	/* Buffers in use are not part of the surplus */
+	for (i = 0; i < 10; i++)
+		bufs[i] = aura_buffer_request(n, 100);
+	for (i = 0; i < 20; i++)
+		aura_bufferpool_gc_tick(n);
+	aura_bufferpool_get_stats(n, 100, &stats);
+	if ((stats.in_use != 10) || (stats.working_set != 10) || (stats.gc_threshold != 0))
+		exit(1);
+	for (i = 0; i < 10; i++)
+		aura_buffer_release(bufs[i]);
+	aura_bufferpool_get_stats(n, 100, &stats);
+	if (stats.count != 10)
+		exit(1);
+
+	/* The eventloop does the same on its own */
+	params.period_ms = 10;
+	params.idle_periods = 0;
+	params.decay_percent = 100;
+	if (aura_bufferpool_set_adaptive_gc(n, &params) != 0)
+		exit(1);
+	loop = aura_node_eventloop_get(n);
+	for (i = 0; i < 100; i++) {
+		aura_bufferpool_get_stats(n, 100, &stats);
+		if (!stats.count)
+			break;
+		aura_eventloop_dispatch(loop, AURA_EVTLOOP_ONCE);
+	}
+	expect(n, 0, 0);
+
+	params.decay_percent = 0;
+	if (aura_bufferpool_set_adaptive_gc(n, &params) != -EINVAL)
+		exit(1);
+
+	/* Back to the fixed threshold */
+	aura_bufferpool_set_adaptive_gc(n, NULL);
+	aura_bufferpool_get_stats(n, 100, &stats);
+	if (stats.gc_threshold != n->gc_threshold)
+		exit(1);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
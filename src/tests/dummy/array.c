@@ -0,0 +1,107 @@
+#include <aura/aura.h>
+
+#define NUM_SAMPLES 517
+
+static int16_t samples[NUM_SAMPLES];
+static uint64_t words[3] = { 0x0102030405060708ULL, 0xdeadbeefb00bf00dULL, 1 };
+static const char *bad_formats[] = { "a", "a0.", "a4-1.", "a7.", "a81073741824." };
+
+/* Compare the kernels against the scalar macros, odd counts exercise the tails */
+static void test_kernels(void)
+{
+	uint64_t src[67], dst[67];
+	int count, i;
+
+	for (i = 0; i < 67; i++)
+		src[i] = 0x0102030405060708ULL * (i + 1);
+
+	for (count = 0; count < 67; count++) {
+		aura_swap_array(dst, src, count, 8);
+		for (i = 0; i < count; i++)
+			if (dst[i] != __swap64(src[i]))
+				exit(1);
+
+		aura_swap_array(dst, src, count * 2, 4);
+		for (i = 0; i < count * 2; i++)
+			if (((uint32_t *)dst)[i] != __swap32(((uint32_t *)src)[i]))
+				exit(1);
+
+		aura_swap_array(dst, src, count * 4, 2);
+		for (i = 0; i < count * 4; i++)
+			if (((uint16_t *)dst)[i] != __swap16(((uint16_t *)src)[i]))
+				exit(1);
+	}
+
+	/* In place */
+	memcpy(dst, src, sizeof(src));
+	aura_swap_array(dst, dst, 67 * 4, 2);
+	for (i = 0; i < 67 * 4; i++)
+		if (((uint16_t *)dst)[i] != __swap16(((uint16_t *)src)[i]))
+			exit(1);
+}
+
+static void test_echo(struct aura_node *n)
+{
+	int16_t out[NUM_SAMPLES];
+	uint64_t outwords[3];
+	struct aura_buffer *retbuf;
+
+	if (aura_call(n, "echo_array", &retbuf, samples, words) != AURA_CALL_COMPLETED)
+		exit(1);
+
+	aura_buffer_get_array_s16(retbuf, out, NUM_SAMPLES);
+	aura_buffer_get_array_u64(retbuf, outwords, 3);
+	if (memcmp(out, samples, sizeof(samples)) || memcmp(outwords, words, sizeof(words)))
+		exit(1);
+	aura_buffer_release(retbuf);
+}
+
+int main() {
+	struct aura_buffer *buf;
+	const uint8_t *raw;
+	int valid, num_args;
+	char *str;
+	int i;
+
+	slog_init(NULL, 18);
+
+	for (i = 0; i < NUM_SAMPLES; i++)
+		samples[i] = i * 61 - 16000;
+
+	test_kernels();
+
+	str = aura_fmt_pretty_print("a7517.a43.", &valid, &num_args);
+	printf("Format:%s\n", str);
+	if (!valid || num_args != 2 || strcmp(str, " int16_t[517] uint64_t[3]") != 0)
+		exit(1);
+	free(str);
+
+	/* No element type, no elements or too many of them */
+	for (i = 0; i < sizeof(bad_formats) / sizeof(bad_formats[0]); i++) {
+		str = aura_fmt_pretty_print(bad_formats[i], &valid, &num_args);
+		if (valid)
+			exit(1);
+		free(str);
+	}
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	test_echo(n);
+
+	/* The node is big endian now, elements are swapped both ways */
+	aura_set_node_endian(n, AURA_ENDIAN_BIG);
+	test_echo(n);
+
+	/* ...and the payload holds them in node's byte order */
+	buf = aura_buffer_request(n, 4);
+	aura_buffer_put_array_u16(buf, (uint16_t *)"\x01\x02\x03\x04", 2);
+	raw = aura_buffer_payload_ptr(buf);
+	if (memcmp(raw, "\x02\x01\x04\x03", 4) != 0)
+		exit(1);
+	aura_buffer_release(buf);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
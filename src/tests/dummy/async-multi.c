@@ -0,0 +1,54 @@
+#include <aura/aura.h>
+
+#define NUM_CALLS 64
+
+static int numstarted = 0;
+static int numdone = 0;
+
+static void start_next(struct aura_node *dev);
+
+void calldonecb(struct aura_node *dev, int status, struct aura_buffer *retbuf, void *arg)
+{
+	uint16_t v = aura_buffer_get_u16(retbuf);
+
+	numdone++;
+	printf("Call done with result %d arg %lld value %d!\n", status, (long long unsigned int) arg, v);
+	if (status != AURA_CALL_COMPLETED)
+		exit(1);
+	if (v != (uint16_t)(uintptr_t) arg)
+		exit(1);
+
+	/* Issue two more calls to the same method while this one is still being handled */
+	start_next(dev);
+	start_next(dev);
+}
+
+static void start_next(struct aura_node *dev)
+{
+	int ret;
+
+	if (numstarted >= NUM_CALLS)
+		return;
+	numstarted++;
+	ret = aura_start_call(dev, "echo_u16", calldonecb, (void *)(uintptr_t) numstarted, numstarted);
+	if (ret != 0) {
+		printf("call %d failed to start: %s\n", numstarted, aura_node_call_strerror(ret));
+		exit(1);
+	}
+}
+
+int main() {
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	start_next(n);
+	while (numdone < NUM_CALLS)
+		aura_eventloop_dispatch(aura_node_eventloop_get(n), AURA_EVTLOOP_ONCE);
+
+	printf("%d calls done, closing the shop...\n", numdone);
+	aura_close(n);
+
+	return 0;
+}
@@ -0,0 +1,74 @@
+#include <aura/aura.h>
+
+#define MAX_QUEUED 8
+
+static int numcongested = 0;
+static int numdrained = 0;
+
+static void watermark_cb(struct aura_node *node, bool congested, void *arg)
+{
+	printf("Outbound queue %s\n", congested ? "congested" : "drained");
+	if (congested)
+		numcongested++;
+	else
+		numdrained++;
+}
+
+int main() {
+	struct aura_queue_stats st;
+	struct aura_buffer *retbuf;
+	int i, ret;
+
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	aura_set_outbound_limits(n, MAX_QUEUED, 0);
+	aura_outbound_watermark_cb(n, 75, 25, watermark_cb, NULL);
+
+	/* Batches hit the queue in one go. Fill it up to the limit */
+	struct aura_call_batch *batch = aura_call_batch_begin(n, NULL, NULL);
+	for (i = 0; i < MAX_QUEUED + 1; i++)
+		aura_call_batch_add(batch, "echo_u8", NULL, NULL, i);
+	if (aura_call_batch_submit(batch) != -EAGAIN)
+		exit(1);
+	aura_call_batch_discard(batch);
+
+	/* The dummy transport drains the queue right away, so nothing should stay queued */
+	for (i = 0; i < MAX_QUEUED * 4; i++) {
+		ret = aura_start_call(n, "echo_u8", NULL, NULL, i);
+		if (ret != 0)
+			exit(1);
+	}
+
+	/* Each call leaves the queue as soon as the transport picks it up */
+	aura_get_outbound_stats(n, &st, true);
+	printf("depth %d bytes %zu hwm %d/%zu\n", st.count, st.bytes, st.count_hwm, st.bytes_hwm);
+	if (st.count != 0 || st.count_hwm != 1)
+		exit(1);
+
+	/* Now a batch that fits exactly */
+	batch = aura_call_batch_begin(n, NULL, NULL);
+	for (i = 0; i < MAX_QUEUED; i++)
+		aura_call_batch_add(batch, "echo_u8", NULL, NULL, i);
+	if (aura_call_batch_submit(batch) != 0)
+		exit(1);
+
+	aura_get_outbound_stats(n, &st, false);
+	if (st.count != 0 || st.count_hwm != MAX_QUEUED)
+		exit(1);
+	if (numcongested != 1 || numdrained != 1)
+		exit(1);
+
+	/* Blocking mode doesn't get in the way when there's room */
+	aura_set_outbound_blocking(n, true);
+	ret = aura_call(n, "echo_u8", &retbuf, 5);
+	if (ret != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
@@ -0,0 +1,68 @@
+#include <aura/aura.h>
+
+#define NUM_CALLS 16
+#define BATCH_ARG (void *) 0xdeadf00d
+
+static int numdone = 0;
+static int numbatches = 0;
+
+void calldonecb(struct aura_node *dev, int status, struct aura_buffer *retbuf, void *arg)
+{
+	uint32_t v = aura_buffer_get_u32(retbuf);
+
+	numdone++;
+	printf("Call done with result %d arg %lld value %d!\n", status, (long long unsigned int) arg, v);
+	if (status != AURA_CALL_COMPLETED)
+		exit(1);
+	if (v != (uint32_t)(uintptr_t) arg)
+		exit(1);
+	/* The batch callback must fire only after all the calls are done */
+	if (numbatches)
+		exit(1);
+}
+
+void batchdonecb(struct aura_node *dev, int numfailed, void *arg)
+{
+	numbatches++;
+	printf("Batch done, %d calls failed\n", numfailed);
+	if (arg != BATCH_ARG)
+		exit(1);
+	if ((numfailed != 0) || (numdone != NUM_CALLS))
+		exit(1);
+}
+
+int main() {
+	slog_init(NULL, 18);
+
+	int i, ret;
+	struct aura_node *n = aura_open("dummy", NULL);
+	struct aura_call_batch *batch;
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	/* Discarding a batch shouldn't leak */
+	batch = aura_call_batch_begin(n, batchdonecb, BATCH_ARG);
+	aura_call_batch_add(batch, "echo_u32", calldonecb, (void *) 1, 1);
+	aura_call_batch_discard(batch);
+
+	batch = aura_call_batch_begin(n, batchdonecb, BATCH_ARG);
+	for (i = 0; i < NUM_CALLS; i++) {
+		ret = aura_call_batch_add(batch, "echo_u32", calldonecb, (void *)(uintptr_t)(i + 100), i + 100);
+		if (ret != 0)
+			return ret;
+	}
+
+	if (numdone)
+		BUG(n, "Batch calls started before submission");
+
+	ret = aura_call_batch_submit(batch);
+	if (ret != 0)
+		return ret;
+
+	while (!numbatches)
+		aura_eventloop_dispatch(aura_node_eventloop_get(n), AURA_EVTLOOP_ONCE);
+
+	printf("%d calls done in %d batch, closing the shop...\n", numdone, numbatches);
+	aura_close(n);
+
+	return 0;
+}
@@ -0,0 +1,94 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+
+#ifdef AURA_USE_BUFFER_POOL
+static void test_classes(struct aura_node *n)
+{
+	struct aura_bufferpool_stats small, big;
+	struct aura_buffer *a, *b;
+
+	/* A buffer is good for any request of its size class... */
+	a = aura_buffer_request(n, 1);
+	aura_buffer_release(a);
+	aura_bufferpool_get_stats(n, 1, &small);
+	b = aura_buffer_request(n, small.size - n->tr->buffer_overhead);
+	if ((a != b) || (b->size != small.size))
+		exit(1);
+	aura_buffer_release(b);
+
+	/* ...and never for a larger one, which doesn't take it from its class either */
+	b = aura_buffer_request(n, small.size);
+	if (a == b)
+		exit(1);
+	aura_bufferpool_get_stats(n, small.size, &big);
+	if ((big.size != 2 * small.size) || (big.misses != 1) || (big.hits != 0))
+		exit(1);
+	aura_buffer_release(b);
+
+	aura_bufferpool_get_stats(n, 1, &small);
+	if ((small.count != 1) || (small.hits != 1) || (small.misses != 1))
+		exit(1);
+	aura_bufferpool_get_stats(n, small.size, &big);
+	if (big.count != 1)
+		exit(1);
+
+	/* Too large to be pooled */
+	if (aura_bufferpool_get_stats(n, 1 << AURA_BUFFER_POOL_MAX_SHIFT, &big) != -ERANGE)
+		exit(1);
+	a = aura_buffer_request(n, 1 << AURA_BUFFER_POOL_MAX_SHIFT);
+	if (a->pool_class != -1)
+		exit(1);
+	aura_buffer_release(a);
+}
+
+static void test_gc(struct aura_node *n)
+{
+	struct aura_bufferpool_stats stats;
+
+	aura_bufferpool_preheat(n, 100, 20);
+	aura_bufferpool_preheat(n, 1000, 5);
+	aura_bufferpool_get_stats(n, 100, &stats);
+	if (stats.count != 20)
+		exit(1);
+
+	/* Each class keeps up to its own threshold */
+	if (aura_bufferpool_set_class_gc_threshold(n, 100, 3) != 0)
+		exit(1);
+	aura_node_buffer_pool_gc_full(n);
+	aura_bufferpool_get_stats(n, 100, &stats);
+	if ((stats.count != 3) || (stats.dropped != 17) || (stats.gc_threshold != 3))
+		exit(1);
+	aura_bufferpool_get_stats(n, 1000, &stats);
+	if (stats.count != 5)
+		exit(1);
+
+	/* One threshold for everyone, at most numdrop buffers at a time */
+	aura_bufferpool_gc(n, 2, 1);
+	aura_bufferpool_get_stats(n, 1000, &stats);
+	if (stats.count != 3)
+		exit(1);
+	aura_bufferpool_gc(n, -1, 0);
+	if (n->num_buffers_in_pool != 0)
+		exit(1);
+}
+#endif
+
+int main() {
+	slog_init(NULL, 18);
+
+	/* This is about node's own pool */
+	aura_bufferpool_global_enable(false);
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+#ifdef AURA_USE_BUFFER_POOL
+	/* Start from an empty pool */
+	aura_bufferpool_gc(n, -1, 0);
+	test_classes(n);
+	test_gc(n);
+#endif
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
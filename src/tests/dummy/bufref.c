@@ -0,0 +1,78 @@
+#include <aura/aura.h>
+
+#define NUM_EVENTS 4
+
+/* Two subscribers that keep every event they get */
+static struct aura_buffer *recorder[NUM_EVENTS];
+static struct aura_buffer *queue[NUM_EVENTS];
+static int numevt;
+
+void pingcb(struct aura_node *dev, int status, struct aura_buffer *retbuf, void *arg)
+{
+	recorder[numevt] = aura_buffer_ref(retbuf);
+	queue[numevt] = aura_buffer_ref(retbuf);
+	if (++numevt == NUM_EVENTS)
+		aura_eventloop_loopexit(aura_node_eventloop_get(dev), NULL);
+}
+
+static int in_use(struct aura_node *n, int size)
+{
+	struct aura_bufferpool_stats stats;
+
+	aura_bufferpool_get_stats(n, size, &stats);
+	return stats.in_use;
+}
+
+int main() {
+	struct aura_buffer *buf;
+	int i, base;
+
+	slog_init(NULL, 18);
+
+	aura_bufferpool_global_enable(false);
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+	base = in_use(n, 32);
+
+	/* Events outlive the callback and are not recycled under the holders' feet */
+	aura_set_event_callback(n, "ping", pingcb, NULL);
+	aura_eventloop_dispatch(aura_node_eventloop_get(n), 0);
+	aura_set_event_callback(n, "ping", NULL, NULL);
+	for (i = 0; i < NUM_EVENTS; i++) {
+		if ((recorder[i] != queue[i]) || (recorder[i]->refcount != 2))
+			exit(1);
+		if ((i > 0) && (recorder[i] == recorder[i - 1]))
+			exit(1);
+	}
+	if (in_use(n, 32) != base + NUM_EVENTS)
+		exit(1);
+
+	/* Each holder reads it on its own */
+	for (i = 0; i < NUM_EVENTS; i++) {
+		aura_buffer_rewind(recorder[i]);
+		if (aura_buffer_get_u8(recorder[i]) != 12)
+			exit(1);
+		aura_buffer_unref(recorder[i]);
+		if (in_use(n, 32) != base + NUM_EVENTS - i)
+			exit(1);
+		aura_buffer_rewind(queue[i]);
+		if (aura_buffer_get_u8(queue[i]) != 12)
+			exit(1);
+		aura_buffer_unref(queue[i]);
+	}
+	if (in_use(n, 32) != base)
+		exit(1);
+
+	/* Call results too */
+	if (aura_call(n, "echo_u16", &buf, 0x1234) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_ref(buf);
+	aura_buffer_release(buf);
+	if ((buf->refcount != 1) || (aura_buffer_get_u16(buf) != 0x1234))
+		exit(1);
+	aura_buffer_unref(buf);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
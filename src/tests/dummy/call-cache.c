@@ -0,0 +1,84 @@
+#include <aura/aura.h>
+
+static void call_u32(struct aura_node *n, uint32_t arg)
+{
+	struct aura_buffer *retbuf;
+	int ret;
+
+	ret = aura_call(n, "echo_u32", &retbuf, arg);
+	if (ret != AURA_CALL_COMPLETED)
+		exit(1);
+	if (aura_buffer_get_u32(retbuf) != arg)
+		exit(1);
+	aura_buffer_release(retbuf);
+}
+
+static void check_stats(struct aura_node *n, const char *name, uint64_t hits, uint64_t misses)
+{
+	struct aura_cache_stats st;
+
+	if (aura_get_cache_stats(n, name, &st) != 0)
+		exit(1);
+	printf("%s: %llu hits, %llu misses\n", name ? name : "node",
+	       (unsigned long long)st.hits, (unsigned long long)st.misses);
+	if (st.hits != hits || st.misses != misses)
+		exit(1);
+}
+
+int main() {
+	struct aura_buffer *retbuf;
+	int i;
+
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	if (aura_object_set_cache(n, "ping", 100) != -EBADF)
+		exit(1);
+	if (aura_object_set_cache(n, "nosuchmethod", 100) != -ENOENT)
+		exit(1);
+
+	/* Not cached yet */
+	call_u32(n, 1);
+	check_stats(n, NULL, 0, 0);
+
+	if (aura_object_set_cache(n, "echo_u32", 200) != 0)
+		exit(1);
+
+	/* Only the first call of each argument set goes to the node */
+	for (i = 0; i < 4; i++)
+		call_u32(n, 1);
+	call_u32(n, 2);
+	call_u32(n, 2);
+	check_stats(n, "echo_u32", 4, 2);
+
+	/* Other methods are not affected */
+	call_u32(n, 1);
+	if (aura_call(n, "echo_u8", &retbuf, 5) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_release(retbuf);
+	check_stats(n, NULL, 5, 2);
+
+	/* Explicit invalidation */
+	if (aura_cache_invalidate(n, "echo_u32") != 0)
+		exit(1);
+	call_u32(n, 1);
+	call_u32(n, 1);
+	check_stats(n, "echo_u32", 6, 3);
+
+	/* Responses expire. Sit in a call that is never answered meanwhile */
+	if (aura_call_timeout(n, "blackhole", 300, &retbuf, 1) != AURA_CALL_TIMEOUT)
+		exit(1);
+	call_u32(n, 1);
+	check_stats(n, "echo_u32", 6, 4);
+
+	/* Disabling the cache drops it */
+	aura_object_set_cache(n, "echo_u32", 0);
+	call_u32(n, 1);
+	check_stats(n, "echo_u32", 6, 4);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
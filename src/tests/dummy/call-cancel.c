@@ -0,0 +1,168 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+
+static struct aura_call_handle queued;
+static int numcancelled = -1;
+static int numcalled;
+
+static void never_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	printf("Callback of a cancelled call fired, status %d\n", status);
+	exit(1);
+}
+
+static void value_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	*(int *) arg = (status == AURA_CALL_COMPLETED) ? aura_buffer_get_u8(retbuf) : -1;
+}
+
+/* A response in a fresh buffer, the way most transports deliver them */
+static void late_reply(struct aura_node *n, uint8_t value, uint32_t tag)
+{
+	struct aura_buffer *buf = aura_buffer_request(n, 1);
+
+	buf->call_tag = tag;
+
+	buf->object = aura_etable_find(n->tbl, "blackhole");
+	aura_buffer_put_u8(buf, value);
+	aura_buffer_rewind(buf);
+	aura_node_write(n, buf);
+}
+
+static void counting_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	numcalled++;
+}
+
+/* Fires while the rest of the batch is still queued, so whatever we start now stays queued */
+static void first_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	struct aura_queue_stats st;
+	int ret;
+
+	ret = aura_start_call_handle(node, "echo_u16", &queued, never_cb, NULL, 0x1234);
+	if (ret != 0)
+		exit(1);
+
+	aura_get_outbound_stats(node, &st, false);
+	if (st.count != 4)
+		exit(1);
+
+	numcancelled = aura_call_cancel(&queued);
+
+	aura_get_outbound_stats(node, &st, false);
+	if (st.count != 3)
+		exit(1);
+}
+
+int main() {
+	struct aura_call_handle handle;
+	struct aura_buffer *retbuf;
+	int i, ret;
+
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	/* A call still in the outbound queue is dropped right away */
+	struct aura_call_batch *batch = aura_call_batch_begin(n, NULL, NULL);
+	aura_call_batch_add(batch, "echo_u8", first_cb, NULL, 1);
+	for (i = 0; i < 3; i++)
+		aura_call_batch_add(batch, "echo_u8", counting_cb, NULL, i);
+	if (aura_call_batch_submit(batch) != 0)
+		exit(1);
+	printf("Queued call cancelled: %d\n", numcancelled);
+	if (numcancelled != 1 || numcalled != 3)
+		exit(1);
+	if (aura_call_cancel(&queued) != -ENOENT)
+		exit(1);
+
+	/* Completed calls can't be cancelled */
+	ret = aura_start_call_handle(n, "echo_u8", &handle, counting_cb, NULL, 5);
+	if (ret != 0 || numcalled != 4)
+		exit(1);
+	if (aura_call_cancel(&handle) != -ENOENT)
+		exit(1);
+
+	/* The transport has taken this one, so it's marked and left pending */
+	aura_set_call_timeout(n, 100);
+	ret = aura_start_call_handle(n, "blackhole", &handle, never_cb, NULL, 5);
+	if (ret != 0)
+		exit(1);
+	if (aura_call_cancel(&handle) != 0)
+		exit(1);
+	if (aura_call_cancel(&handle) != -ENOENT)
+		exit(1);
+
+	/* ...and released quietly once its deadline passes while we wait for another one */
+	aura_set_call_timeout(n, 0);
+	ret = aura_call_timeout(n, "blackhole", 300, &retbuf, 5);
+	if (ret != AURA_CALL_TIMEOUT)
+		exit(1);
+
+	ret = aura_call(n, "echo_u8", &retbuf, 5);
+	if (ret != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	/* Late replies to both blackhole calls above don't complete the next one */
+	int value = 0;
+	ret = aura_start_call(n, "blackhole", value_cb, &value, 5);
+	if (ret != 0)
+		exit(1);
+	late_reply(n, 0x11, 0);
+	late_reply(n, 0x22, 0);
+	if (value != 0)
+		exit(1);
+	late_reply(n, 0x33, 0);
+	printf("Got 0x%x\n", value);
+	if (value != 0x33)
+		exit(1);
+
+	/* A tagged reply tells that the ones before it won't come anymore */
+	struct aura_object *o = aura_etable_find(n->tbl, "blackhole");
+	ret = aura_call_timeout(n, "blackhole", 10, &retbuf, 5);
+	if (ret != AURA_CALL_TIMEOUT || o->pending != 1)
+		exit(1);
+	ret = aura_start_call_handle(n, "blackhole", &handle, value_cb, &value, 5);
+	if (ret != 0 || o->pending != 2)
+		exit(1);
+	late_reply(n, 0x44, handle.tag);
+	if (value != 0x44 || o->pending != 0)
+		exit(1);
+
+	/*
+	 * The reply to a timed-out call never comes, and the stale slot takes the
+	 * untagged one of the next call. That one times out then, but the call
+	 * after it gets its own reply.
+	 */
+	ret = aura_call_timeout(n, "blackhole", 10, &retbuf, 5);
+	if (ret != AURA_CALL_TIMEOUT || o->pending != 1)
+		exit(1);
+	value = 0;
+	aura_set_call_timeout(n, 20);
+	ret = aura_start_call(n, "blackhole", value_cb, &value, 5);
+	if (ret != 0)
+		exit(1);
+	late_reply(n, 0x55, 0);
+	if (value != 0)
+		exit(1);
+	while (value != -1)
+		aura_eventloop_dispatch(aura_node_eventloop_get(n), AURA_EVTLOOP_ONCE);
+	if (o->pending != 0)
+		exit(1);
+
+	aura_set_call_timeout(n, 0);
+	ret = aura_start_call(n, "blackhole", value_cb, &value, 5);
+	if (ret != 0)
+		exit(1);
+	late_reply(n, 0x66, 0);
+	printf("Got 0x%x\n", value);
+	if (value != 0x66 || o->pending != 0)
+		exit(1);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
@@ -0,0 +1,89 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+
+static int numdone = 0;
+static int numtimedout = 0;
+
+void calldonecb(struct aura_node *dev, int status, struct aura_buffer *retbuf, void *arg)
+{
+	printf("Call done with result %d arg %lld\n", status, (long long unsigned int) arg);
+	numdone++;
+	if (status == AURA_CALL_TIMEOUT)
+		numtimedout++;
+}
+
+static void value_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	*(int *) arg = (status == AURA_CALL_COMPLETED) ? aura_buffer_get_u8(retbuf) : -1;
+}
+
+/* A response in a fresh buffer, the way most transports deliver them */
+static void untagged_reply(struct aura_node *n, uint8_t value)
+{
+	struct aura_buffer *buf = aura_buffer_request(n, 1);
+
+	buf->object = aura_etable_find(n->tbl, "blackhole");
+	aura_buffer_put_u8(buf, value);
+	aura_buffer_rewind(buf);
+	aura_node_write(n, buf);
+}
+
+int main() {
+	struct aura_buffer *retbuf = NULL;
+	int ret;
+
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	/* A call that is answered in time */
+	ret = aura_call_timeout(n, "echo_u8", 100, &retbuf, 5);
+	if (ret != AURA_CALL_COMPLETED || aura_buffer_get_u8(retbuf) != 5)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	/* A call that is never answered */
+	ret = aura_call_timeout(n, "blackhole", 100, &retbuf, 5);
+	printf("Blackhole call returned %d\n", ret);
+	if (ret != AURA_CALL_TIMEOUT)
+		exit(1);
+
+	/* Async calls with per-call and default deadlines, expiring out of order */
+	aura_set_call_timeout(n, 50);
+	aura_start_call_deadline(n, "blackhole", 150, calldonecb, (void *) 1, 1);
+	aura_start_call(n, "blackhole", calldonecb, (void *) 2, 2);
+	aura_start_call(n, "echo_u8", calldonecb, (void *) 3, 3);
+	while (numdone < 3)
+		aura_eventloop_dispatch(aura_node_eventloop_get(n), AURA_EVTLOOP_ONCE);
+
+	if (numtimedout != 2)
+		exit(1);
+
+	/* Late responses that never come are only waited for so long */
+	struct aura_object *o = aura_etable_find(n->tbl, "blackhole");
+	int i, value = 0;
+
+	aura_set_late_response_window(n, 100);
+	for (i = 0; i < 10; i++)
+		if (aura_call_timeout(n, "blackhole", 10, &retbuf, 5) != AURA_CALL_TIMEOUT)
+			exit(1);
+	printf("Stale slots: %d\n", o->pending);
+	if (!o->pending)
+		exit(1);
+	while (o->pending)
+		aura_eventloop_dispatch(aura_node_eventloop_get(n), AURA_EVTLOOP_ONCE);
+
+	/* ...and the next call gets its own response */
+	aura_set_call_timeout(n, 0);
+	if (aura_start_call(n, "blackhole", value_cb, &value, 5) != 0)
+		exit(1);
+	untagged_reply(n, 0x42);
+	if (value != 0x42 || o->pending)
+		exit(1);
+
+	printf("%d calls done, %d timed out, closing the shop...\n", numdone, numtimedout);
+	aura_close(n);
+
+	return 0;
+}
@@ -0,0 +1,97 @@
+#include <aura/aura.h>
+
+static int numcalled;
+static struct aura_future *future;
+
+static void echo_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	if (status != AURA_CALL_COMPLETED)
+		exit(1);
+	if (aura_buffer_get_u32(retbuf) != (uint32_t)(uintptr_t)arg)
+		exit(1);
+	numcalled++;
+}
+
+static void never_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	printf("Callback of a cancelled call fired\n");
+	exit(1);
+}
+
+static int queued(struct aura_node *node)
+{
+	struct aura_queue_stats st;
+
+	aura_get_outbound_stats(node, &st, false);
+	return st.count;
+}
+
+/* Fires while the rest of the batch is still queued, so whatever we start now stays queued */
+static void first_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	struct aura_call_handle handle;
+	int depth = queued(node);
+	int i;
+
+	for (i = 0; i < 4; i++)
+		if (aura_start_call(node, "echo_u32", echo_cb, (void *) 7, 7) != 0)
+			exit(1);
+	future = aura_call_async(node, "echo_u32", 7);
+	if (aura_start_call_handle(node, "echo_u32", &handle, never_cb, NULL, 7) != 0)
+		exit(1);
+	if (aura_call_cancel(&handle) != 0)
+		exit(1);
+
+	/* Different arguments, different request */
+	if (aura_start_call(node, "echo_u32", echo_cb, (void *) 8, 8) != 0)
+		exit(1);
+
+	printf("%d requests queued for 7 calls\n", queued(node) - depth);
+	if (queued(node) - depth != 2)
+		exit(1);
+}
+
+int main() {
+	struct aura_buffer *retbuf;
+	int i;
+
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	if (aura_object_set_coalescing(n, "ping", true) != -EBADF)
+		exit(1);
+	if (aura_object_set_coalescing(n, "echo_u32", true) != 0)
+		exit(1);
+
+	struct aura_call_batch *batch = aura_call_batch_begin(n, NULL, NULL);
+	aura_call_batch_add(batch, "echo_u8", first_cb, NULL, 1);
+	for (i = 0; i < 3; i++)
+		aura_call_batch_add(batch, "echo_u8", NULL, NULL, i);
+	if (aura_call_batch_submit(batch) != 0)
+		exit(1);
+
+	printf("%d callbacks fired\n", numcalled);
+	if (numcalled != 5)
+		exit(1);
+
+	if (aura_future_wait(future, 1000) != 0)
+		exit(1);
+	if (aura_future_status(future) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (aura_buffer_get_u32(aura_future_retbuf(future)) != 7)
+		exit(1);
+	aura_future_release(future);
+
+	/* Nothing in flight, nothing to join */
+	if (aura_call(n, "echo_u32", &retbuf, 9) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (aura_buffer_get_u32(retbuf) != 9)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
@@ -0,0 +1,79 @@
+#include <aura/aura.h>
+#include "dummy-stubs.h"
+
+static const char longstr[] = "Only as long as it needs to be, not 1024 bytes";
+
+static void run_all(struct aura_node *n)
+{
+	uint32_t a;
+	uint16_t b, v;
+	uint8_t c;
+	char out0[32], out1[1024];
+	int len0, len1;
+	float f;
+	double d;
+	int16_t samples[517], outsamples[517];
+	uint64_t words[3] = { 1, 2, 0x0102030405060708ULL }, outwords[3];
+	int i;
+
+	if (dummy_echo_seq(n, 0xdeadb00b, 0xdead, 0xde, &a, &b, &c) != AURA_CALL_COMPLETED)
+		exit(1);
+	if ((a != 0xdeadb00b) || (b != 0xdead) || (c != 0xde))
+		exit(1);
+
+	if (dummy_echo_vbin(n, "hi", 2, 0xbeef, longstr, sizeof(longstr),
+			    out0, &len0, &v, out1, &len1) != AURA_CALL_COMPLETED)
+		exit(1);
+	if ((len0 != 2) || memcmp(out0, "hi", 2) || (v != 0xbeef))
+		exit(1);
+	if ((len1 != sizeof(longstr)) || memcmp(out1, longstr, len1))
+		exit(1);
+	if (dummy_echo_vbin(n, longstr, 33, 1, longstr, 0, NULL, NULL, NULL, NULL, NULL) != -E2BIG)
+		exit(1);
+
+	if (dummy_echo_float(n, -0.5f, 1.0e-300, &f, &d) != AURA_CALL_COMPLETED)
+		exit(1);
+	if ((f != -0.5f) || (d != 1.0e-300))
+		exit(1);
+
+	for (i = 0; i < 517; i++)
+		samples[i] = i * 3 - 700;
+	if (dummy_echo_array(n, samples, words, outsamples, outwords) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (memcmp(samples, outsamples, sizeof(samples)) || memcmp(words, outwords, sizeof(words)))
+		exit(1);
+
+	/* Return values can be dropped */
+	if (dummy_echo_array(n, samples, words, NULL, NULL) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (dummy_noargs_func(n) != AURA_CALL_COMPLETED)
+		exit(1);
+}
+
+int main() {
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	if (!dummy_etable_matches(n))
+		exit(1);
+	if ((aura_etable_find(n->tbl, "echo_seq")->id != DUMMY_ECHO_SEQ_ID) ||
+	    (aura_etable_find(n->tbl, "ping")->id != DUMMY_PING_ID))
+		exit(1);
+
+	run_all(n);
+
+	aura_set_node_endian(n, AURA_ENDIAN_BIG);
+	run_all(n);
+
+	/* Stubs refuse to talk to a node with a different export table */
+	n->tbl->fingerprint ^= 1;
+	if (dummy_echo_seq(n, 1, 2, 3, NULL, NULL, NULL) != -ESTALE)
+		exit(1);
+	n->tbl->fingerprint ^= 1;
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
@@ -0,0 +1,54 @@
+#include <aura/aura.h>
+
+static void test_echo(struct aura_node *n)
+{
+	AURA_DECLARE_CACHED_ID(float_id, n, "echo_float");
+	struct aura_buffer *retbuf, *buf;
+	float f;
+	double d;
+
+	/* float arguments are promoted to double, which is fine */
+	if (aura_call_raw(n, float_id, &retbuf, 3.25f, -1.0e100) != AURA_CALL_COMPLETED)
+		exit(1);
+	if ((aura_buffer_get_f32(retbuf) != 3.25f) || (aura_buffer_get_f64(retbuf) != -1.0e100))
+		exit(1);
+
+	aura_buffer_rewind(retbuf);
+	aura_buffer_unpack(retbuf, &f, &d);
+	if ((f != 3.25f) || (d != -1.0e100))
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	/* Same bits on the wire as the integer of the same size */
+	buf = aura_buffer_request(n, 4);
+	aura_buffer_put_f32(buf, 1.0f);
+	aura_buffer_rewind(buf);
+	if (aura_buffer_get_u32(buf) != 0x3f800000)
+		exit(1);
+	aura_buffer_release(buf);
+}
+
+int main() {
+	int valid, num_args;
+	char *str;
+
+	slog_init(NULL, 18);
+
+	str = aura_fmt_pretty_print("fd", &valid, &num_args);
+	printf("Format:%s\n", str);
+	if (!valid || num_args != 2 || strcmp(str, " float double") != 0)
+		exit(1);
+	free(str);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	test_echo(n);
+
+	aura_set_node_endian(n, AURA_ENDIAN_BIG);
+	test_echo(n);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
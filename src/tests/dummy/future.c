@@ -0,0 +1,64 @@
+#include <aura/aura.h>
+
+#define NUM_CALLS 32
+
+int main() {
+	struct aura_future *futures[NUM_CALLS];
+	struct aura_node *n[2];
+	struct aura_eventloop *loop;
+	int i, ret;
+
+	slog_init(NULL, 18);
+
+	n[0] = aura_open("dummy", NULL);
+	n[1] = aura_open("dummy", NULL);
+	loop = aura_eventloop_create(n[0], n[1]);
+	for (i = 0; i < 2; i++)
+		if (aura_get_status(n[i]) != AURA_STATUS_ONLINE)
+			aura_wait_status(n[i], AURA_STATUS_ONLINE);
+
+	/* Run the same thing twice, the second pass reuses pooled futures */
+	int pass;
+	for (pass = 0; pass < 2; pass++) {
+		for (i = 0; i < NUM_CALLS; i++)
+			futures[i] = aura_call_async(n[i & 1], "echo_u32", 0x1000 * pass + i);
+
+		if (aura_future_wait_all(futures, NUM_CALLS, 1000))
+			exit(1);
+
+		for (i = 0; i < NUM_CALLS; i++) {
+			if (aura_future_status(futures[i]) != AURA_CALL_COMPLETED)
+				exit(1);
+			if (aura_buffer_get_u32(aura_future_retbuf(futures[i])) != 0x1000 * pass + i)
+				exit(1);
+			aura_future_release(futures[i]);
+		}
+	}
+
+	/* Errors are reported via the future */
+	futures[0] = aura_call_async(n[0], "no_such_method");
+	if (!aura_future_done(futures[0]) || aura_future_status(futures[0]) != -ENOENT)
+		exit(1);
+	aura_future_release(futures[0]);
+
+	/* A call that never completes and one that does */
+	futures[0] = aura_call_async(n[0], "blackhole", 1);
+	futures[1] = aura_call_async(n[1], "echo_u8", 2);
+	ret = aura_future_wait_any(futures, 2, 1000);
+	printf("wait_any returned %d\n", ret);
+	if (ret != 1)
+		exit(1);
+	aura_future_release(futures[1]);
+
+	if (aura_future_wait(futures[0], 100) != -ETIMEDOUT)
+		exit(1);
+	/* Released before completion, recycled when the node is closed */
+	aura_future_release(futures[0]);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n[0]);
+	aura_close(n[1]);
+	aura_eventloop_destroy(loop);
+
+	return 0;
+}
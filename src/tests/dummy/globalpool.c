@@ -0,0 +1,85 @@
+#include <aura/aura.h>
+#include <aura/buffer_allocator.h>
+#include <pthread.h>
+
+#define NUM_BUFS 100
+
+static struct aura_buffer *bufs[NUM_BUFS];
+
+static void *release_all(void *arg)
+{
+	int i;
+
+	for (i = 0; i < NUM_BUFS; i++)
+		aura_buffer_release(bufs[i]);
+	return NULL;
+}
+
+int main() {
+	struct aura_bufferpool_stats stats;
+	struct aura_node *a, *b;
+	struct aura_buffer *buf;
+	pthread_t thread;
+	int i, size;
+
+	slog_init(NULL, 18);
+
+	/* Only nodes using malloc() share the pool */
+	aura_buffer_allocator_select(NULL);
+	aura_bufferpool_global_enable(true);
+	a = aura_open("dummy", NULL);
+	b = aura_open("dummy", NULL);
+	aura_wait_status(a, AURA_STATUS_ONLINE);
+	aura_wait_status(b, AURA_STATUS_ONLINE);
+
+	/* What one node releases, the other one gets */
+	buf = aura_buffer_request(a, 100);
+	aura_buffer_release(buf);
+	if (aura_buffer_request(b, 90) != buf)
+		exit(1);
+	if ((buf->owner != b) || (a->num_buffers_in_pool != 0))
+		exit(1);
+	aura_buffer_release(buf);
+	aura_bufferpool_get_stats(b, 90, &stats);
+	if (stats.hits != 1)
+		exit(1);
+
+	/* Calls work as usual */
+	if (aura_call(a, "echo_u16", &buf, 0x1234) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (aura_buffer_get_u16(buf) != 0x1234)
+		exit(1);
+	aura_buffer_release(buf);
+
+	/* Buffers released by a thread that is gone end up in the depot, up to the limit */
+	size = 200 + a->tr->buffer_overhead;
+	aura_bufferpool_global_set_limit(48);
+	for (i = 0; i < NUM_BUFS; i++)
+		bufs[i] = aura_buffer_request(a, 200);
+	pthread_create(&thread, NULL, release_all, NULL);
+	pthread_join(thread, NULL);
+
+	aura_bufferpool_global_get_stats(size, &stats);
+	if ((stats.count > 48) || (stats.count == 0) || (stats.count + stats.dropped != NUM_BUFS))
+		exit(1);
+
+	for (i = 0; i < stats.count; i++)
+		bufs[i] = aura_buffer_request(b, 200);
+	aura_bufferpool_get_stats(b, 200, &stats);
+	if (stats.misses != 0)
+		exit(1);
+	for (i = 0; i < stats.hits; i++)
+		aura_buffer_release(bufs[i]);
+
+	aura_bufferpool_global_drain();
+	aura_bufferpool_global_get_stats(size, &stats);
+	if (stats.count != 0)
+		exit(1);
+	if (aura_bufferpool_global_get_stats((1 << AURA_BUFFER_POOL_MAX_SHIFT) + 1, &stats) != -ERANGE)
+		exit(1);
+
+	printf("All done, closing the shop...\n");
+	aura_close(a);
+	aura_close(b);
+	return 0;
+}
@@ -0,0 +1,91 @@
+#include <aura/aura.h>
+#include <aura/hugepage_buffer_allocator.h>
+
+static void check_calls(struct aura_node *n)
+{
+	struct aura_buffer *buf;
+
+	if (aura_call(n, "echo_u16", &buf, 0x1234) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (aura_buffer_get_u16(buf) != 0x1234)
+		exit(1);
+	aura_buffer_release(buf);
+}
+
+int main() {
+	struct aura_hugepage_allocator_stats stats;
+	struct aura_buffer *bufs[64], *big;
+	struct aura_node *n, *m;
+	size_t mapped;
+	int i;
+
+	slog_init(NULL, 18);
+
+	aura_buffer_allocator_select(NULL);
+	n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+	if (aura_hugepage_allocator_get_stats(n, &stats) != -EINVAL)
+		exit(1);
+
+	if (aura_node_set_buffer_allocator(n, "no-such-allocator") != -ENOENT)
+		exit(1);
+	if (aura_node_set_buffer_allocator(n, "hugepage") != 0)
+		exit(1);
+	check_calls(n);
+
+	/* Small buffers come from the slabs, 64 of them don't take a whole region */
+	for (i = 0; i < 64; i++) {
+		bufs[i] = aura_buffer_request(n, 100 * i);
+		if ((uintptr_t) bufs[i]->data % 64)
+			exit(1);
+		memset(bufs[i]->data, i, bufs[i]->size);
+	}
+	aura_hugepage_allocator_get_stats(n, &stats);
+	if ((stats.regions != 1) || (stats.buffers < 64) || stats.locked)
+		exit(1);
+	mapped = stats.mapped;
+
+	/* A large one gets a mapping of its own, which goes away with it */
+	big = aura_buffer_request(n, AURA_HUGEPAGE_REGION_SIZE);
+	memset(big->data, 0xff, big->size);
+	aura_hugepage_allocator_get_stats(n, &stats);
+	if (stats.mapped < mapped + AURA_HUGEPAGE_REGION_SIZE)
+		exit(1);
+
+	/* No switching allocators while their buffers are out */
+	if (aura_node_set_buffer_allocator(n, NULL) != -EBUSY)
+		exit(1);
+	aura_buffer_release(big);
+	aura_hugepage_allocator_get_stats(n, &stats);
+	if (stats.mapped != mapped)
+		exit(1);
+	for (i = 0; i < 64; i++)
+		aura_buffer_release(bufs[i]);
+
+	/* Nodes opened after the selection get it */
+	if (aura_buffer_allocator_select("hugepage-locked") != 0)
+		exit(1);
+	m = aura_open("dummy", NULL);
+	aura_wait_status(m, AURA_STATUS_ONLINE);
+	aura_buffer_allocator_select(NULL);
+	if (aura_hugepage_allocator_get_stats(m, &stats) != 0)
+		exit(1);
+	check_calls(m);
+	/* Only if mlock() succeeded, which RLIMIT_MEMLOCK may not allow */
+	aura_hugepage_allocator_get_stats(m, &stats);
+	if (stats.locked && !stats.regions)
+		exit(1);
+	printf("Locked: %d\n", stats.locked);
+	aura_close(m);
+
+	/* And back to malloc() */
+	if (aura_node_set_buffer_allocator(n, "malloc") != 0)
+		exit(1);
+	if (aura_hugepage_allocator_get_stats(n, &stats) != -EINVAL)
+		exit(1);
+	check_calls(n);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
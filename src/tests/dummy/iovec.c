@@ -0,0 +1,82 @@
+#include <aura/aura.h>
+#include <sys/uio.h>
+
+static char chunk0[32] = "referenced, not copied";
+static char chunk1[32] = "neither is this one";
+static int numreleased;
+static int numcalled;
+
+static void release_cb(const void *data, void *arg)
+{
+	if (data != arg)
+		exit(1);
+	numreleased++;
+}
+
+static void echo_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	const char *out;
+
+	if (status != AURA_CALL_COMPLETED)
+		exit(1);
+	out = aura_buffer_get_bin(retbuf, 32);
+	if (memcmp(out, chunk0, 32) != 0)
+		exit(1);
+	out = aura_buffer_get_bin(retbuf, 32);
+	if (memcmp(out, chunk1, 32) != 0)
+		exit(1);
+	numcalled++;
+}
+
+int main() {
+	struct aura_buffer *buf;
+	struct iovec iov[4];
+	int ret;
+
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	AURA_DECLARE_CACHED_ID(echo_id, n, "echo_bin");
+	AURA_DECLARE_CACHED_ID(u8_id, n, "echo_u8");
+
+	/* The data stays where it is until somebody has to copy it */
+	buf = aura_buffer_request(n, 64);
+	aura_buffer_put_iov(buf, chunk0, 32, release_cb, chunk0);
+	aura_buffer_put_bin(buf, chunk1, 32);
+	if (aura_buffer_iovec(buf, iov, 4) != 3)
+		exit(1);
+	if ((iov[1].iov_base != chunk0) || (iov[1].iov_len != 32))
+		exit(1);
+	if (iov[2].iov_len != 32 || memcmp(iov[2].iov_base, chunk1, 32) != 0)
+		exit(1);
+	if (numreleased != 0)
+		exit(1);
+
+	/* Argument mismatch */
+	if (aura_queue_call(n, u8_id, echo_cb, NULL, buf) != -EINVAL)
+		exit(1);
+
+	/* The dummy transport can't do vectored I/O, so the data is copied once it's sent */
+	ret = aura_queue_call(n, echo_id, echo_cb, NULL, buf);
+	if (ret != 0)
+		exit(1);
+	printf("%d called, %d released\n", numcalled, numreleased);
+	if (numcalled != 1 || numreleased != 1)
+		exit(1);
+
+	/* Releasing the buffer releases the references */
+	buf = aura_buffer_request(n, 64);
+	aura_buffer_put_iov(buf, chunk0, 32, release_cb, chunk0);
+	aura_buffer_put_iov(buf, chunk1, 32, release_cb, chunk1);
+	if (aura_buffer_iovec(buf, iov, 1) != 3)
+		exit(1);
+	aura_buffer_release(buf);
+	if (numreleased != 3)
+		exit(1);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
@@ -0,0 +1,76 @@
+#include <aura/aura.h>
+
+#define NUM_NODES 6
+#define NUM_LOOPS 3
+
+static void call_node(struct aura_node *n, struct aura_xcall_cq *cq, uint32_t v)
+{
+	struct aura_xcall *xc;
+	int ret;
+
+	ret = aura_xcall_submit(n, "echo_u32", cq, NULL, v);
+	if (ret != 0) {
+		printf("submit failed: %d\n", ret);
+		exit(1);
+	}
+
+	xc = aura_xcall_cq_wait(cq, 5000);
+	if (!xc || (xc->status != AURA_CALL_COMPLETED))
+		exit(1);
+	if (aura_buffer_get_u32(xc->retbuf) != v)
+		exit(1);
+	aura_xcall_release(xc);
+}
+
+int main() {
+	struct aura_node *nodes[NUM_NODES];
+	struct aura_looppool *pool;
+	struct aura_xcall_cq *cq;
+	int i;
+
+	slog_init(NULL, 18);
+
+	pool = aura_looppool_create(NUM_LOOPS, NULL, AURA_LOOPPOOL_LEAST_LOADED);
+	if (!pool)
+		exit(1);
+	cq = aura_xcall_cq_create();
+
+	for (i = 0; i < NUM_NODES; i++) {
+		nodes[i] = aura_open("dummy", NULL);
+		aura_wait_status(nodes[i], AURA_STATUS_ONLINE);
+		aura_looppool_add(pool, nodes[i], NULL);
+	}
+
+	for (i = 0; i < NUM_LOOPS; i++)
+		if (aura_looppool_load(pool, i) != NUM_NODES / NUM_LOOPS)
+			exit(1);
+
+	for (i = 0; i < NUM_NODES; i++)
+		call_node(nodes[i], cq, 0xdead0000 + i);
+
+	/* Move the first node around the pool, checking it still works */
+	for (i = 0; i < NUM_LOOPS; i++) {
+		if (aura_looppool_migrate(pool, nodes[0], i))
+			exit(1);
+		if (aura_looppool_node_index(pool, nodes[0]) != i)
+			exit(1);
+		call_node(nodes[0], cq, 0xbeef0000 + i);
+	}
+
+	/* Take one node back and use it from this thread */
+	aura_looppool_del(pool, nodes[1]);
+	struct aura_buffer *retbuf;
+	if (aura_call(nodes[1], "echo_u8", &retbuf, 5) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_release(retbuf);
+	aura_close(nodes[1]);
+
+	for (i = 2; i < NUM_NODES; i++)
+		aura_looppool_close(pool, nodes[i]);
+	aura_looppool_close(pool, nodes[0]);
+
+	aura_xcall_cq_destroy(cq);
+	aura_looppool_destroy(pool);
+	printf("All done, closing the shop...\n");
+	return 0;
+}
@@ -0,0 +1,128 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+
+#define NUM_CALLS 6
+
+static char order[NUM_CALLS * 2 + 1];
+static int numdone;
+
+static void calldone_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	if (status != AURA_CALL_COMPLETED)
+		exit(1);
+	order[numdone++] = (char)(uintptr_t)arg;
+}
+
+/* Batches hit the queue in one go, so the transport sees all the calls at once */
+static void run_batch(struct aura_node *n, const char *expected)
+{
+	struct aura_call_batch *batch = aura_call_batch_begin(n, NULL, NULL);
+	int i;
+
+	for (i = 0; i < NUM_CALLS; i++)
+		aura_call_batch_add(batch, "echo_u8", calldone_cb, (void *)'B', i);
+	for (i = 0; i < NUM_CALLS; i++)
+		aura_call_batch_add(batch, "echo_u16", calldone_cb, (void *)'R', i);
+
+	numdone = 0;
+	memset(order, 0, sizeof(order));
+	if (aura_call_batch_submit(batch) != 0)
+		exit(1);
+
+	printf("Completion order: %s\n", order);
+	if (strcmp(order, expected) != 0)
+		exit(1);
+}
+
+static int bulk_value, rt_value;
+
+static void value_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	*(int *) arg = (status == AURA_CALL_COMPLETED) ? aura_buffer_get_u8(retbuf) : -1;
+}
+
+/* Fires while the rest of the batch is queued, so the two calls below are sent in priority order */
+static void interleave_cb(struct aura_node *node, int status, struct aura_buffer *retbuf, void *arg)
+{
+	if (aura_start_call_prio(node, "blackhole", AURA_CALL_PRIO_BULK, value_cb, &bulk_value, 1) ||
+	    aura_start_call_prio(node, "blackhole", AURA_CALL_PRIO_REALTIME, value_cb, &rt_value, 2))
+		exit(1);
+}
+
+/* A response in a fresh buffer, the way most transports deliver them */
+static void untagged_reply(struct aura_node *n, uint8_t value)
+{
+	struct aura_buffer *buf = aura_buffer_request(n, 1);
+
+	buf->object = aura_etable_find(n->tbl, "blackhole");
+	aura_buffer_put_u8(buf, value);
+	aura_buffer_rewind(buf);
+	aura_node_write(n, buf);
+}
+
+/* Untagged responses go to calls in the order they were sent, not started */
+static void test_untagged(struct aura_node *n)
+{
+	struct aura_call_batch *batch = aura_call_batch_begin(n, NULL, NULL);
+	int i;
+
+	aura_call_batch_add(batch, "echo_u32", interleave_cb, NULL, 0);
+	for (i = 0; i < 3; i++)
+		aura_call_batch_add(batch, "echo_u32", NULL, NULL, i);
+	if (aura_call_batch_submit(batch) != 0)
+		exit(1);
+
+	untagged_reply(n, 0x22);
+	if (rt_value != 0x22 || bulk_value != 0)
+		exit(1);
+	untagged_reply(n, 0x11);
+	if (bulk_value != 0x11)
+		exit(1);
+}
+
+int main() {
+	struct aura_buffer *retbuf;
+	int ret;
+
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	if (aura_object_set_priority(n, "echo_u8", AURA_CALL_PRIO_BULK) != 0)
+		exit(1);
+	if (aura_object_set_priority(n, "echo_u16", AURA_CALL_PRIO_REALTIME) != 0)
+		exit(1);
+	if (aura_object_set_priority(n, "nosuchobject", AURA_CALL_PRIO_BULK) != -ENOENT)
+		exit(1);
+	if (aura_object_set_priority(n, "echo_u8", AURA_CALL_PRIO_COUNT) != -EINVAL)
+		exit(1);
+
+	/* Strict priority order */
+	aura_set_outbound_starve_limit(n, 0);
+	run_batch(n, "RRRRRRBBBBBB");
+
+	/* Bulk calls get their turn after being passed over twice */
+	aura_set_outbound_starve_limit(n, 2);
+	run_batch(n, "RRBRRBRRBBBB");
+
+	/* Per-call override */
+	numdone = 0;
+	ret = aura_start_call_prio(n, "echo_u8", AURA_CALL_PRIO_REALTIME, calldone_cb, (void *)'R', 1);
+	if (ret != 0 || numdone != 1)
+		exit(1);
+	if (aura_start_call_prio(n, "echo_u8", 42, calldone_cb, NULL, 1) != -EINVAL)
+		exit(1);
+
+	test_untagged(n);
+
+	/* Synchronous calls are not affected */
+	ret = aura_call(n, "echo_u8", &retbuf, 5);
+	if (ret != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
@@ -82,6 +82,31 @@ void test_bin_32_32(struct aura_node *n )
 	aura_buffer_release(retbuf);
 }
 
+/* The format string flavour compiles the format on the fly */
+static struct aura_buffer *serialize_fmt(struct aura_node *n, const char *fmt, ...)
+{
+	struct aura_buffer *buf;
+	va_list ap;
+
+	va_start(ap, fmt);
+	buf = aura_serialize(n, fmt, 0, ap);
+	va_end(ap);
+	return buf;
+}
+
+void test_serialize_fmt(struct aura_node *n)
+{
+	slog(0, SLOG_INFO, __FUNCTION__);
+	struct aura_buffer *buf = serialize_fmt(n, "321", 0xdeadb00b, 0xdead, 0xde);
+
+	if (buf->payload_size != 7)
+		BUG(n, "Unexpected payload size");
+	aura_buffer_rewind(buf);
+	if ((aura_buffer_get_u32(buf) != 0xdeadb00b) || (aura_buffer_get_u16(buf) != 0xdead) ||
+	    (aura_buffer_get_u8(buf) != 0xde))
+		BUG(n, "Unexpected data from buffer");
+	aura_buffer_release(buf);
+}
 
 int main() {
 	slog_init(NULL, 18);
@@ -92,6 +117,7 @@ int main() {
 	test_u32(n);
 	test_seq(n);
 	test_bin_32_32(n);
+	test_serialize_fmt(n);
 	aura_close(n);
 
 	return 0;
@@ -0,0 +1,98 @@
+#include <aura/aura.h>
+#include <stddef.h>
+
+struct __attribute__((packed)) seq_packed {
+	uint32_t	a;
+	uint16_t	b;
+	uint8_t		c;
+};
+
+/* Same fields, different order and padding */
+struct seq_native {
+	uint8_t		c;
+	uint16_t	b;
+	uint32_t	a;
+};
+
+static const size_t seq_offsets[] = {
+	offsetof(struct seq_native, a),
+	offsetof(struct seq_native, b),
+	offsetof(struct seq_native, c),
+};
+
+struct samples {
+	int16_t		s[517];
+	uint64_t	w[3];
+};
+
+static const size_t samples_offsets[] = {
+	offsetof(struct samples, s),
+	offsetof(struct samples, w),
+};
+
+static void run_all(struct aura_node *n)
+{
+	AURA_DECLARE_CACHED_ID(seq_id, n, "echo_seq");
+	AURA_DECLARE_CACHED_ID(array_id, n, "echo_array");
+	struct seq_packed pin = { 0xdeadb00b, 0xdead, 0xde }, pout;
+	struct seq_native nin = { 0x12, 0x3456, 0x789abcde }, nout;
+	static struct samples sin, sout;
+	int i;
+
+	/* Packed structs need no declaration, NULL gets back to that */
+	if (aura_object_set_struct_layout(n, "echo_seq", NULL, NULL) != 0)
+		exit(1);
+	if (aura_call_struct(n, seq_id, NULL, &pout) != -EINVAL)
+		exit(1);
+	memset(&pout, 0, sizeof(pout));
+	if (aura_call_struct(n, seq_id, &pin, &pout) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (memcmp(&pin, &pout, sizeof(pin)) != 0)
+		exit(1);
+
+	if (aura_object_set_struct_layout(n, "echo_seq", seq_offsets, seq_offsets) != 0)
+		exit(1);
+	memset(&nout, 0, sizeof(nout));
+	if (aura_call_struct(n, seq_id, &nin, &nout) != AURA_CALL_COMPLETED)
+		exit(1);
+	if ((nout.a != nin.a) || (nout.b != nin.b) || (nout.c != nin.c))
+		exit(1);
+
+	for (i = 0; i < 517; i++)
+		sin.s[i] = i * 7 - 100;
+	sin.w[0] = 1;
+	sin.w[2] = 0x0102030405060708ULL;
+	if (aura_object_set_struct_layout(n, "echo_array", samples_offsets, samples_offsets) != 0)
+		exit(1);
+	if (aura_call_struct(n, array_id, &sin, &sout) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (memcmp(sin.s, sout.s, sizeof(sin.s)) || memcmp(sin.w, sout.w, sizeof(sin.w)))
+		exit(1);
+
+	/* Return values can be dropped */
+	if (aura_call_struct(n, array_id, &sin, NULL) != AURA_CALL_COMPLETED)
+		exit(1);
+}
+
+int main() {
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	if (aura_object_set_struct_layout(n, "nosuchmethod", NULL, NULL) != -ENOENT)
+		exit(1);
+	if (aura_object_set_struct_layout(n, "echo_buf", NULL, NULL) != -EINVAL)
+		exit(1);
+	if (aura_call_struct(n, 4242, NULL, NULL) != -EBADSLT)
+		exit(1);
+
+	run_all(n);
+
+	aura_set_node_endian(n, AURA_ENDIAN_BIG);
+	run_all(n);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
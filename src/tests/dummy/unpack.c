@@ -0,0 +1,94 @@
+#include <aura/aura.h>
+
+static void test_seq(struct aura_node *n)
+{
+	struct aura_buffer *retbuf;
+	uint32_t out32;
+	uint16_t out16;
+	uint8_t out8;
+
+	if (aura_call(n, "echo_seq", &retbuf, 0xdeadb00b, 0xdead, 0xde) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_unpack(retbuf, &out32, &out16, &out8);
+	if ((out32 != 0xdeadb00b) || (out16 != 0xdead) || (out8 != 0xde))
+		exit(1);
+	aura_buffer_release(retbuf);
+}
+
+static void test_signed(struct aura_node *n)
+{
+	struct aura_buffer *retbuf;
+	int16_t out16;
+	int64_t out64;
+
+	if (aura_call(n, "echo_i16", &retbuf, -1234) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_unpack(retbuf, &out16);
+	if (out16 != -1234)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	if (aura_call(n, "echo_i64", &retbuf, (int64_t)-5000000000LL) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_unpack(retbuf, &out64);
+	if (out64 != -5000000000LL)
+		exit(1);
+	aura_buffer_release(retbuf);
+}
+
+static void test_bin(struct aura_node *n)
+{
+	char src0[32] = "first", src1[32] = "second";
+	char dst0[32], dst1[32];
+	struct aura_buffer *retbuf;
+
+	if (aura_call(n, "echo_bin", &retbuf, src0, src1) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_unpack(retbuf, dst0, dst1);
+	if (memcmp(src0, dst0, 32) || memcmp(src1, dst1, 32))
+		exit(1);
+	aura_buffer_release(retbuf);
+}
+
+static void test_array(struct aura_node *n)
+{
+	int16_t samples[517], out[517];
+	uint64_t words[3] = { 1, 2, 0x0102030405060708ULL }, outwords[3];
+	struct aura_buffer *retbuf;
+	int i;
+
+	for (i = 0; i < 517; i++)
+		samples[i] = -i;
+
+	if (aura_call(n, "echo_array", &retbuf, samples, words) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_unpack(retbuf, out, outwords);
+	if (memcmp(out, samples, sizeof(out)) || memcmp(outwords, words, sizeof(words)))
+		exit(1);
+	aura_buffer_release(retbuf);
+}
+
+static void run_all(struct aura_node *n)
+{
+	test_seq(n);
+	test_signed(n);
+	test_bin(n);
+	test_array(n);
+}
+
+int main() {
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	run_all(n);
+
+	/* Same thing with byte-swapping on the way out and back in */
+	aura_set_node_endian(n, AURA_ENDIAN_BIG);
+	run_all(n);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
@@ -0,0 +1,157 @@
+#include <aura/aura.h>
+
+static void test_seq(struct aura_node *n)
+{
+	AURA_DECLARE_CACHED_ID(seq_id, n, "echo_seq");
+	struct aura_value args[3], rets[3];
+
+	args[0].type = URPC_U32;
+	args[0].u32 = 0xdeadb00b;
+	args[1].type = URPC_U16;
+	args[1].u16 = 0xdead;
+	args[2].type = URPC_U8;
+	args[2].u8 = 0xde;
+
+	memset(rets, 0, sizeof(rets));
+	if (aura_call_values(n, seq_id, args, 3, rets) != AURA_CALL_COMPLETED)
+		exit(1);
+	if ((rets[0].type != URPC_U32) || (rets[1].type != URPC_U16) || (rets[2].type != URPC_U8))
+		exit(1);
+	if ((rets[0].u32 != 0xdeadb00b) || (rets[1].u16 != 0xdead) || (rets[2].u8 != 0xde))
+		exit(1);
+
+	/* Wrong count, wrong type */
+	if (aura_call_values(n, seq_id, args, 2, rets) != -EINVAL)
+		exit(1);
+	args[2].type = URPC_S8;
+	if (aura_call_values(n, seq_id, args, 3, rets) != -EINVAL)
+		exit(1);
+}
+
+static void test_binary(struct aura_node *n)
+{
+	AURA_DECLARE_CACHED_ID(vbin_id, n, "echo_vbin");
+	AURA_DECLARE_CACHED_ID(bin_id, n, "echo_bin");
+	AURA_DECLARE_CACHED_ID(array_id, n, "echo_array");
+	static char big[2048];
+	struct aura_value args[3], rets[3];
+	char out0[32], out1[1024];
+	int16_t samples[517], outsamples[517];
+	uint64_t words[3] = { 1, 2, 3 };
+	int i;
+
+	args[0].type = URPC_VBIN8;
+	args[0].bin.ptr = "hello";
+	args[0].bin.len = 5;
+	args[1].type = URPC_U16;
+	args[1].u16 = 0x1234;
+	args[2].type = URPC_VBIN16;
+	args[2].bin.ptr = big;
+	args[2].bin.len = 1000;
+	memset(big, 0x5a, sizeof(big));
+
+	rets[0].bin.ptr = out0;
+	rets[2].bin.ptr = out1;
+	if (aura_call_values(n, vbin_id, args, 3, rets) != AURA_CALL_COMPLETED)
+		exit(1);
+	if ((rets[0].bin.len != 5) || memcmp(out0, "hello", 5) || (rets[1].u16 != 0x1234))
+		exit(1);
+	if ((rets[2].bin.len != 1000) || memcmp(out1, big, 1000))
+		exit(1);
+
+	/* Fields the caller doesn't want are skipped */
+	rets[0].bin.ptr = NULL;
+	rets[2].bin.ptr = NULL;
+	if (aura_call_values(n, vbin_id, args, 3, rets) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (rets[1].u16 != 0x1234)
+		exit(1);
+
+	args[2].bin.len = 1025;
+	if (aura_call_values(n, vbin_id, args, 3, rets) != -E2BIG)
+		exit(1);
+
+	/* Shorter fixed-size blocks are padded */
+	args[0].type = URPC_BIN;
+	args[0].bin.ptr = "short";
+	args[0].bin.len = 5;
+	args[1].type = URPC_BIN;
+	args[1].bin.ptr = big;
+	args[1].bin.len = 32;
+	rets[0].bin.ptr = out0;
+	rets[1].bin.ptr = out1;
+	if (aura_call_values(n, bin_id, args, 2, rets) != AURA_CALL_COMPLETED)
+		exit(1);
+	if ((rets[0].bin.len != 32) || memcmp(out0, "short", 5) || (out0[5] != 0) || (out0[31] != 0))
+		exit(1);
+	if (memcmp(out1, big, 32))
+		exit(1);
+
+	for (i = 0; i < 517; i++)
+		samples[i] = i - 300;
+	args[0].type = URPC_ARRAY;
+	args[0].bin.ptr = samples;
+	args[0].bin.len = sizeof(samples);
+	args[1].type = URPC_ARRAY;
+	args[1].bin.ptr = words;
+	args[1].bin.len = sizeof(words) - 1;
+	if (aura_call_values(n, array_id, args, 2, rets) != -EINVAL)
+		exit(1);
+	args[1].bin.len = sizeof(words);
+	rets[0].bin.ptr = outsamples;
+	rets[1].bin.ptr = out1;
+	if (aura_call_values(n, array_id, args, 2, rets) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (memcmp(samples, outsamples, sizeof(samples)) || memcmp(words, out1, sizeof(words)))
+		exit(1);
+}
+
+static void test_float(struct aura_node *n)
+{
+	AURA_DECLARE_CACHED_ID(float_id, n, "echo_float");
+	struct aura_value args[2], rets[2];
+
+	args[0].type = URPC_F32;
+	args[0].f32 = -0.5f;
+	args[1].type = URPC_F64;
+	args[1].f64 = 1.0e-300;
+	if (aura_call_values(n, float_id, args, 2, rets) != AURA_CALL_COMPLETED)
+		exit(1);
+	if ((rets[0].f32 != -0.5f) || (rets[1].f64 != 1.0e-300))
+		exit(1);
+
+	/* Return values can be dropped */
+	if (aura_call_values(n, float_id, args, 2, NULL) != AURA_CALL_COMPLETED)
+		exit(1);
+}
+
+static void run_all(struct aura_node *n)
+{
+	AURA_DECLARE_CACHED_ID(noargs_id, n, "noargs_func");
+
+	test_seq(n);
+	test_binary(n);
+	test_float(n);
+
+	if (aura_call_values(n, noargs_id, NULL, 0, NULL) != AURA_CALL_COMPLETED)
+		exit(1);
+}
+
+int main() {
+	slog_init(NULL, 18);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	if (aura_call_values(n, 4242, NULL, 0, NULL) != -EBADSLT)
+		exit(1);
+
+	run_all(n);
+
+	aura_set_node_endian(n, AURA_ENDIAN_BIG);
+	run_all(n);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
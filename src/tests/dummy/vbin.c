@@ -0,0 +1,143 @@
+#include <aura/aura.h>
+#include <aura/private.h>
+
+static const char shortstr[] = "hi";
+static const char longstr[] = "Only as long as it needs to be, not 1024 bytes";
+
+static void test_echo(struct aura_node *n)
+{
+	AURA_DECLARE_CACHED_ID(vbin_id, n, "echo_vbin");
+	struct aura_buffer *retbuf;
+	char out0[32], out1[1024];
+	const char *p;
+	int len0, len1;
+	uint16_t v;
+
+	if (aura_call_raw(n, vbin_id, &retbuf, shortstr, 2, 0xbeef, longstr, (int)sizeof(longstr)) !=
+	    AURA_CALL_COMPLETED)
+		exit(1);
+
+	/* The message only takes the prefixes and the actual data */
+	if (retbuf->payload_size != 1 + 2 + 2 + 2 + (int)sizeof(longstr))
+		exit(1);
+
+	aura_buffer_unpack(retbuf, out0, &len0, &v, out1, &len1);
+	if ((len0 != 2) || memcmp(out0, shortstr, 2) || (v != 0xbeef))
+		exit(1);
+	if ((len1 != sizeof(longstr)) || memcmp(out1, longstr, len1))
+		exit(1);
+
+	/* Same thing, field by field */
+	aura_buffer_rewind(retbuf);
+	p = aura_buffer_get_vbin8(retbuf, &len0);
+	if ((len0 != 2) || memcmp(p, shortstr, 2))
+		exit(1);
+	if (aura_buffer_get_u16(retbuf) != 0xbeef)
+		exit(1);
+	p = aura_buffer_get_vbin16(retbuf, &len1);
+	if ((len1 != sizeof(longstr)) || memcmp(p, longstr, len1))
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	/* Empty is fine, too long is not */
+	if (aura_call_raw(n, vbin_id, &retbuf, shortstr, 0, 1, longstr, 0) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (retbuf->payload_size != 1 + 2 + 2)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	if (aura_call_raw(n, vbin_id, &retbuf, longstr, 33, 1, longstr, 0) != -ENODATA)
+		exit(1);
+}
+
+/* Calls that only differ in the length of the arguments must not share cached responses */
+static void test_cache(struct aura_node *n)
+{
+	AURA_DECLARE_CACHED_ID(vbin_id, n, "echo_vbin");
+	struct aura_cache_stats stats;
+	struct aura_buffer *retbuf;
+	int len;
+
+	if (aura_object_set_cache(n, "echo_vbin", 10000) != 0)
+		exit(1);
+
+	if (aura_call_raw(n, vbin_id, &retbuf, longstr, 4, 1, longstr, 0) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	if (aura_call_raw(n, vbin_id, &retbuf, longstr, 5, 1, longstr, 0) != AURA_CALL_COMPLETED)
+		exit(1);
+	aura_buffer_get_vbin8(retbuf, &len);
+	if (len != 5)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	if (aura_call_raw(n, vbin_id, &retbuf, longstr, 4, 1, longstr, 0) != AURA_CALL_COMPLETED)
+		exit(1);
+	if (retbuf->payload_size != 1 + 4 + 2 + 2)
+		exit(1);
+	aura_buffer_get_vbin8(retbuf, &len);
+	if (len != 4)
+		exit(1);
+	aura_buffer_release(retbuf);
+
+	aura_get_cache_stats(n, "echo_vbin", &stats);
+	if ((stats.hits != 1) || (stats.misses != 2))
+		exit(1);
+	aura_object_set_cache(n, "echo_vbin", 0);
+}
+
+/* Responses that don't fit in their buffer are dropped rather than read */
+static void test_malformed(struct aura_node *n)
+{
+	struct aura_object *o = aura_etable_find(n->tbl, "echo_vbin");
+	struct aura_buffer *buf = aura_buffer_request(n, 3);
+	char *p = aura_buffer_payload_ptr(buf);
+
+	buf->object = o;
+
+	/* Longer than the format allows */
+	p[0] = 33;
+	if (aura_deserialize_check(buf, o->ret_plan) != -EBADMSG)
+		exit(1);
+
+	/* Runs past the end of the buffer */
+	p[0] = 30;
+	if (aura_deserialize_check(buf, o->ret_plan) != -EBADMSG)
+		exit(1);
+
+	/* The next prefix is past the end, too */
+	p[0] = 2;
+	if (aura_deserialize_check(buf, o->ret_plan) != -EBADMSG)
+		exit(1);
+
+	aura_node_write(n, buf);
+}
+
+int main() {
+	int valid, num_args;
+	char *str;
+
+	slog_init(NULL, 18);
+
+	str = aura_fmt_pretty_print("v32.2V1024.", &valid, &num_args);
+	printf("Format:%s\n", str);
+	if (!valid || num_args != 3 || strcmp(str, " vbin8(32) uint16_t vbin16(1024)") != 0)
+		exit(1);
+	free(str);
+
+	struct aura_node *n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	test_echo(n);
+	test_cache(n);
+	test_malformed(n);
+
+	/* Length prefixes follow node's byte order */
+	aura_set_node_endian(n, AURA_ENDIAN_BIG);
+	test_echo(n);
+
+	printf("All done, closing the shop...\n");
+	aura_close(n);
+	return 0;
+}
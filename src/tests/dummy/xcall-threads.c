@@ -0,0 +1,84 @@
+#include <aura/aura.h>
+#include <pthread.h>
+#include <stdatomic.h>
+
+#define NUM_THREADS 4
+#define NUM_CALLS 256
+
+static atomic_int numfinished;
+static struct aura_node *n;
+
+static void *worker(void *arg)
+{
+	uint32_t base = (uintptr_t) arg << 16;
+	struct aura_xcall_cq *cq = aura_xcall_cq_create();
+	int numdone = 0;
+	int i;
+
+	for (i = 0; i < NUM_CALLS; i++) {
+		int ret;
+		/* Ring full? Wait for some of our calls to complete */
+		while ((ret = aura_xcall_submit(n, "echo_u32", cq, (void *)(uintptr_t)(base + i), base + i)) == -EAGAIN) {
+			struct aura_xcall *xc = aura_xcall_cq_wait(cq, 1);
+			if (!xc)
+				continue;
+			if (xc->status != AURA_CALL_COMPLETED)
+				exit(1);
+			if (aura_buffer_get_u32(xc->retbuf) != (uint32_t)(uintptr_t) xc->arg)
+				exit(1);
+			aura_xcall_release(xc);
+			numdone++;
+		}
+		if (ret != 0) {
+			printf("submit failed: %d\n", ret);
+			exit(1);
+		}
+	}
+
+	while (numdone < NUM_CALLS) {
+		struct aura_xcall *xc = aura_xcall_cq_wait(cq, 5000);
+		if (!xc) {
+			printf("Timed out waiting for completions\n");
+			exit(1);
+		}
+		if (xc->status != AURA_CALL_COMPLETED)
+			exit(1);
+		if (aura_buffer_get_u32(xc->retbuf) != (uint32_t)(uintptr_t) xc->arg)
+			exit(1);
+		aura_xcall_release(xc);
+		numdone++;
+	}
+
+	aura_xcall_cq_destroy(cq);
+	atomic_fetch_add(&numfinished, 1);
+	return NULL;
+}
+
+int main() {
+	pthread_t threads[NUM_THREADS];
+	struct aura_eventloop *loop;
+	int i;
+
+	slog_init(NULL, 18);
+
+	n = aura_open("dummy", NULL);
+	aura_wait_status(n, AURA_STATUS_ONLINE);
+
+	loop = aura_node_eventloop_get(n);
+	if (aura_eventloop_xcall_enable(loop, 64))
+		exit(1);
+
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_create(&threads[i], NULL, worker, (void *)(uintptr_t) i);
+
+	while (atomic_load(&numfinished) < NUM_THREADS)
+		aura_eventloop_dispatch(loop, AURA_EVTLOOP_ONCE);
+
+	for (i = 0; i < NUM_THREADS; i++)
+		pthread_join(threads[i], NULL);
+
+	printf("%d threads done, closing the shop...\n", NUM_THREADS);
+	aura_close(n);
+
+	return 0;
+}
@@ -0,0 +1,965 @@
+/*
+ * aura-codegen: Generate a C header of typed call stubs for an export table.
+ *
+ * The stubs have the ids, sizes and field offsets of every method baked in,
+ * so calling one takes no name lookups, no format parsing and no varargs.
+ * Each stub checks that the node's export table has the fingerprint of the
+ * one the header was generated for and fails with -ESTALE otherwise.
+ */
+#include <aura/aura.h>
+#include <getopt.h>
+#include <ctype.h>
+#include <sys/time.h>
+
+struct method {
+	int	id;
+	char *	name;
+	/* NULL for events */
+	char *	arg_fmt;
+	char *	ret_fmt;
+};
+
+struct method_list {
+	int		count;
+	int		size;
+	struct method *	methods;
+};
+
+static const struct {
+	const char *	name;
+	char		token;
+} conf_tokens[] = {
+	{ "UINT8",   URPC_U8  }, { "UINT16",  URPC_U16 },
+	{ "UINT32",  URPC_U32 }, { "UINT64",  URPC_U64 },
+	{ "SINT8",   URPC_S8  }, { "SINT16",  URPC_S16 },
+	{ "SINT32",  URPC_S32 }, { "SINT64",  URPC_S64 },
+	{ "FLOAT32", URPC_F32 }, { "FLOAT64", URPC_F64 },
+}, registry_tokens[] = {
+	{ "URPC_U8",  URPC_U8  }, { "URPC_U16", URPC_U16 },
+	{ "URPC_U32", URPC_U32 }, { "URPC_U64", URPC_U64 },
+	{ "URPC_S8",  URPC_S8  }, { "URPC_S16", URPC_S16 },
+	{ "URPC_S32", URPC_S32 }, { "URPC_S64", URPC_S64 },
+	{ "URPC_F32", URPC_F32 }, { "URPC_F64", URPC_F64 },
+	{ "URPC_BUF", URPC_BUF },
+};
+
+#define lookup_token(table, name) lookup_token_in(table, ARRAY_SIZE(table), name)
+#define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
+
+static char lookup_token_in(const void *table, int count, const char *name)
+{
+	const typeof(conf_tokens[0]) *t = table;
+	int i;
+
+	for (i = 0; i < count; i++)
+		if (strcmp(t[i].name, name) == 0)
+			return t[i].token;
+	return 0;
+}
+
+static void fatal(const char *fmt, ...)
+{
+	va_list ap;
+
+	va_start(ap, fmt);
+	fprintf(stderr, "aura-codegen: ");
+	vfprintf(stderr, fmt, ap);
+	fprintf(stderr, "\n");
+	va_end(ap);
+	exit(1);
+}
+
+static char *xstrdup(const char *str)
+{
+	char *ret = str ? strdup(str) : NULL;
+
+	if (str && !ret)
+		fatal("out of memory");
+	return ret;
+}
+
+/* Append to a malloc'd string */
+static void append(char **str, const char *fmt, ...)
+{
+	char *tmp, *ret;
+	va_list ap;
+
+	va_start(ap, fmt);
+	if (vasprintf(&tmp, fmt, ap) < 0)
+		fatal("out of memory");
+	va_end(ap);
+
+	if (asprintf(&ret, "%s%s", *str ? *str : "", tmp) < 0)
+		fatal("out of memory");
+	free(tmp);
+	free(*str);
+	*str = ret;
+}
+
+static void method_add(struct method_list *list, int id, const char *name,
+		       const char *arg_fmt, const char *ret_fmt)
+{
+	struct method *m;
+
+	if (list->count == list->size) {
+		list->size = list->size ? list->size * 2 : 16;
+		list->methods = realloc(list->methods, list->size * sizeof(*m));
+		if (!list->methods)
+			fatal("out of memory");
+	}
+	m = &list->methods[list->count++];
+	m->id = id;
+	m->name = xstrdup(name);
+	m->arg_fmt = xstrdup(arg_fmt);
+	m->ret_fmt = xstrdup(ret_fmt);
+}
+
+/* aura_etable_add() is fatal about bad formats, so tell the user what's wrong first */
+static void check_fmt(const struct method *m, const char *fmt)
+{
+	int valid, num_args;
+
+	if (!fmt)
+		return;
+	free(aura_fmt_pretty_print(fmt, &valid, &num_args));
+	if (!valid)
+		fatal("%s: bad format \"%s\"", m->name, fmt);
+}
+
+static int method_cmp(const void *a, const void *b)
+{
+	return ((const struct method *)a)->id - ((const struct method *)b)->id;
+}
+
+static char *read_file(const char *path)
+{
+	FILE *f = fopen(path, "r");
+	char *data = NULL;
+	size_t len = 0;
+
+	if (!f)
+		fatal("can't open %s: %s", path, strerror(errno));
+	if (getdelim(&data, &len, '\0', f) < 0)
+		data = xstrdup("");
+	fclose(f);
+	return data;
+}
+
+/* A tiny lexer good enough for lua configs and C sources */
+static void skip_ws(const char **p)
+{
+	for (;;) {
+		while (isspace(**p))
+			(*p)++;
+		if (((**p == '-') && ((*p)[1] == '-')) || ((**p == '/') && ((*p)[1] == '/'))) {
+			while (**p && (**p != '\n'))
+				(*p)++;
+		} else if ((**p == '/') && ((*p)[1] == '*')) {
+			const char *end = strstr(*p + 2, "*/");
+			*p = end ? end + 2 : *p + strlen(*p);
+		} else {
+			return;
+		}
+	}
+}
+
+static bool expect(const char **p, char c)
+{
+	skip_ws(p);
+	if (**p != c)
+		return false;
+	(*p)++;
+	return true;
+}
+
+static bool parse_ident(const char **p, char *out, int max)
+{
+	int len = 0;
+
+	skip_ws(p);
+	if (!isalpha(**p) && (**p != '_'))
+		return false;
+	while ((isalnum(**p) || (**p == '_')) && (len < max - 1))
+		out[len++] = *(*p)++;
+	out[len] = 0;
+	return true;
+}
+
+static bool parse_int(const char **p, int *out)
+{
+	char *end;
+
+	skip_ws(p);
+	*out = strtol(*p, &end, 0);
+	if (end == *p)
+		return false;
+	*p = end;
+	return true;
+}
+
+/* Appends the contents of a string literal to out. No escapes, formats don't need them */
+static bool parse_string(const char **p, char **out)
+{
+	const char *end;
+
+	skip_ws(p);
+	if (**p != '"')
+		return false;
+	end = strchr(*p + 1, '"');
+	if (!end)
+		return false;
+	append(out, "%.*s", (int)(end - *p - 1), *p + 1);
+	*p = end + 1;
+	return true;
+}
+
+/* One field of a usb-simple config: UINT8, BIN(32), ARRAY(SINT16, 8), VBIN(64)... */
+static bool parse_conf_field(const char **p, char **fmt)
+{
+	char ident[32], elem[32];
+	char tok;
+	int n;
+
+	if (!parse_ident(p, ident, sizeof(ident)))
+		return false;
+
+	tok = lookup_token(conf_tokens, ident);
+	if (tok) {
+		append(fmt, "%c", tok);
+		return true;
+	}
+
+	if (!expect(p, '('))
+		return false;
+	if (strcmp(ident, "ARRAY") == 0) {
+		if (!parse_ident(p, elem, sizeof(elem)) || !(tok = lookup_token(conf_tokens, elem)))
+			return false;
+		if (!expect(p, ',') || !parse_int(p, &n))
+			return false;
+		append(fmt, "%c%c%d.", URPC_ARRAY, tok, n);
+	} else {
+		if (!parse_int(p, &n))
+			return false;
+		if (strcmp(ident, "BIN") == 0)
+			append(fmt, "%c%d.", URPC_BIN, n);
+		else if (strcmp(ident, "VBIN") == 0)
+			append(fmt, "%c%d.", URPC_VBIN8, n);
+		else if (strcmp(ident, "VBIN16") == 0)
+			append(fmt, "%c%d.", URPC_VBIN16, n);
+		else
+			return false;
+	}
+	return expect(p, ')');
+}
+
+/*
+ * usb-simple configs declare methods as [id] = NONE("name"), WRITE("name", fields...)
+ * or READ("name", fields...), see lua/aura/conf-loader.lua. All of them take two
+ * u16 arguments, writes append theirs.
+ */
+static void load_conf(struct method_list *list, const char *path)
+{
+	char *data = read_file(path);
+	const char *p = data;
+	int i;
+
+	while ((p = strchr(p, '['))) {
+		const char *start = p++;
+		char kind[16];
+		char *name = NULL, *fields = NULL;
+		int id;
+
+		if (!parse_int(&p, &id) || !expect(&p, ']') || !expect(&p, '=') ||
+		    !parse_ident(&p, kind, sizeof(kind)) || !expect(&p, '(')) {
+			p = start + 1;
+			continue;
+		}
+
+		if (!parse_string(&p, &name))
+			fatal("%s: method %d has no name", path, id);
+		while (expect(&p, ','))
+			if (!parse_conf_field(&p, &fields))
+				fatal("%s: can't parse the fields of %s", path, name);
+		if (!expect(&p, ')'))
+			fatal("%s: can't parse the fields of %s", path, name);
+
+		if (strcmp(kind, "NONE") == 0)
+			method_add(list, id, name, "22", "");
+		else if (strcmp(kind, "WRITE") == 0)
+			method_add(list, id, name, fields ? fields : "", "");
+		else if (strcmp(kind, "READ") == 0)
+			method_add(list, id, name, "22", fields ? fields : "");
+		else
+			fatal("%s: unknown method kind %s", path, kind);
+
+		/* Writes take the two u16 in front of their own arguments */
+		if (strcmp(kind, "WRITE") == 0) {
+			struct method *m = &list->methods[list->count - 1];
+			char *fmt = NULL;
+
+			append(&fmt, "22%s", m->arg_fmt);
+			free(m->arg_fmt);
+			m->arg_fmt = fmt;
+		}
+		free(name);
+		free(fields);
+	}
+	free(data);
+
+	/* The loader stops at the first missing id, and so do we */
+	qsort(list->methods, list->count, sizeof(struct method), method_cmp);
+	for (i = 0; i < list->count; i++)
+		if (list->methods[i].id != i)
+			break;
+	list->count = i;
+}
+
+/* A format made of URPC_* tokens and string literals, up to a ',' or ')' */
+static bool parse_registry_fmt(const char **p, char **fmt, char terminator)
+{
+	char ident[32];
+	char tok;
+
+	append(fmt, "");
+	for (;;) {
+		skip_ws(p);
+		if (**p == terminator) {
+			(*p)++;
+			return true;
+		}
+		if (**p == '"') {
+			if (!parse_string(p, fmt))
+				return false;
+			continue;
+		}
+		if (!parse_ident(p, ident, sizeof(ident)))
+			return false;
+		if (strcmp(ident, "URPC_NONE") == 0)
+			continue;
+		tok = lookup_token(registry_tokens, ident);
+		if (!tok)
+			return false;
+		append(fmt, "%c", tok);
+	}
+}
+
+/* Blank out C comments, so that the declarations in them don't count */
+static void strip_c_comments(char *p)
+{
+	while (*p) {
+		char *end = NULL;
+
+		if ((p[0] == '/') && (p[1] == '*'))
+			end = strstr(p + 2, "*/");
+		else if ((p[0] == '/') && (p[1] == '/'))
+			end = strchrnul(p, '\n');
+		else if (*p == '"')
+			end = strchrnul(p + 1, '"');
+
+		if (!end) {
+			p++;
+			continue;
+		}
+		if (*p == '"') {
+			p = *end ? end + 1 : end;
+			continue;
+		}
+		if ((p[1] == '*') && *end)
+			end += 2;
+		while (p < end)
+			*p++ = ' ';
+	}
+}
+
+/*
+ * Firmware sources declare their methods with URPC_METHOD(name, args, rets),
+ * and the registry lists them in the order they are declared in.
+ */
+static void load_registry(struct method_list *list, const char *path)
+{
+	char *data = read_file(path);
+	const char *p = data;
+	int id = 0;
+
+	strip_c_comments(data);
+	while ((p = strstr(p, "URPC_METHOD"))) {
+		char name[128];
+		char *args = NULL, *rets = NULL;
+
+		p += strlen("URPC_METHOD");
+		if (!expect(&p, '('))
+			continue;
+		if (!parse_ident(&p, name, sizeof(name)) || !expect(&p, ',') ||
+		    !parse_registry_fmt(&p, &args, ',') || !parse_registry_fmt(&p, &rets, ')'))
+			fatal("%s: can't parse URPC_METHOD near %.20s", path, p);
+		method_add(list, id++, name, args, rets);
+		free(args);
+		free(rets);
+	}
+	free(data);
+}
+
+/* Dumps made with --dump: one object per line, name "argfmt" "retfmt", - for no format */
+static void load_dump(struct method_list *list, const char *path)
+{
+	char *data = read_file(path);
+	char *line, *saveptr;
+	int id = 0;
+
+	for (line = strtok_r(data, "\n", &saveptr); line; line = strtok_r(NULL, "\n", &saveptr)) {
+		const char *p = line;
+		char *fmt[2] = { NULL, NULL };
+		char name[128];
+		int i;
+
+		skip_ws(&p);
+		if (!*p || (*p == '#'))
+			continue;
+		if (sscanf(p, "%127s", name) != 1)
+			fatal("%s: bad line: %s", path, line);
+		p += strlen(name);
+		for (i = 0; i < 2; i++) {
+			if (expect(&p, '-'))
+				continue;
+			append(&fmt[i], "");
+			if (!parse_string(&p, &fmt[i]))
+				fatal("%s: bad line: %s", path, line);
+		}
+		method_add(list, id++, name, fmt[0], fmt[1]);
+		free(fmt[0]);
+		free(fmt[1]);
+	}
+	free(data);
+}
+
+static void load_node(struct method_list *list, const char *transport, const char *opts, int timeout)
+{
+	struct timeval tv = { timeout, 0 };
+	struct aura_node *node = aura_open(transport, opts);
+	int i;
+
+	if (!node)
+		fatal("can't open a %s node", transport);
+	if (aura_wait_status_timeout(node, AURA_STATUS_ONLINE, &tv) != AURA_STATUS_ONLINE)
+		fatal("the %s node didn't go online in %d seconds", transport, timeout);
+
+	for (i = 0; i < node->tbl->next; i++) {
+		struct aura_object *o = &node->tbl->objects[i];
+		method_add(list, o->id, o->name, o->arg_fmt, o->ret_fmt);
+	}
+	aura_close(node);
+}
+
+static void print_fmt(FILE *out, const char *fmt)
+{
+	if (fmt)
+		fprintf(out, " \"%s\"", fmt);
+	else
+		fprintf(out, " -");
+}
+
+static void dump_etable(FILE *out, struct aura_export_table *tbl)
+{
+	int i;
+
+	fprintf(out, "# aura export table, fingerprint 0x%08x\n", aura_etable_fingerprint(tbl));
+	for (i = 0; i < tbl->next; i++) {
+		struct aura_object *o = &tbl->objects[i];
+
+		fprintf(out, "%s", o->name);
+		print_fmt(out, o->arg_fmt);
+		print_fmt(out, o->ret_fmt);
+		fprintf(out, "\n");
+	}
+}
+
+static const char *c_type(char t)
+{
+	switch (t) {
+	case URPC_U8:
+		return "uint8_t";
+	case URPC_S8:
+		return "int8_t";
+	case URPC_U16:
+		return "uint16_t";
+	case URPC_S16:
+		return "int16_t";
+	case URPC_U32:
+		return "uint32_t";
+	case URPC_S32:
+		return "int32_t";
+	case URPC_U64:
+		return "uint64_t";
+	case URPC_S64:
+		return "int64_t";
+	case URPC_F32:
+		return "float";
+	case URPC_F64:
+		return "double";
+	}
+	return NULL;
+}
+
+/* Suffix of the aura_stub_put/get helper for a scalar field */
+static const char *stub_suffix(char t)
+{
+	switch (t) {
+	case URPC_U16:
+	case URPC_S16:
+		return "16";
+	case URPC_U32:
+	case URPC_S32:
+		return "32";
+	case URPC_U64:
+	case URPC_S64:
+		return "64";
+	case URPC_F32:
+		return "_f32";
+	case URPC_F64:
+		return "_f64";
+	}
+	return NULL;
+}
+
+static void print_ident(FILE *out, const char *str, bool upper)
+{
+	for (; *str; str++) {
+		int c = isalnum(*str) ? *str : '_';
+		fputc(upper ? toupper(c) : c, out);
+	}
+}
+
+static bool plan_supported(const struct aura_fmt_plan *plan)
+{
+	int i;
+
+	for (i = 0; plan && (i < plan->num_ops); i++)
+		if (plan->ops[i].type == URPC_BUF)
+			return false;
+	return true;
+}
+
+static void gen_params(FILE *out, const struct aura_fmt_plan *plan, bool rets)
+{
+	const char *pfx = rets ? "ret" : "arg";
+	const char *cnst = rets ? "" : "const ";
+	int i;
+
+	for (i = 0; plan && (i < plan->num_ops); i++) {
+		const struct aura_fmt_op *op = &plan->ops[i];
+
+		switch (op->type) {
+		case URPC_BIN:
+			fprintf(out, ", %svoid *%s%d", cnst, pfx, i);
+			break;
+		case URPC_VBIN8:
+		case URPC_VBIN16:
+			fprintf(out, ", %svoid *%s%d, int %s%s%d_len", cnst, pfx, i, rets ? "*" : "", pfx, i);
+			break;
+		case URPC_ARRAY:
+			fprintf(out, ", %s%s *%s%d", cnst, c_type(op->elem), pfx, i);
+			break;
+		default:
+			fprintf(out, ", %s %s%s%d", c_type(op->type), rets ? "*" : "", pfx, i);
+		}
+	}
+}
+
+static void gen_put(FILE *out, const struct aura_fmt_op *op, int i)
+{
+	int prefix = (op->type == URPC_VBIN8) ? 1 : 2;
+
+	switch (op->type) {
+	case URPC_U8:
+	case URPC_S8:
+		fprintf(out, "\t*p = arg%d;\n", i);
+		break;
+	case URPC_BIN:
+		fprintf(out, "\tmemcpy(p, arg%d, %d);\n", i, op->size);
+		break;
+	case URPC_ARRAY:
+		fprintf(out, "\taura_stub_put_array(p, arg%d, %d, %d, node->need_endian_swap);\n",
+			i, op->count, op->size / op->count);
+		break;
+	case URPC_VBIN8:
+		fprintf(out, "\t*p = arg%d_len;\n", i);
+		break;
+	case URPC_VBIN16:
+		fprintf(out, "\taura_stub_put16(p, arg%d_len, node->need_endian_swap);\n", i);
+		break;
+	default:
+		fprintf(out, "\taura_stub_put%s(p, arg%d, node->need_endian_swap);\n",
+			stub_suffix(op->type), i);
+	}
+
+	if (URPC_IS_VBIN(op->type)) {
+		fprintf(out, "\tmemcpy(p + %d, arg%d, arg%d_len);\n", prefix, i, i);
+		fprintf(out, "\tp += %d + arg%d_len;\n", prefix, i);
+	} else {
+		fprintf(out, "\tp += %d;\n", op->size);
+	}
+}
+
+/* Bytes the response should have from op on: fixed fields up to and including the next length prefix */
+static int fixed_run(const struct aura_fmt_plan *plan, int from)
+{
+	int len = 0;
+	int i;
+
+	for (i = from; i < plan->num_ops; i++) {
+		const struct aura_fmt_op *op = &plan->ops[i];
+
+		if (URPC_IS_VBIN(op->type))
+			return len + ((op->type == URPC_VBIN8) ? 1 : 2);
+		len += op->size;
+	}
+	return len;
+}
+
+static void gen_get(FILE *out, const struct aura_fmt_plan *plan, int i)
+{
+	const struct aura_fmt_op *op = &plan->ops[i];
+	int prefix = (op->type == URPC_VBIN8) ? 1 : 2;
+
+	switch (op->type) {
+	case URPC_U8:
+	case URPC_S8:
+		fprintf(out, "\tif (ret%d)\n\t\t*ret%d = *p;\n", i, i);
+		break;
+	case URPC_BIN:
+		fprintf(out, "\tif (ret%d)\n\t\tmemcpy(ret%d, p, %d);\n", i, i, op->size);
+		break;
+	case URPC_ARRAY:
+		fprintf(out, "\tif (ret%d)\n\t\taura_stub_get_array(ret%d, p, %d, %d, node->need_endian_swap);\n",
+			i, i, op->count, op->size / op->count);
+		break;
+	case URPC_VBIN8:
+	case URPC_VBIN16:
+		if (op->type == URPC_VBIN8)
+			fprintf(out, "\tvlen = (uint8_t)*p;\n");
+		else
+			fprintf(out, "\tvlen = aura_stub_get16(p, node->need_endian_swap);\n");
+		fprintf(out, "\tif ((vlen > %d) || (end - p < %d + vlen + %d))\n\t\tgoto bad;\n",
+			op->count, prefix, fixed_run(plan, i + 1));
+		fprintf(out, "\tif (ret%d)\n\t\tmemcpy(ret%d, p + %d, vlen);\n", i, i, prefix);
+		fprintf(out, "\tif (ret%d_len)\n\t\t*ret%d_len = vlen;\n", i, i);
+		fprintf(out, "\tp += %d + vlen;\n", prefix);
+		return;
+	default:
+		fprintf(out, "\tif (ret%d)\n\t\t*ret%d = aura_stub_get%s(p, node->need_endian_swap);\n",
+			i, i, stub_suffix(op->type));
+	}
+	fprintf(out, "\tp += %d;\n", op->size);
+}
+
+static void gen_method(FILE *out, const char *prefix, struct aura_object *o)
+{
+	const struct aura_fmt_plan *args = o->arg_plan, *rets = o->ret_plan;
+	int nargs = args ? args->num_ops : 0;
+	int nrets = rets ? rets->num_ops : 0;
+	bool vrets = false;
+	int fixed, i;
+
+	fprintf(out, "\n/* %s:%s ->%s */\n", o->name, o->arg_pprinted, o->ret_pprinted ? o->ret_pprinted : "");
+	fprintf(out, "#define ");
+	print_ident(out, prefix, true);
+	fprintf(out, "_");
+	print_ident(out, o->name, true);
+	fprintf(out, "_ID %d\n", o->id);
+
+	if (!o->valid || !plan_supported(args) || !plan_supported(rets)) {
+		fprintf(out, "/* No stub: the format is invalid or has aura_buffer fields, use aura_call() */\n");
+		return;
+	}
+
+	for (i = 0; i < nrets; i++)
+		vrets |= URPC_IS_VBIN(rets->ops[i].type);
+
+	fprintf(out, "static inline int %s_", prefix);
+	print_ident(out, o->name, false);
+	fprintf(out, "(struct aura_node *node");
+	gen_params(out, args, false);
+	gen_params(out, rets, true);
+	fprintf(out, ")\n{\n");
+	fprintf(out, "\tstruct aura_buffer *buf, *retbuf;\n");
+	if (nargs || nrets)
+		fprintf(out, "\tchar *p;\n");
+	if (nrets)
+		fprintf(out, "\tconst char *end;\n");
+	if (vrets)
+		fprintf(out, "\tint vlen;\n");
+	fprintf(out, "\tint len, ret;\n\n");
+
+	fprintf(out, "\tif (!%s_etable_matches(node))\n\t\treturn -ESTALE;\n\n", prefix);
+
+	for (i = 0; i < nargs; i++) {
+		const struct aura_fmt_op *op = &args->ops[i];
+
+		if (URPC_IS_VBIN(op->type))
+			fprintf(out, "\tif ((arg%d_len < 0) || (arg%d_len > %d))\n\t\treturn -E2BIG;\n",
+				i, i, op->count);
+	}
+
+	/* Precomputed size, plus the actual lengths of variable-size fields */
+	fixed = o->arglen;
+	for (i = 0; args && args->variable && (i < nargs); i++)
+		if (URPC_IS_VBIN(args->ops[i].type))
+			fixed -= args->ops[i].count;
+	fprintf(out, "\tlen = %d", fixed);
+	for (i = 0; i < nargs; i++)
+		if (URPC_IS_VBIN(args->ops[i].type))
+			fprintf(out, " + arg%d_len", i);
+	fprintf(out, ";\n");
+	fprintf(out, "\tbuf = aura_buffer_request(node, len);\n");
+	fprintf(out, "\tif (!buf)\n\t\treturn -ENOMEM;\n");
+	if (nargs)
+		fprintf(out, "\tp = aura_buffer_payload_ptr(buf);\n");
+	for (i = 0; i < nargs; i++)
+		gen_put(out, &args->ops[i], i);
+	fprintf(out, "\tbuf->payload_size = len;\n\n");
+
+	fprintf(out, "\tret = aura_call_buffer(node, %d, &retbuf, buf);\n", o->id);
+	fprintf(out, "\tif (ret < 0)\n\t\taura_buffer_release(buf);\n");
+	fprintf(out, "\tif (ret != AURA_CALL_COMPLETED)\n\t\treturn ret;\n\n");
+
+	if (nrets) {
+		fprintf(out, "\tp = aura_buffer_payload_ptr(retbuf);\n");
+		fprintf(out, "\tend = p + retbuf->payload_size;\n");
+		fprintf(out, "\tif (end - p < %d)\n\t\tgoto bad;\n", fixed_run(rets, 0));
+		for (i = 0; i < nrets; i++)
+			gen_get(out, rets, i);
+	}
+	fprintf(out, "\taura_buffer_release(retbuf);\n");
+	fprintf(out, "\treturn ret;\n");
+	if (nrets)
+		fprintf(out, "bad:\n\taura_buffer_release(retbuf);\n\treturn -EBADMSG;\n");
+	fprintf(out, "}\n");
+}
+
+static const char stub_helpers[] =
+	"#ifndef AURA_STUB_HELPERS\n"
+	"#define AURA_STUB_HELPERS\n"
+	"\n"
+	"/* Fields in node byte order, shared by all generated headers */\n"
+	"#define AURA_STUB_SCALAR(bits)\\\n"
+	"static inline void aura_stub_put ## bits(char *p, uint ## bits ## _t v, bool swap)\\\n"
+	"{\\\n"
+	"\tif (swap)\\\n"
+	"\t\tv = __swap ## bits(v);\\\n"
+	"\tmemcpy(p, &v, sizeof(v));\\\n"
+	"}\\\n"
+	"static inline uint ## bits ## _t aura_stub_get ## bits(const char *p, bool swap)\\\n"
+	"{\\\n"
+	"\tuint ## bits ## _t v;\\\n"
+	"\tmemcpy(&v, p, sizeof(v));\\\n"
+	"\treturn swap ? __swap ## bits(v) : v;\\\n"
+	"}\n"
+	"\n"
+	"#define AURA_STUB_FLOAT(name, tp, bits)\\\n"
+	"static inline void aura_stub_put_ ## name(char *p, tp f, bool swap)\\\n"
+	"{\\\n"
+	"\tuint ## bits ## _t v;\\\n"
+	"\tmemcpy(&v, &f, sizeof(v));\\\n"
+	"\taura_stub_put ## bits(p, v, swap);\\\n"
+	"}\\\n"
+	"static inline tp aura_stub_get_ ## name(const char *p, bool swap)\\\n"
+	"{\\\n"
+	"\tuint ## bits ## _t v = aura_stub_get ## bits(p, swap);\\\n"
+	"\ttp f;\\\n"
+	"\tmemcpy(&f, &v, sizeof(f));\\\n"
+	"\treturn f;\\\n"
+	"}\n"
+	"\n"
+	"AURA_STUB_SCALAR(16)\n"
+	"AURA_STUB_SCALAR(32)\n"
+	"AURA_STUB_SCALAR(64)\n"
+	"AURA_STUB_FLOAT(f32, float, 32)\n"
+	"AURA_STUB_FLOAT(f64, double, 64)\n"
+	"\n"
+	"static inline void aura_stub_put_array(char *p, const void *src, int count, int size, bool swap)\n"
+	"{\n"
+	"\tif (swap && (size > 1))\n"
+	"\t\taura_swap_array(p, src, count, size);\n"
+	"\telse\n"
+	"\t\tmemcpy(p, src, count * size);\n"
+	"}\n"
+	"\n"
+	"static inline void aura_stub_get_array(void *dst, const char *p, int count, int size, bool swap)\n"
+	"{\n"
+	"\tif (swap && (size > 1))\n"
+	"\t\taura_swap_array(dst, p, count, size);\n"
+	"\telse\n"
+	"\t\tmemcpy(dst, p, count * size);\n"
+	"}\n"
+	"\n"
+	"#endif\n";
+
+static void gen_header(FILE *out, const char *prefix, const char *source, struct aura_export_table *tbl)
+{
+	int i;
+
+	fprintf(out, "/* Generated by aura-codegen from %s, do not edit */\n", source);
+	fprintf(out, "#ifndef ");
+	print_ident(out, prefix, true);
+	fprintf(out, "_STUBS_H\n#define ");
+	print_ident(out, prefix, true);
+	fprintf(out, "_STUBS_H\n\n#include <aura/aura.h>\n\n%s\n", stub_helpers);
+
+	fprintf(out, "/* Fingerprint of the export table these stubs are for, see aura_etable_fingerprint() */\n");
+	fprintf(out, "#define ");
+	print_ident(out, prefix, true);
+	fprintf(out, "_ETABLE_FINGERPRINT 0x%08xu\n\n", aura_etable_fingerprint(tbl));
+
+	fprintf(out, "static inline bool %s_etable_matches(struct aura_node *node)\n{\n", prefix);
+	fprintf(out, "\treturn node->tbl && (node->tbl->fingerprint == ");
+	print_ident(out, prefix, true);
+	fprintf(out, "_ETABLE_FINGERPRINT);\n}\n");
+
+	for (i = 0; i < tbl->next; i++) {
+		struct aura_object *o = &tbl->objects[i];
+
+		if (object_is_method(o)) {
+			gen_method(out, prefix, o);
+		} else {
+			fprintf(out, "\n/* %s: event ->%s */\n#define ", o->name, o->ret_pprinted ? o->ret_pprinted : "");
+			print_ident(out, prefix, true);
+			fprintf(out, "_");
+			print_ident(out, o->name, true);
+			fprintf(out, "_ID %d\n", o->id);
+		}
+	}
+	fprintf(out, "\n#endif\n");
+}
+
+static void usage(const char *self)
+{
+	printf("Usage: %s [options] source\n"
+	       "Generate a C header of typed call stubs for an aura export table.\n\n"
+	       "Sources:\n"
+	       "  -n, --node TRANSPORT     open a node and use its export table\n"
+	       "  -a, --node-opts OPTS     transport options for --node\n"
+	       "  -c, --conf FILE          usb-simple config, see simpleusbconfigs/\n"
+	       "  -r, --registry FILE      firmware source with URPC_METHOD() declarations\n"
+	       "  -e, --etable FILE        export table dump made with --dump\n\n"
+	       "Options:\n"
+	       "  -p, --prefix PREFIX      prefix of the generated functions (default: aura_stub)\n"
+	       "  -o, --output FILE        where to write the result (default: stdout)\n"
+	       "  -d, --dump               dump the export table instead of generating code\n"
+	       "  -w, --wait SECONDS       how long to wait for the node to go online (default: 10)\n"
+	       "  -h, --help               this help\n",
+	       self);
+}
+
+int main(int argc, char *argv[])
+{
+	static const struct option long_options[] = {
+		{ "node",      required_argument, 0, 'n' },
+		{ "node-opts", required_argument, 0, 'a' },
+		{ "conf",      required_argument, 0, 'c' },
+		{ "registry",  required_argument, 0, 'r' },
+		{ "etable",    required_argument, 0, 'e' },
+		{ "prefix",    required_argument, 0, 'p' },
+		{ "output",    required_argument, 0, 'o' },
+		{ "dump",      no_argument,       0, 'd' },
+		{ "wait",      required_argument, 0, 'w' },
+		{ "help",      no_argument,       0, 'h' },
+		{ 0, 0, 0, 0 }
+	};
+	struct method_list list = { 0 };
+	struct aura_export_table *tbl;
+	const char *source = NULL, *opts = NULL, *prefix = "aura_stub", *output = NULL;
+	char kind = 0;
+	bool dump = false;
+	int timeout = 10;
+	FILE *out = stdout;
+	int c, i;
+
+	while ((c = getopt_long(argc, argv, "n:a:c:r:e:p:o:dw:h", long_options, NULL)) != -1) {
+		switch (c) {
+		case 'n':
+		case 'c':
+		case 'r':
+		case 'e':
+			if (kind)
+				fatal("only one source please");
+			kind = c;
+			source = optarg;
+			break;
+		case 'a':
+			opts = optarg;
+			break;
+		case 'p':
+			prefix = optarg;
+			break;
+		case 'o':
+			output = optarg;
+			break;
+		case 'd':
+			dump = true;
+			break;
+		case 'w':
+			timeout = atoi(optarg);
+			break;
+		case 'h':
+			usage(argv[0]);
+			return 0;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!kind) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	slog_init(NULL, 0);
+
+	switch (kind) {
+	case 'n':
+		load_node(&list, source, opts, timeout);
+		break;
+	case 'c':
+		load_conf(&list, source);
+		break;
+	case 'r':
+		load_registry(&list, source);
+		break;
+	case 'e':
+		load_dump(&list, source);
+		break;
+	}
+
+	/* Build the very table a node would, so that sizes and the fingerprint match */
+	tbl = aura_etable_create(NULL, list.count);
+	if (!tbl)
+		fatal("out of memory");
+	for (i = 0; i < list.count; i++) {
+		struct method *m = &list.methods[i];
+
+		check_fmt(m, m->arg_fmt);
+		check_fmt(m, m->ret_fmt);
+		aura_etable_add(tbl, m->name, m->arg_fmt, m->ret_fmt);
+		free(m->name);
+		free(m->arg_fmt);
+		free(m->ret_fmt);
+	}
+	free(list.methods);
+
+	if (output) {
+		out = fopen(output, "w");
+		if (!out)
+			fatal("can't open %s: %s", output, strerror(errno));
+	}
+
+	if (dump)
+		dump_etable(out, tbl);
+	else
+		gen_header(out, prefix, source, tbl);
+
+	if (out != stdout)
+		fclose(out);
+	aura_etable_destroy(tbl);
+	return 0;
+}
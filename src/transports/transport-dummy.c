@@ -22,7 +22,7 @@ static void timer_cb_fn(struct aura_node *node, struct aura_timer *tm, void *arg
 
 static void dummy_populate_etable(struct aura_node *node)
 {
-	struct aura_export_table *etbl = aura_etable_create(node, 16);
+	struct aura_export_table *etbl = aura_etable_create(node, 32);
 
 	if (!etbl)
 		BUG(node, "Failed to create etable");
@@ -40,6 +40,11 @@ static void dummy_populate_etable(struct aura_node *node)
 	aura_etable_add(etbl, "echo_u64", "4", "4");
 	aura_etable_add(etbl, "echo_i8", "6", "6");
 	aura_etable_add(etbl, "echo_i64", "9", "9");
+	aura_etable_add(etbl, "echo_array", "a7517.a43.", "a7517.a43.");
+	aura_etable_add(etbl, "echo_vbin", "v32.2V1024.", "v32.2V1024.");
+	aura_etable_add(etbl, "echo_float", "fd", "fd");
+	/* Calls to this one are never answered */
+	aura_etable_add(etbl, "blackhole", "1", "1");
 	aura_etable_activate(etbl);
 }
 
@@ -86,6 +91,10 @@ static void dummy_handle_event(struct aura_node *node, enum node_event evt, cons
 		buf = aura_node_read(node);
 		if (!buf)
 			break;
+		if (strcmp(buf->object->name, "blackhole") == 0) {
+			aura_buffer_release(buf);
+			continue;
+		}
 		aura_node_write(node, buf);
 	}
 }
@@ -362,7 +362,7 @@ static inline void do_issue_next_call(struct aura_node *node)
 	struct nmc_private *pv = aura_get_userdata(node);
 	struct aura_object *o;
 
-	out_buf = aura_dequeue_buffer(&node->outbound_buffers);
+	out_buf = aura_node_read(node);
 	if (!out_buf)
 		return;
 
@@ -372,6 +372,7 @@ static inline void do_issue_next_call(struct aura_node *node)
 		BUG(node, "Buffer allocation failed");
 
 	in_buf->object = o;
+	in_buf->call_tag = out_buf->call_tag;
 	pv->current_out = out_buf;
 	pv->current_in = in_buf;
 	pv->sbuf->id = o->id;
@@ -56,7 +56,7 @@ static void ser_loop(struct aura_node *node, const struct aura_pollfds *fd)
 	struct aura_object *o;
 
 	while (1) {
-		buf = aura_dequeue_buffer(&node->outbound_buffers);
+		buf = aura_node_read(node);
 		if (!buf)
 			break;
 		o = buf->object;
@@ -218,7 +218,13 @@ static int susb_open(struct aura_node *node, const char *conf)
 	lua_settoken(L, "SINT32", URPC_S32);
 	lua_settoken(L, "SINT64", URPC_S64);
 
+	lua_settoken(L, "FLOAT32", URPC_F32);
+	lua_settoken(L, "FLOAT64", URPC_F64);
+
 	lua_settoken(L, "FMT_BIN", URPC_BIN);
+	lua_settoken(L, "FMT_ARRAY", URPC_ARRAY);
+	lua_settoken(L, "FMT_VBIN8", URPC_VBIN8);
+	lua_settoken(L, "FMT_VBIN16", URPC_VBIN16);
 
 	ret = lua_pcall(L, 0, 7, 0);
 	if (ret) {
@@ -401,7 +407,7 @@ static void susb_handle_event(struct aura_node *node, enum node_event evt, const
 	} else if (inf->state == SUSB_DEVICE_RESTART) {
 		susb_offline_transport(inf);
 	} else if (inf->state == SUSB_DEVICE_OPERATIONAL) {
-		buf = aura_peek_buffer(&node->outbound_buffers);
+		buf = aura_node_peek(node);
 		if (buf)
 			susb_issue_call(node, buf);
 	}
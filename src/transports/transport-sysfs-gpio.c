@@ -195,7 +195,7 @@ static void gpio_handle_event(struct aura_node *node, enum node_event evt, const
 	struct aura_object *o;
 
 	while (1) {
-		buf = aura_dequeue_buffer(&node->outbound_buffers);
+		buf = aura_node_read(node);
 		if (!buf)
 			break;
 		o = buf->object;
@@ -381,7 +381,7 @@ void poll_timer_arm(struct aura_node *node)
 	struct aura_buffer *buf;
 
 	/* If we have anything outgoing - send it now */
-	if ((buf = aura_dequeue_buffer(&node->outbound_buffers))) {
+	if ((buf = aura_node_read(node))) {
 		submit_call_write(node, buf);
 		return;
 	}
@@ -514,7 +514,7 @@ static void cb_call_write_done(struct libusb_transfer *transfer)
 	submit_event_readout(node);
 	return;
 requeue:
-	aura_requeue_buffer(&node->outbound_buffers, inf->current_buffer);
+	aura_node_requeue(node, inf->current_buffer);
 	inf->current_buffer = NULL;
 }
 